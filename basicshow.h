@@ -0,0 +1,336 @@
+#ifndef BASICSHOW_H
+#define BASICSHOW_H
+#include <limits>
+#include <vector>
+#include <type_traits>
+using namespace std;
+#define DEFAULT_HEIGHT 0
+#define MAX_DEPTH 64 // an AVL tree this deep would hold far more than 2^32 nodes
+// built with SHOW_CHECKED defined, every rebalance and finger insert checks the stored
+// heights, the balance and the ID order of the nodes it touched; without it the checks
+// are not compiled in at all
+#ifdef SHOW_CHECKED
+#define SHOW_CHECK(node, low, high) checkNode(node, low, high)
+#else
+#define SHOW_CHECK(node, low, high)
+#endif
+template <class Key, Key MinKey, Key MaxKey, class Payload, class Node, class Owner>
+class BasicTree;
+// node layout of every tree built on BasicTree, Self is the node class itself so the links
+// point at the full node whatever a tree adds to it (Drone adds the position, the tags, ...)
+template <class Key, class Payload, class Self>
+class BasicNode{
+public:
+    template <class K, K Lo, K Hi, class P, class N, class O> friend class BasicTree;
+    BasicNode(Key id, const Payload & payload):m_id(id), m_payload(payload) {
+        m_left = nullptr;
+        m_right = nullptr;
+        m_height = DEFAULT_HEIGHT;
+    }
+protected:
+    Key m_id;
+    Payload m_payload;
+    Self* m_left;//the pointer to the left child in the BST
+    Self* m_right;//the pointer to the right child in the BST
+    int m_height;//the height of node in the BST
+};
+template <class Key, class Payload>
+class BasicDrone : public BasicNode<Key, Payload, BasicDrone<Key, Payload> >{//nothing but the key, the payload and the links
+public:
+    BasicDrone(Key id, const Payload & payload):BasicNode<Key, Payload, BasicDrone>(id, payload) {}
+};
+// the AVL tree over an ID type, compile time ID bounds and a payload: search, insert, remove
+// and rebalancing of Node, a BasicNode; Show and BasicShow are both built on it. Owner is the
+// class built on it, its pushDown(Node*) runs before a node's kids are read or relinked and its
+// checkNode(Node*, low, high) is what SHOW_CHECK calls, void for a tree with neither. When the
+// bounds are the whole range of Key the range check is compiled out
+template <class Key, Key MinKey, Key MaxKey, class Payload, class Node, class Owner = void>
+class BasicTree{
+public:
+    static constexpr bool CHECKS_RANGE = MinKey != numeric_limits<Key>::min() || MaxKey != numeric_limits<Key>::max();
+
+    static constexpr bool inRange(Key id) {
+        if constexpr (CHECKS_RANGE) {
+            return MinKey <= id && id <= MaxKey;
+        }
+        else {
+            return true;
+        }
+    }
+    int height() const {return findHeight(m_root);}
+
+protected:
+    Node* m_root;//the root of the BST
+
+    BasicTree() {m_root = nullptr;}
+
+    Node * findHelper(Key id, Node *curr) const {
+        while (curr != nullptr && curr->m_id != id) {
+            curr = (id < curr->m_id) ? curr->m_left : curr->m_right;
+        }
+        return curr;
+    }
+    Node * accessHelper(Key id, Node *curr) { // same as findHelper but pushes pending values on the way down
+        while (curr != nullptr && curr->m_id != id) {
+            pushDown(curr);
+            curr = (id < curr->m_id) ? curr->m_left : curr->m_right;
+        }
+        pushDown(curr);
+        return curr;
+    }
+    Node * insertHelper(Node *aNode, Node *curr, bool & added) { // links aNode unless its ID is taken
+        pushDown(curr);
+        if (curr == nullptr) {
+            added = true;
+            return aNode;
+        }
+        if (aNode->m_id < curr->m_id) {
+            curr->m_left = insertHelper(aNode, curr->m_left, added);
+        }
+        else if (curr->m_id < aNode->m_id) {
+            curr->m_right = insertHelper(aNode, curr->m_right, added);
+        }
+        else { // no duplicates
+            return curr;
+        }
+        fixHeight(curr); // the subtrees below are already correct
+        return rebalanceHelper(curr);
+    }
+    // unlinks id's node into removed, which stays nullptr if there is none, and returns the new
+    // subtree root; the caller deletes it, its payload is exact as the whole path was pushed
+    Node * removeHelper(Node *curr, Key id, Node *& removed) {
+        pushDown(curr);
+        if (curr == nullptr) {
+            return curr;
+        }
+        if (id < curr->m_id) {
+            curr->m_left = removeHelper(curr->m_left, id, removed);
+        }
+        else if (curr->m_id < id) {
+            curr->m_right = removeHelper(curr->m_right, id, removed);
+        }
+        else {
+            removed = curr;
+            if (curr->m_left == nullptr || curr->m_right == nullptr) {
+                return (curr->m_left == nullptr) ? curr->m_right : curr->m_left;
+            }
+            Node *successor = nullptr; // the successor node itself takes curr's place, nodes never change their ID
+            Node *right = detachMin(curr->m_right, successor);
+            successor->m_left = curr->m_left;
+            successor->m_right = right;
+            curr->m_left = nullptr;
+            curr->m_right = nullptr;
+            curr = successor;
+        }
+        fixHeight(curr);
+        return rebalanceHelper(curr);
+    }
+    // unlinks the smallest node of a subtree and returns the new subtree root,
+    // walks down and back up with a stack instead of calling removeHelper again
+    Node * detachMin(Node *curr, Node *& minNode) {
+        Node *path[MAX_DEPTH];
+        int depth = 0;
+
+        pushDown(curr);
+        while (curr->m_left != nullptr) {
+            path[depth++] = curr;
+            curr = curr->m_left;
+            pushDown(curr);
+        }
+        minNode = curr;
+
+        Node *child = curr->m_right; // the successor's only possible kid moves up
+        minNode->m_right = nullptr;
+        while (depth > 0) { // fix heights and rebalance back up the path
+            Node *parent = path[--depth];
+            parent->m_left = child;
+            fixHeight(parent);
+            child = rebalanceHelper(parent);
+        }
+        return child;
+    }
+    Node * rebalanceHelper(Node *curr) { // returns the new subtree root, the caller relinks it
+        int balance = helpBalance(curr);
+
+        if (balance < -1) {
+            if (helpBalance(curr->m_right) > 0) { // Left Right case
+                curr->m_right = helpRightRightRotate(curr->m_right);
+            }
+            curr = helpLeftLeftRotate(curr); // Left Left case
+        }
+        else if (balance > 1) {
+            if (helpBalance(curr->m_left) < 0) { // Right Left case
+                curr->m_left = helpLeftLeftRotate(curr->m_left);
+            }
+            curr = helpRightRightRotate(curr); // Right Right case
+        }
+
+        SHOW_CHECK(curr, MinKey, MaxKey); // curr and the kids a rotation gave it
+        return curr;
+    }
+    Node * helpRightRightRotate(Node *curr) { // right rotation
+        Node *temp = curr->m_left;
+        pushDown(curr); // pending values can't follow the nodes into their new places
+        pushDown(temp);
+        curr->m_left = temp->m_right;
+        temp->m_right = curr;
+        fixHeight(curr); // curr is now below temp so it goes first
+        fixHeight(temp);
+        return temp;
+    }
+    Node * helpLeftLeftRotate(Node *curr) { // left rotation
+        Node *temp = curr->m_right;
+        pushDown(curr);
+        pushDown(temp);
+        curr->m_right = temp->m_left;
+        temp->m_left = curr;
+        fixHeight(curr);
+        fixHeight(temp);
+        return temp;
+    }
+    static int helpBalance(const Node *curr) {
+        return curr == nullptr ? 0 : findHeight(curr->m_left) - findHeight(curr->m_right);
+    }
+    static int findHeight(const Node *curr) {return curr == nullptr ? -1 : curr->m_height;}
+    static void fixHeight(Node *curr) { // recomputes only curr's height from its kids stored heights
+        int leftSide = findHeight(curr->m_left);
+        int rightSide = findHeight(curr->m_right);
+        curr->m_height = (leftSide > rightSide ? leftSide : rightSide) + 1;
+    }
+    void helpClear(Node *curr) {
+        if (curr != nullptr) {
+            helpClear(curr->m_left);
+            helpClear(curr->m_right);
+            delete curr;
+        }
+    }
+    Node * helpCopy(const Node *curr) { // the copies keep everything the node class copies
+        if (curr == nullptr) {
+            return nullptr;
+        }
+        Node *copy = new Node(*curr);
+        copy->m_left = helpCopy(curr->m_left);
+        copy->m_right = helpCopy(curr->m_right);
+        return copy;
+    }
+    template <class Visit>
+    void forEachHelper(const Node *curr, Visit & visit) const {
+        if (curr != nullptr) {
+            forEachHelper(curr->m_left, visit);
+            visit(curr->m_id, curr->m_payload);
+            forEachHelper(curr->m_right, visit);
+        }
+    }
+    static Payload & payloadOf(Node *curr) {return curr->m_payload;}
+    static int countNodes(const Node *curr) {
+        return curr == nullptr ? 0 : 1 + countNodes(curr->m_left) + countNodes(curr->m_right);
+    }
+    static bool testBalance(const Node *curr) { // every node's kids differ in height by at most one
+        if (curr == nullptr) {
+            return true;
+        }
+        int balanced = findHeight(curr->m_left) - findHeight(curr->m_right);
+        return balanced >= -1 && balanced <= 1 && testBalance(curr->m_left) && testBalance(curr->m_right);
+    }
+    static bool testBSTProperty(const Node *curr) { // every node's kids are on the right side of it
+        if (curr == nullptr) {
+            return true;
+        }
+        bool result = testBSTProperty(curr->m_left) && testBSTProperty(curr->m_right);
+        result = result && (curr->m_left == nullptr || curr->m_left->m_id < curr->m_id);
+        return result && (curr->m_right == nullptr || curr->m_id < curr->m_right->m_id);
+    }
+
+private:
+    // the Owner's hooks, both do nothing for a tree without one
+    void pushDown(Node *curr) {
+        if constexpr (!is_void<Owner>::value) {
+            static_cast<Owner*>(this)->pushDown(curr);
+        }
+    }
+    void checkNode(Node *curr, Key low, Key high) {
+        if constexpr (!is_void<Owner>::value) {
+            static_cast<Owner*>(this)->checkNode(curr, low, high);
+        }
+    }
+};
+// the plain tree on the core: the key and the payload, nothing else kept per drone
+template <class Key, Key MinKey, Key MaxKey, class Payload>
+class BasicShow : public BasicTree<Key, MinKey, MaxKey, Payload, BasicDrone<Key, Payload> >{
+public:
+    friend class Tester;
+    typedef BasicDrone<Key, Payload> Node;
+    typedef BasicTree<Key, MinKey, MaxKey, Payload, Node> Tree;
+
+    BasicShow() {m_size = 0;}
+    BasicShow(const BasicShow & rhs) {this->m_root = this->helpCopy(rhs.m_root); m_size = rhs.m_size;}
+    BasicShow(BasicShow && rhs) noexcept {this->m_root = rhs.m_root; m_size = rhs.m_size; rhs.m_root = nullptr; rhs.m_size = 0;}
+    ~BasicShow() {clear();}
+    const BasicShow & operator=(const BasicShow & rhs) {
+        if (this != &rhs) {
+            clear();
+            this->m_root = this->helpCopy(rhs.m_root);
+            m_size = rhs.m_size;
+        }
+        return *this;
+    }
+    BasicShow & operator=(BasicShow && rhs) noexcept {
+        if (this != &rhs) {
+            clear();
+            this->m_root = rhs.m_root;
+            m_size = rhs.m_size;
+            rhs.m_root = nullptr;
+            rhs.m_size = 0;
+        }
+        return *this;
+    }
+
+    bool insert(Key id, const Payload & payload) {//false for a duplicate or an ID out of range
+        if (!Tree::inRange(id)) {
+            return false;
+        }
+        bool added = false;
+        Node *aNode = new Node(id, payload);
+        this->m_root = this->insertHelper(aNode, this->m_root, added);
+        if (!added) {
+            delete aNode;
+        }
+        m_size += added;
+        return added;
+    }
+    bool remove(Key id) {
+        Node *removed = nullptr;
+        this->m_root = this->removeHelper(this->m_root, id, removed);
+        delete removed;
+        m_size -= (removed != nullptr);
+        return removed != nullptr;
+    }
+    void clear() {this->helpClear(this->m_root); this->m_root = nullptr; m_size = 0;}
+    bool findDrone(Key id) const {return this->findHelper(id, this->m_root) != nullptr;}
+    const Payload * find(Key id) const {
+        Node *curr = this->findHelper(id, this->m_root);
+        return curr == nullptr ? nullptr : &this->payloadOf(curr);
+    }
+    Payload * find(Key id) {return const_cast<Payload*>(static_cast<const BasicShow*>(this)->find(id));}
+    long long size() const {return m_size;}
+
+    template <class Visit>
+    void forEach(Visit visit) const {this->forEachHelper(this->m_root, visit);}//visit(id, payload) in ascending ID order
+    template <class Match>
+    long long removeIf(Match match) {//removes every drone match(id, payload) is true for
+        vector<Key> doomed;
+        forEach([&doomed, &match](Key id, const Payload & payload) {
+            if (match(id, payload)) {
+                doomed.push_back(id);
+            }
+        });
+        for (int i = 0; i < (int)doomed.size(); i++) {
+            remove(doomed[i]);
+        }
+        return (long long)doomed.size();
+    }
+
+private:
+    long long m_size;
+};
+#endif
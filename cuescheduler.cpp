@@ -0,0 +1,216 @@
+#include "cuescheduler.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <thread>
+
+CueScheduler::CueScheduler(Show & show, double tickSeconds):m_show(show){
+    m_tickSeconds = tickSeconds > 0 ? tickSeconds : CUE_TICK;
+    m_now = 0;
+    m_running = false;
+    m_free = NO_CUE;
+    m_pending = 0;
+    m_applied = 0;
+    m_updates = 0;
+    m_cascaded = 0;
+    for (int level = 0; level < CUE_LEVELS; level++) {
+        for (int slot = 0; slot < CUE_SLOTS; slot++) {
+            m_wheel[level][slot].head = NO_CUE;
+            m_wheel[level][slot].tail = NO_CUE;
+        }
+    }
+}
+
+CueScheduler::~CueScheduler(){
+#if defined(__cpp_impl_coroutine)
+    for (int level = 0; level < CUE_LEVELS; level++) {
+        for (int slot = 0; slot < CUE_SLOTS; slot++) {
+            for (int cue = m_wheel[level][slot].head; cue != NO_CUE; cue = m_cues[cue].next) {
+                if (m_cues[cue].kind == CUE_RESUME) {
+                    coroutine_handle<>::from_address(m_cues[cue].coroutine).destroy();
+                }
+            }
+        }
+    }
+#endif
+}
+
+long long CueScheduler::toTick(double seconds) const{
+    return llround(seconds / m_tickSeconds);
+}
+
+void CueScheduler::cueState(double seconds, int lo, int hi, STATE state){
+    cueStateAt(toTick(seconds), lo, hi, state);
+}
+
+void CueScheduler::cueColor(double seconds, int lo, int hi, LIGHTCOLOR color){
+    cueColorAt(toTick(seconds), lo, hi, color);
+}
+
+void CueScheduler::cueStateAt(long long tick, int lo, int hi, STATE state){
+    if (lo <= hi) {
+        schedule(tick, CUE_STATE, lo, hi, state, nullptr);
+    }
+}
+
+void CueScheduler::cueColorAt(long long tick, int lo, int hi, LIGHTCOLOR color){
+    if (lo <= hi) {
+        schedule(tick, CUE_COLOR, lo, hi, color, nullptr);
+    }
+}
+
+void CueScheduler::advance(long long ticks){
+    for (long long i = 0; i < ticks; i++) {
+        runTick();
+    }
+}
+
+void CueScheduler::runUntil(long long tick){
+    while (m_now < tick) {
+        runTick();
+    }
+}
+
+// sleeps until each tick is due, how late the thread wakes up and how long the tick
+// before took is the jitter a show would see
+double CueScheduler::play(double seconds){
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    long long ticks = toTick(seconds);
+    double latest = 0;
+    for (long long i = 1; i <= ticks; i++) {
+        chrono::steady_clock::time_point planned = start + chrono::duration_cast<chrono::steady_clock::duration>(
+            chrono::duration<double>(i * m_tickSeconds));
+        this_thread::sleep_until(planned);
+        double late = chrono::duration<double>(chrono::steady_clock::now() - planned).count();
+        latest = max(latest, late);
+        runTick();
+    }
+    return latest;
+}
+
+// a cue for a tick that has been run already goes into the next one, or into the
+// current one while it is being run, which is how a resumed coroutine can cue "now"
+void CueScheduler::schedule(long long tick, CUEKIND kind, int lo, int hi, int value, void* coroutine){
+    long long earliest = m_running ? m_now : m_now + 1;
+    int cue = m_free;
+    if (cue == NO_CUE) {
+        cue = (int)m_cues.size();
+        m_cues.push_back(Cue());
+    }
+    else {
+        m_free = m_cues[cue].next;
+    }
+    Cue & aCue = m_cues[cue];
+    aCue.due = tick < earliest ? earliest : tick;
+    aCue.kind = kind;
+    aCue.lo = lo;
+    aCue.hi = hi;
+    aCue.value = value;
+    aCue.coroutine = coroutine;
+    place(cue);
+    m_pending++;
+}
+
+// the level is the highest digit (CUE_BITS bits each) in which the due tick differs from
+// now, the slot is that digit of the due tick; the slot comes up when now reaches the
+// digit, then the cue differs from now only in lower digits and moves down; the lower
+// slots it moves to are empty then and cues are only ever added at the tail, so every
+// slot lists its cues in the order they were scheduled
+void CueScheduler::place(int cue){
+    Cue & aCue = m_cues[cue];
+    int level = CUE_LEVELS - 1;
+    while (level > 0 && (aCue.due >> (CUE_BITS * level)) == (m_now >> (CUE_BITS * level))) {
+        level--;
+    }
+    Slot & slot = m_wheel[level][(aCue.due >> (CUE_BITS * level)) & (CUE_SLOTS - 1)];
+    aCue.next = NO_CUE;
+    if (slot.head == NO_CUE) {
+        slot.head = cue;
+    }
+    else {
+        m_cues[slot.tail].next = cue;
+    }
+    slot.tail = cue;
+}
+
+void CueScheduler::cascade(int level){
+    Slot & slot = m_wheel[level][(m_now >> (CUE_BITS * level)) & (CUE_SLOTS - 1)];
+    int cue = slot.head;
+    slot.head = NO_CUE;
+    slot.tail = NO_CUE;
+    while (cue != NO_CUE) {
+        int next = m_cues[cue].next;
+        place(cue);
+        m_cascaded++;
+        cue = next;
+    }
+}
+
+void CueScheduler::runTick(){
+    m_now++;
+    for (int level = CUE_LEVELS - 1; level > 0; level--) { // higher levels first, they may fill the lower ones
+        if ((m_now & ((1LL << (CUE_BITS * level)) - 1)) == 0) {
+            cascade(level);
+        }
+    }
+    m_running = true;
+    Slot & slot = m_wheel[0][m_now & (CUE_SLOTS - 1)];
+    while (slot.head != NO_CUE) { // cues resumed coroutines add for now come round again
+        int cue = slot.head;
+        slot.head = NO_CUE;
+        slot.tail = NO_CUE;
+        int kind = CUE_RESUME; // the range being merged, CUE_RESUME when there is none
+        int lo = 0;
+        int hi = 0;
+        int value = 0;
+        while (cue != NO_CUE) {
+            Cue aCue = m_cues[cue]; // a copy, a coroutine may grow m_cues
+            m_cues[cue].next = m_free;
+            m_free = cue;
+            cue = aCue.next;
+            m_pending--;
+            m_applied++;
+            if (aCue.kind != CUE_RESUME && aCue.kind == kind && aCue.value == value && aCue.lo <= hi + 1 && lo - 1 <= aCue.hi) {
+                lo = min(lo, aCue.lo);
+                hi = max(hi, aCue.hi);
+                continue;
+            }
+            if (kind != CUE_RESUME) {
+                update(kind, lo, hi, value);
+            }
+            kind = aCue.kind;
+            lo = aCue.lo;
+            hi = aCue.hi;
+            value = aCue.value;
+#if defined(__cpp_impl_coroutine)
+            if (aCue.kind == CUE_RESUME) { // the show is up to date when it runs
+                coroutine_handle<>::from_address(aCue.coroutine).resume();
+            }
+#endif
+        }
+        if (kind != CUE_RESUME) {
+            update(kind, lo, hi, value);
+        }
+    }
+    m_running = false;
+}
+
+void CueScheduler::update(int kind, int lo, int hi, int value){ // one drone goes through the cached path
+    if (kind == CUE_STATE) {
+        if (lo == hi) {
+            m_show.setState(lo, static_cast<STATE>(value));
+        }
+        else {
+            m_show.setStateRange(lo, hi, static_cast<STATE>(value));
+        }
+    }
+    else {
+        if (lo == hi) {
+            m_show.setColor(lo, static_cast<LIGHTCOLOR>(value));
+        }
+        else {
+            m_show.setColorRange(lo, hi, static_cast<LIGHTCOLOR>(value));
+        }
+    }
+    m_updates++;
+}
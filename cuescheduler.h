@@ -0,0 +1,99 @@
+#ifndef CUESCHEDULER_H
+#define CUESCHEDULER_H
+#include "show.h"
+#if defined(__cpp_impl_coroutine)
+#include <coroutine>
+#endif
+using namespace std;
+#define CUE_TICK 0.01 // seconds in one tick of the wheel
+#define CUE_BITS 8 // a wheel level has 2^CUE_BITS slots
+#define CUE_SLOTS (1 << CUE_BITS)
+#define CUE_LEVELS 4 // cues up to 2^32 ticks ahead, more than a year of 10 ms ticks
+#define NO_CUE -1 // end of a slot's list
+// light cues for a Show kept in a hierarchical timer wheel: level 0 has a slot for every one
+// of the next CUE_SLOTS ticks, each higher level a slot for CUE_SLOTS times as many, so a cue
+// is put into a slot in O(1) and moves down a level when its slot comes up; every cue due in
+// a tick is applied in one pass, in the order it was scheduled, with neighbouring ranges that
+// set the same value merged into one range update; the clock only moves when advance() or
+// runUntil() is called, which makes offline runs deterministic, play() follows the real clock
+class CueScheduler{
+public:
+    friend class Tester;
+    CueScheduler(Show & show, double tickSeconds = CUE_TICK);
+    ~CueScheduler();//destroys the coroutines still waiting
+    CueScheduler(const CueScheduler & rhs) = delete;
+    const CueScheduler & operator=(const CueScheduler & rhs) = delete;
+
+    long long now() const {return m_now;}//the last tick that was run
+    long long toTick(double seconds) const;//the tick a time in seconds falls on
+    void cueState(double seconds, int lo, int hi, STATE state);//at seconds, drones lo to hi
+    void cueColor(double seconds, int lo, int hi, LIGHTCOLOR color);
+    void cueStateAt(long long tick, int lo, int hi, STATE state);
+    void cueColorAt(long long tick, int lo, int hi, LIGHTCOLOR color);
+    void advance(long long ticks = 1);//runs the next ticks on the simulated clock
+    void runUntil(long long tick);
+    double play(double seconds);//runs in real time, returns the latest a tick started in seconds
+
+    long long pending() const {return m_pending;}//cues not applied yet
+    long long getApplied() const {return m_applied;}
+    long long getUpdates() const {return m_updates;}//calls into the Show after merging
+    long long getCascaded() const {return m_cascaded;}//times a cue moved down a level
+
+#if defined(__cpp_impl_coroutine)
+    // a cue written as a coroutine, it runs until its first co_await and is resumed by the
+    // tick it waits for, in the same pass as the light cues of that tick
+    struct Task{
+        struct promise_type{
+            Task get_return_object() {return Task();}
+            suspend_never initial_suspend() noexcept {return suspend_never();}
+            suspend_never final_suspend() noexcept {return suspend_never();}
+            void return_void() {}
+            void unhandled_exception() {}
+        };
+    };
+    struct Wait{
+        CueScheduler *scheduler;
+        long long tick;
+        bool await_ready() const {return tick <= scheduler->m_now && scheduler->m_running;}
+        void await_suspend(coroutine_handle<> waiting) {scheduler->schedule(tick, CUE_RESUME, 0, 0, 0, waiting.address());}
+        void await_resume() const {}
+    };
+    Wait at(double seconds) {return Wait{this, toTick(seconds)};}//co_await it
+    Wait after(double seconds) {return Wait{this, m_now + toTick(seconds)};}
+    Show & show() {return m_show;}
+#endif
+
+private:
+    enum CUEKIND {CUE_STATE, CUE_COLOR, CUE_RESUME};
+    struct Cue{
+        long long due;
+        int kind;
+        int lo;
+        int hi;
+        int value;
+        void* coroutine;//handle address of a CUE_RESUME
+        int next;//the next cue in the same slot, or the next free cue
+    };
+    struct Slot{
+        int head;
+        int tail;
+    };
+    Show & m_show;
+    double m_tickSeconds;
+    long long m_now;
+    bool m_running;//inside runTick, cues due now still go into this tick
+    vector<Cue> m_cues;//pool, the free ones are linked through next
+    int m_free;
+    Slot m_wheel[CUE_LEVELS][CUE_SLOTS];
+    long long m_pending;
+    long long m_applied;
+    long long m_updates;
+    long long m_cascaded;
+
+    void schedule(long long tick, CUEKIND kind, int lo, int hi, int value, void* coroutine);
+    void place(int cue);//into the lowest level whose range reaches its due tick
+    void runTick();//moves m_now on by one tick and applies what is due
+    void cascade(int level);
+    void update(int kind, int lo, int hi, int value);
+};
+#endif
@@ -0,0 +1,122 @@
+#include "droneevents.h"
+#include <chrono>
+#include <algorithm>
+
+DroneEventQueue::DroneEventQueue(int capacity){
+    long long size = 1;
+    while (size < capacity) {
+        size *= 2;
+    }
+    m_cells.reset(new Cell[size]);
+    for (long long i = 0; i < size; i++) {
+        m_cells[i].sequence.store(i, memory_order_relaxed);
+    }
+    m_mask = size - 1;
+    m_tail.store(0);
+    m_head = 0;
+    m_pushed.store(0);
+    m_rejected.store(0);
+    m_drained = 0;
+    m_coalesced = 0;
+    m_maxDepth = 0;
+    m_totalLatency = 0;
+    m_maxLatency = 0;
+    m_last.assign(MAXID - MINID + 1, -1);
+}
+
+bool DroneEventQueue::push(int id, EVENTTYPE type){
+    long long position = m_tail.load(memory_order_relaxed);
+    while (true) {
+        Cell &cell = m_cells[position & m_mask];
+        long long sequence = cell.sequence.load(memory_order_acquire);
+        long long difference = sequence - position;
+        if (difference == 0) { // cell is free for this position, try to claim it
+            if (m_tail.compare_exchange_weak(position, position + 1, memory_order_relaxed)) {
+                cell.event.id = id;
+                cell.event.type = type;
+                cell.event.stamp = now();
+                cell.sequence.store(position + 1, memory_order_release); // hands it to the owner
+                m_pushed.fetch_add(1, memory_order_relaxed);
+                return true;
+            }
+        }
+        else if (difference < 0) { // the owner hasn't read this cell from the last lap yet
+            m_rejected.fetch_add(1, memory_order_relaxed);
+            return false;
+        }
+        else { // another producer claimed it, catch up
+            position = m_tail.load(memory_order_relaxed);
+        }
+    }
+}
+
+// takes up to maxEvents events, keeps only the last one per ID, and applies them in ID order,
+// a battery failure removes the drone so any light event after it in the batch is dropped too
+int DroneEventQueue::drain(Show & aShow, int maxEvents){
+    int depth = (int)(m_tail.load(memory_order_relaxed) - m_head);
+    if (depth > m_maxDepth) {
+        m_maxDepth = depth;
+    }
+
+    m_batch.clear();
+    while ((int)m_batch.size() < maxEvents) {
+        Cell &cell = m_cells[m_head & m_mask];
+        if (cell.sequence.load(memory_order_acquire) != m_head + 1) { // not written yet
+            break;
+        }
+        m_batch.push_back(cell.event);
+        cell.sequence.store(m_head + m_mask + 1, memory_order_release); // free for the next lap
+        m_head++;
+    }
+
+    vector<int> ids;
+    for (int i = 0; i < (int)m_batch.size(); i++) {
+        int id = m_batch[i].id;
+        if (id < MINID || id > MAXID) {
+            continue;
+        }
+        int &last = m_last[id - MINID];
+        if (last == -1) {
+            ids.push_back(id);
+            last = i;
+        }
+        else {
+            m_coalesced++;
+            if (m_batch[last].type != EVENT_BATTERYFAIL) { // a failure can't be undone by a later event
+                last = i;
+            }
+        }
+    }
+    sort(ids.begin(), ids.end());
+    for (int i = 0; i < (int)ids.size(); i++) {
+        const DroneEvent &event = m_batch[m_last[ids[i] - MINID]];
+        switch (event.type) {
+            case EVENT_LIGHTON: aShow.setState(event.id, LIGHTON); break;
+            case EVENT_LIGHTOFF: aShow.setState(event.id, LIGHTOFF); break;
+            default: aShow.remove(event.id); break;
+        }
+        m_last[ids[i] - MINID] = -1;
+    }
+
+    long long applied = now();
+    for (int i = 0; i < (int)m_batch.size(); i++) {
+        long long latency = applied - m_batch[i].stamp;
+        m_totalLatency += latency;
+        if (latency > m_maxLatency) {
+            m_maxLatency = latency;
+        }
+    }
+    m_drained += m_batch.size();
+    return (int)m_batch.size();
+}
+
+double DroneEventQueue::getAverageLatency() const{
+    if (m_drained == 0) {
+        return 0.0;
+    }
+    return (double)m_totalLatency / m_drained / 1e9;
+}
+
+long long DroneEventQueue::now(){
+    return chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now().time_since_epoch()).count();
+}
@@ -0,0 +1,52 @@
+#ifndef DRONEEVENTS_H
+#define DRONEEVENTS_H
+#include "show.h"
+#include <atomic>
+#include <memory>
+using namespace std;
+enum EVENTTYPE {EVENT_LIGHTON, EVENT_LIGHTOFF, EVENT_BATTERYFAIL};
+struct DroneEvent{
+    int id;
+    EVENTTYPE type;
+    long long stamp;//steady clock nanoseconds when it was pushed
+};
+// bounded lock-free queue, any number of telemetry threads push and one owner thread
+// drains the events into its Show, each cell carries a sequence number that tells
+// producers and the consumer whose turn it is (Vyukov's bounded queue)
+class DroneEventQueue{
+public:
+    DroneEventQueue(int capacity);//rounded up to a power of two
+    bool push(int id, EVENTTYPE type);//false when the queue is full, nothing is written
+    int drain(Show & aShow, int maxEvents);//owner thread only, returns the events taken
+
+    // statistics, read them from the owner thread
+    long long getPushed() const {return m_pushed.load();}
+    long long getRejected() const {return m_rejected.load();}//pushes that found the queue full
+    long long getDrained() const {return m_drained;}
+    long long getCoalesced() const {return m_coalesced;}//events replaced by a later one for the same ID
+    int getMaxDepth() const {return m_maxDepth;}//most events seen waiting at one drain
+    double getAverageLatency() const;//seconds from push to being applied
+    double getMaxLatency() const {return m_maxLatency / 1e9;}
+
+    static long long now();
+
+private:
+    struct Cell{
+        atomic<long long> sequence;
+        DroneEvent event;
+    };
+    unique_ptr<Cell[]> m_cells;
+    long long m_mask;
+    alignas(64) atomic<long long> m_tail;//next position producers claim
+    alignas(64) long long m_head;//next position the owner reads
+    atomic<long long> m_pushed;
+    atomic<long long> m_rejected;
+    long long m_drained;
+    long long m_coalesced;
+    int m_maxDepth;
+    long long m_totalLatency;//nanoseconds
+    long long m_maxLatency;
+    vector<DroneEvent> m_batch;//reused by drain
+    vector<int> m_last;//per ID, position of its last event in m_batch, -1 if none
+};
+#endif
@@ -0,0 +1,101 @@
+#ifndef FORMATION_H
+#define FORMATION_H
+#include "show.h"
+#include <array>
+using namespace std;
+// a fixed set of drones worked out by the compiler: the constructor sorts the list, drops
+// duplicates (the first one wins) and IDs out of range like Show::insert, and lays the IDs
+// out in Eytzinger order like Show::freeze, so a constexpr Formation is a ready made search
+// structure in the binary; toShow() builds a balanced Show from it without any rotations
+template <int N>
+class Formation{
+public:
+    friend class Tester;
+    constexpr Formation(const DroneChange (&drones)[N]) {build(drones);}
+    constexpr Formation(const array<DroneChange, N> & drones) {build(drones.data());}
+
+    constexpr int size() const {return m_size;}
+    constexpr bool findDrone(int id) const {
+        int k = 1;
+        while (k <= m_size) { // no early exit, like Show::frozenFind
+            k = 2 * k + (m_ids[k] < id);
+        }
+        while (k & 1) { // undoes the right turns taken after the last left turn
+            k >>= 1;
+        }
+        k >>= 1;
+        return k != 0 && m_ids[k] == id;
+    }
+    constexpr int countDrones(LIGHTCOLOR aColor) const {return m_colorCount[aColor];}
+    constexpr int countDrones(STATE aState) const {return m_stateCount[aState];}
+    constexpr const DroneChange & operator[](int i) const {return m_sorted[i];}//i-th lowest ID
+    Show toShow() const {//the middle drone of every range becomes its root, so it is balanced already
+        Show show;
+        show.load(vector<DroneChange>(m_sorted, m_sorted + m_size));
+        return show;
+    }
+
+private:
+    DroneChange m_sorted[N] = {};//ascending IDs
+    int m_ids[N + 1] = {};//Eytzinger order, entry k has its kids at 2k and 2k+1, entry 0 is unused
+    int m_size = 0;
+    int m_colorCount[NUMCOLORS] = {};
+    int m_stateCount[NUMSTATES] = {};
+
+    constexpr void build(const DroneChange * drones) {
+        int order[N > 0 ? N : 1] = {};//positions in drones, sorted by ID and then by position
+        for (int i = 0; i < N; i++) {
+            order[i] = i;
+        }
+        for (int i = N / 2 - 1; i >= 0; i--) { // heap sort, the compiler runs it in O(N log N)
+            siftDown(drones, order, i, N);
+        }
+        for (int end = N - 1; end > 0; end--) {
+            int top = order[0];
+            order[0] = order[end];
+            order[end] = top;
+            siftDown(drones, order, 0, end);
+        }
+        for (int i = 0; i < N; i++) {
+            const DroneChange & drone = drones[order[i]];
+            bool duplicate = m_size > 0 && m_sorted[m_size - 1].id == drone.id;
+            if (MINID <= drone.id && drone.id <= MAXID && !duplicate) {
+                m_sorted[m_size++] = drone;
+                m_colorCount[drone.type]++;
+                m_stateCount[drone.state]++;
+            }
+        }
+        int next = 0;
+        fill(next, 1);
+    }
+    static constexpr bool before(const DroneChange * drones, int a, int b) {
+        return drones[a].id < drones[b].id || (drones[a].id == drones[b].id && a < b);
+    }
+    static constexpr void siftDown(const DroneChange * drones, int * order, int root, int end) {
+        while (2 * root + 1 < end) {
+            int child = 2 * root + 1;
+            if (child + 1 < end && before(drones, order[child], order[child + 1])) {
+                child++;
+            }
+            if (!before(drones, order[root], order[child])) {
+                return;
+            }
+            int swapped = order[root];
+            order[root] = order[child];
+            order[child] = swapped;
+            root = child;
+        }
+    }
+    constexpr void fill(int & next, int k) { // in-order walk of the implicit tree
+        if (k <= m_size) {
+            fill(next, 2 * k);
+            m_ids[k] = m_sorted[next++].id;
+            fill(next, 2 * k + 1);
+        }
+    }
+};
+template <int N>
+Formation(const DroneChange (&drones)[N]) -> Formation<N>;
+template <size_t N>
+Formation(const array<DroneChange, N> & drones) -> Formation<(int)N>;
+#endif
@@ -0,0 +1,253 @@
+#include "framecodec.h"
+#include <cstring>
+
+FrameEncoder::FrameEncoder(){
+    m_previous = new unsigned long long[(NUMCOLORS + NUMSTATES) * INDEX_WORDS](); // all zero
+    m_sequence = 0;
+}
+
+FrameEncoder::~FrameEncoder(){
+    delete [] m_previous;
+}
+
+long long FrameEncoder::maxBytes(){
+    long long values = ((long long)(MAXID - MINID + 1) * FRAME_BITS + 63) / 64;
+    return sizeof(FrameHeader) + (FRAME_SUMMARY + INDEX_WORDS + values) * sizeof(unsigned long long);
+}
+
+void FrameEncoder::reset(){
+    memset(m_previous, 0, (NUMCOLORS + NUMSTATES) * INDEX_WORDS * sizeof(unsigned long long));
+}
+
+struct SpreadTable{//bit i of the index moves to bit FRAME_BITS * i
+    unsigned long long bits[256];
+    SpreadTable() {
+        for (int i = 0; i < 256; i++) {
+            bits[i] = 0;
+            for (int bit = 0; bit < 8; bit++) {
+                bits[i] |= (unsigned long long)(i >> bit & 1) << (FRAME_BITS * bit);
+            }
+        }
+    }
+};
+static const SpreadTable spread;
+
+// two passes over the bitmaps, one to find the words and the size, one to write them,
+// the values of a word come from three planes so each one is a few shifts, and a word
+// with every ID in it spreads the planes a byte at a time
+long long FrameEncoder::encode(const Show & aShow, unsigned char * buffer, long long capacity, FRAMEKIND kind){
+    static const unsigned long long none[(NUMCOLORS + NUMSTATES) * INDEX_WORDS] = {0};
+    const unsigned long long *current = aShow.m_index != nullptr ? aShow.m_index : none;
+    const unsigned long long *red = current;
+    const unsigned long long *green = current + INDEX_WORDS;
+    const unsigned long long *blue = current + 2 * INDEX_WORDS;
+    const unsigned long long *off = current + (NUMCOLORS + LIGHTOFF) * INDEX_WORDS;
+
+    unsigned long long summary[FRAME_SUMMARY] = {0};
+    long long count = 0;
+    long long words = 0;
+    for (int word = 0; word < INDEX_WORDS; word++) {
+        unsigned long long bits = red[word] | green[word] | blue[word];
+        if (kind == FRAME_DELTA) {
+            bits = 0;
+            for (int which = 0; which < NUMCOLORS + NUMSTATES; which++) {
+                bits |= current[which * INDEX_WORDS + word] ^ m_previous[which * INDEX_WORDS + word];
+            }
+        }
+        if (bits != 0) {
+            summary[word / 64] |= 1ULL << (word % 64);
+            count += __builtin_popcountll(bits);
+            words++;
+        }
+    }
+    long long bytes = sizeof(FrameHeader) + (FRAME_SUMMARY + words + (count * FRAME_BITS + 63) / 64) * sizeof(unsigned long long);
+    if (buffer == nullptr || bytes > capacity) {
+        return -1;
+    }
+
+    FrameHeader header;
+    header.magic = FRAME_MAGIC;
+    header.kind = kind;
+    header.sequence = m_sequence;
+    header.count = (unsigned)count;
+    memcpy(buffer, &header, sizeof(FrameHeader));
+    memcpy(buffer + sizeof(FrameHeader), summary, sizeof(summary));
+    unsigned char *bitmap = buffer + sizeof(FrameHeader) + sizeof(summary);
+    unsigned char *values = bitmap + words * sizeof(unsigned long long);
+    unsigned long long pending = 0; // values not written yet, from the low bits up
+    int used = 0;
+    auto put = [&pending, &used, &values](unsigned long long value, int width) {
+        pending |= value << used;
+        used += width;
+        if (used >= 64) {
+            memcpy(values, &pending, sizeof(pending));
+            values += sizeof(pending);
+            used -= 64;
+            pending = value >> (width - used);
+        }
+    };
+    for (int word = 0; word < INDEX_WORDS; word++) {
+        if ((summary[word / 64] >> (word % 64) & 1) == 0) {
+            continue;
+        }
+        unsigned long long present = red[word] | green[word] | blue[word];
+        unsigned long long bits = present;
+        if (kind == FRAME_DELTA) {
+            bits = 0;
+            for (int which = 0; which < NUMCOLORS + NUMSTATES; which++) {
+                bits |= current[which * INDEX_WORDS + word] ^ m_previous[which * INDEX_WORDS + word];
+            }
+        }
+        memcpy(bitmap, &bits, sizeof(bits));
+        bitmap += sizeof(bits);
+        // value bit 0 is the state, bits 1 and 2 the color, a drone that isn't there has all three
+        unsigned long long plane0 = off[word] | ~present;
+        unsigned long long plane1 = green[word] | ~present;
+        unsigned long long plane2 = blue[word] | ~present;
+        if (bits == ~0ULL) { // every ID of the word, 8 at a time through the table
+            for (int shift = 0; shift < 64; shift += 8) {
+                unsigned long long value = spread.bits[plane0 >> shift & 0xFF] | spread.bits[plane1 >> shift & 0xFF] << 1
+                                           | spread.bits[plane2 >> shift & 0xFF] << 2;
+                put(value, 8 * FRAME_BITS);
+            }
+            continue;
+        }
+        while (bits != 0) {
+            int bit = __builtin_ctzll(bits);
+            bits &= bits - 1;
+            put((plane0 >> bit & 1) | (plane1 >> bit & 1) << 1 | (plane2 >> bit & 1) << 2, FRAME_BITS);
+        }
+    }
+    if (used > 0) {
+        memcpy(values, &pending, sizeof(pending));
+    }
+
+    memcpy(m_previous, current, (NUMCOLORS + NUMSTATES) * INDEX_WORDS * sizeof(unsigned long long));
+    m_sequence++;
+    return bytes;
+}
+
+FrameDecoder::FrameDecoder(){
+    m_values.assign(MAXID - MINID + 1, FRAME_GONE);
+    m_size = 0;
+    m_sequence = 0;
+    m_synced = false;
+}
+
+static int readValue(const unsigned char * values, long long i){ // the i-th value of a frame
+    long long at = i * FRAME_BITS;
+    unsigned long long word;
+    memcpy(&word, values + at / 64 * sizeof(word), sizeof(word));
+    unsigned long long value = word >> (at % 64);
+    if (at % 64 > 64 - FRAME_BITS) { // the rest is in the next word
+        memcpy(&word, values + (at / 64 + 1) * sizeof(word), sizeof(word));
+        value |= word << (64 - at % 64);
+    }
+    return (int)(value & ((1 << FRAME_BITS) - 1));
+}
+
+// checks the whole frame before it changes anything
+bool FrameDecoder::decode(const unsigned char * buffer, long long bytes){
+    FrameHeader header;
+    unsigned long long summary[FRAME_SUMMARY];
+    long long start = sizeof(FrameHeader) + sizeof(summary);
+    if (buffer == nullptr || bytes < start) {
+        return false;
+    }
+    memcpy(&header, buffer, sizeof(FrameHeader));
+    memcpy(summary, buffer + sizeof(FrameHeader), sizeof(summary));
+    if (header.magic != FRAME_MAGIC || (header.kind != FRAME_FULL && header.kind != FRAME_DELTA)) {
+        return false;
+    }
+    if (header.kind == FRAME_DELTA && (!m_synced || header.sequence != m_sequence + 1)) {
+        m_synced = false; // a frame went missing, only a full frame helps now
+        return false;
+    }
+    if (INDEX_WORDS % 64 != 0 && summary[FRAME_SUMMARY - 1] >> (INDEX_WORDS % 64) != 0) {
+        return false; // a word past the last ID
+    }
+    long long words = 0;
+    for (int i = 0; i < FRAME_SUMMARY; i++) {
+        words += __builtin_popcountll(summary[i]);
+    }
+    long long valueWords = ((long long)header.count * FRAME_BITS + 63) / 64;
+    if (bytes < start + (words + valueWords) * (long long)sizeof(unsigned long long)) {
+        return false;
+    }
+    const unsigned char *bitmap = buffer + start;
+    const unsigned char *values = bitmap + words * sizeof(unsigned long long);
+    if ((summary[FRAME_SUMMARY - 1] >> ((INDEX_WORDS - 1) % 64) & 1) != 0 && (MAXID - MINID + 1) % 64 != 0) {
+        unsigned long long last; // the bitmap word with MAXID in it is the last one
+        memcpy(&last, bitmap + (words - 1) * sizeof(last), sizeof(last));
+        if (last >> ((MAXID - MINID + 1) % 64) != 0) {
+            return false; // an ID past MAXID
+        }
+    }
+    long long count = 0;
+    for (long long i = 0; i < words; i++) {
+        unsigned long long bits;
+        memcpy(&bits, bitmap + i * sizeof(bits), sizeof(bits));
+        count += __builtin_popcountll(bits);
+    }
+    if (count != header.count) {
+        return false;
+    }
+    for (long long i = 0; i < count; i++) {
+        int value = readValue(values, i);
+        if (value == FRAME_GONE ? header.kind == FRAME_FULL : value >= NUMCOLORS * NUMSTATES) {
+            return false;
+        }
+    }
+
+    if (header.kind == FRAME_FULL) {
+        m_values.assign(m_values.size(), FRAME_GONE);
+        m_size = 0;
+    }
+    long long next = 0;
+    for (int word = 0; word < INDEX_WORDS; word++) {
+        if ((summary[word / 64] >> (word % 64) & 1) == 0) {
+            continue;
+        }
+        unsigned long long bits;
+        memcpy(&bits, bitmap, sizeof(bits));
+        bitmap += sizeof(bits);
+        while (bits != 0) {
+            int id = word * 64 + __builtin_ctzll(bits);
+            bits &= bits - 1;
+            int value = readValue(values, next++);
+            m_size += (value != FRAME_GONE) - (m_values[id] != FRAME_GONE);
+            m_values[id] = (unsigned char)value;
+        }
+    }
+    m_sequence = header.sequence;
+    m_synced = true;
+    return true;
+}
+
+bool FrameDecoder::findDrone(int id) const{
+    return MINID <= id && id <= MAXID && m_values[id - MINID] != FRAME_GONE;
+}
+
+bool FrameDecoder::getDrone(int id, LIGHTCOLOR & color, STATE & state) const{
+    if (!findDrone(id)) {
+        return false;
+    }
+    color = static_cast<LIGHTCOLOR>(m_values[id - MINID] / NUMSTATES);
+    state = static_cast<STATE>(m_values[id - MINID] % NUMSTATES);
+    return true;
+}
+
+vector<DroneChange> FrameDecoder::getDrones() const{
+    vector<DroneChange> drones;
+    drones.reserve(m_size);
+    for (int i = 0; i < (int)m_values.size(); i++) {
+        if (m_values[i] != FRAME_GONE) {
+            DroneChange drone;
+            drone.id = MINID + i;
+            drone.type = static_cast<LIGHTCOLOR>(m_values[i] / NUMSTATES);
+            drone.state = static_cast<STATE>(m_values[i] % NUMSTATES);
+            drones.push_back(drone);
+        }
+    }
+    return drones;
+}
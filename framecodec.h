@@ -0,0 +1,62 @@
+#ifndef FRAMECODEC_H
+#define FRAMECODEC_H
+#include "show.h"
+using namespace std;
+#define FRAME_MAGIC 0x4D415246 // "FRAM"
+#define FRAME_BITS 3 // per drone, color * NUMSTATES + state
+#define FRAME_GONE 7 // a drone a delta frame removes, never a color and state
+#define FRAME_SUMMARY ((INDEX_WORDS + 63) / 64) // words of the bitmap over the ID bitmap words
+enum FRAMEKIND {FRAME_FULL, FRAME_DELTA};
+// the wire format of one frame, 64 bit words are little endian:
+//   header     FrameHeader
+//   summary    FRAME_SUMMARY words, bit w is set when word w of the ID bitmap isn't zero
+//   ID bitmap  the words the summary has a bit for, bit b of word w is ID MINID + 64w + b
+//   values     FRAME_BITS per ID in the bitmap, in ID order, from the low bits of each word up
+// a full frame has every drone of the show in the bitmap, a delta frame only the drones that
+// were added, removed or changed since the frame before
+struct FrameHeader{
+    unsigned magic;
+    unsigned kind;//FRAMEKIND
+    unsigned sequence;//frames the encoder wrote before this one
+    unsigned count;//IDs in the bitmap
+};
+// writes a Show straight from its color and state bitmaps into the caller's buffer,
+// and keeps those bitmaps of the last frame to find what a delta frame has to carry
+class FrameEncoder{
+public:
+    friend class Tester;
+    FrameEncoder();
+    ~FrameEncoder();
+    FrameEncoder(const FrameEncoder & rhs) = delete;
+    const FrameEncoder & operator=(const FrameEncoder & rhs) = delete;
+    // returns the bytes written, or -1 if capacity is too small and nothing was written
+    long long encode(const Show & aShow, unsigned char * buffer, long long capacity, FRAMEKIND kind = FRAME_FULL);
+    static long long maxBytes();//the largest frame there can be
+    unsigned getSequence() const {return m_sequence;}
+    void reset();//the next delta frame starts from an empty show
+
+private:
+    unsigned long long* m_previous;//the index bitmaps of the last frame, same layout as Show's
+    unsigned m_sequence;
+};
+// rebuilds the fleet from full frames and the delta frames that follow them
+class FrameDecoder{
+public:
+    friend class Tester;
+    FrameDecoder();
+    // false for a frame that is torn or corrupt, or a delta frame that doesn't follow the
+    // last frame, the fleet stays as it was and waits for a full frame
+    bool decode(const unsigned char * buffer, long long bytes);
+    bool findDrone(int id) const;
+    bool getDrone(int id, LIGHTCOLOR & color, STATE & state) const;
+    vector<DroneChange> getDrones() const;//ascending IDs
+    int size() const {return m_size;}
+    unsigned getSequence() const {return m_sequence;}
+
+private:
+    vector<unsigned char> m_values;//one per ID, FRAME_GONE if absent
+    int m_size;
+    unsigned m_sequence;
+    bool m_synced;//a full frame came in and no frame was missed since
+};
+#endif
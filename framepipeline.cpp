@@ -0,0 +1,120 @@
+#include "framepipeline.h"
+
+FramePipeline::FramePipeline(){
+    for (int i = 0; i < FRAME_SLOTS; i++) {
+        m_synced[i] = 0;
+    }
+    m_back = 0;
+    m_middle.store(1);
+    m_front = 2;
+    m_logStart = 0;
+    m_published = 0;
+    m_replayed = 0;
+    m_fullCopies = 0;
+}
+
+void FramePipeline::insert(const Drone& aDrone){
+    m_slots[m_back].insert(aDrone);
+    record(OP_INSERT, aDrone, 0, 0);
+}
+
+void FramePipeline::remove(int id){
+    m_slots[m_back].remove(id);
+    record(OP_REMOVE, Drone(id), 0, 0);
+}
+
+bool FramePipeline::setState(int id, STATE state){
+    bool found = m_slots[m_back].setState(id, state);
+    if (found) {
+        record(OP_STATE, Drone(id), 0, state);
+    }
+    return found;
+}
+
+bool FramePipeline::setColor(int id, LIGHTCOLOR color){
+    bool found = m_slots[m_back].setColor(id, color);
+    if (found) {
+        record(OP_COLOR, Drone(id), 0, color);
+    }
+    return found;
+}
+
+void FramePipeline::setStateRange(int lo, int hi, STATE state){
+    m_slots[m_back].setStateRange(lo, hi, state);
+    record(OP_STATERANGE, Drone(lo), hi, state);
+}
+
+void FramePipeline::setColorRange(int lo, int hi, LIGHTCOLOR color){
+    m_slots[m_back].setColorRange(lo, hi, color);
+    record(OP_COLORRANGE, Drone(lo), hi, color);
+}
+
+// swaps the finished back frame into the middle, then catches up the buffer that came
+// back, replaying the log if it is only a few changes behind and copying it otherwise
+void FramePipeline::publish(){
+    long long end = m_logStart + (long long)m_log.size();
+    m_synced[m_back] = end;
+    int published = m_back;
+    m_back = m_middle.exchange(published | FRAME_FRESH) & (FRAME_FRESH - 1);
+    m_published++;
+
+    Show &recycled = m_slots[m_back];
+    long long behind = end - m_synced[m_back];
+    const Show &latest = m_slots[published]; // only read, the reader may be reading it as well
+    if (m_synced[m_back] == NOT_SYNCED || behind > latest.countDrones(LIGHTON) + latest.countDrones(LIGHTOFF)) {
+        recycled = latest;
+        m_fullCopies++;
+    }
+    else {
+        for (long long i = m_synced[m_back]; i < end; i++) {
+            replay(recycled, m_log[i - m_logStart]);
+        }
+        m_replayed += behind;
+    }
+    m_synced[m_back] = end;
+    trimLog();
+}
+
+const Show & FramePipeline::acquire(){
+    if (m_middle.load() & FRAME_FRESH) {
+        m_front = m_middle.exchange(m_front) & (FRAME_FRESH - 1);
+    }
+    return m_slots[m_front];
+}
+
+void FramePipeline::record(OPERATION op, const Drone & aDrone, int hi, int value){
+    Change change;
+    change.op = op;
+    change.hi = hi;
+    change.value = value;
+    change.drone = aDrone;
+    m_log.push_back(change);
+}
+
+void FramePipeline::replay(Show & aShow, const Change & change){
+    switch (change.op) {
+        case OP_INSERT: aShow.insert(change.drone); break;
+        case OP_REMOVE: aShow.remove(change.drone.getID()); break;
+        case OP_STATE: aShow.setState(change.drone.getID(), static_cast<STATE>(change.value)); break;
+        case OP_COLOR: aShow.setColor(change.drone.getID(), static_cast<LIGHTCOLOR>(change.value)); break;
+        case OP_STATERANGE: aShow.setStateRange(change.drone.getID(), change.hi, static_cast<STATE>(change.value)); break;
+        default: aShow.setColorRange(change.drone.getID(), change.hi, static_cast<LIGHTCOLOR>(change.value)); break;
+    }
+}
+
+void FramePipeline::trimLog(){ // drops the changes every slot has already seen
+    long long end = m_logStart + (long long)m_log.size();
+    long long oldest = end;
+    for (int i = 0; i < FRAME_SLOTS; i++) {
+        if (m_synced[i] != NOT_SYNCED && end - m_synced[i] > FRAME_LOG_LIMIT) {
+            m_synced[i] = NOT_SYNCED; // a reader that stopped taking frames, it gets a full copy later
+        }
+        if (m_synced[i] != NOT_SYNCED && m_synced[i] < oldest) {
+            oldest = m_synced[i];
+        }
+    }
+    if (oldest > m_logStart) {
+        m_log.erase(m_log.begin(), m_log.begin() + (oldest - m_logStart));
+        m_logStart = oldest;
+    }
+}
@@ -0,0 +1,59 @@
+#ifndef FRAMEPIPELINE_H
+#define FRAMEPIPELINE_H
+#include "show.h"
+#include <atomic>
+using namespace std;
+#define FRAME_SLOTS 3
+#define FRAME_FRESH 4 // set in m_middle while the middle slot holds a frame the reader hasn't taken
+#define FRAME_LOG_LIMIT 100000 // a slot further behind than this gets a full copy instead of a replay
+#define NOT_SYNCED -1
+// triple buffered frames between one writer (choreography) and one reader (renderer),
+// the writer changes its back frame through this class, publish() hands it to the reader
+// and the recycled buffer it gets back is brought up to date by replaying only the
+// changes it missed
+class FramePipeline{
+public:
+    friend class Tester;
+    FramePipeline();
+
+    // writer side
+    void insert(const Drone& aDrone);
+    void remove(int id);
+    bool setState(int id, STATE state);
+    bool setColor(int id, LIGHTCOLOR color);
+    void setStateRange(int lo, int hi, STATE state);
+    void setColorRange(int lo, int hi, LIGHTCOLOR color);
+    const Show & current() const {return m_slots[m_back];}//the frame being built
+    void publish();
+
+    // reader side
+    const Show & acquire();//latest published frame, it stays untouched until the next acquire
+
+    long long getPublished() const {return m_published;}
+    long long getReplayed() const {return m_replayed;}//changes replayed into recycled buffers
+    long long getFullCopies() const {return m_fullCopies;}//buffers that were too far behind to replay
+
+private:
+    enum OPERATION {OP_INSERT, OP_REMOVE, OP_STATE, OP_COLOR, OP_STATERANGE, OP_COLORRANGE};
+    struct Change{
+        OPERATION op;
+        int hi;//end of a range, the start is drone's ID
+        int value;//state or color
+        Drone drone;
+    };
+    Show m_slots[FRAME_SLOTS];
+    long long m_synced[FRAME_SLOTS];//log position each slot has seen, writer only
+    atomic<int> m_middle;//index of the middle slot, plus FRAME_FRESH
+    int m_back;//writer only
+    int m_front;//reader only
+    vector<Change> m_log;//changes from log position m_logStart on
+    long long m_logStart;
+    long long m_published;
+    long long m_replayed;
+    long long m_fullCopies;
+
+    void record(OPERATION op, const Drone & aDrone, int hi, int value);
+    void replay(Show & aShow, const Change & change);
+    void trimLog();
+};
+#endif
@@ -0,0 +1,219 @@
+#include "historyshow.h"
+#include <algorithm>
+
+HistoryShow::HistoryShow(int depth){
+    m_depth = depth > 0 ? depth : 1;
+    m_time = 0;
+    m_horizon = 0;
+    m_recorded = 0;
+    m_changed = false;
+    Track empty;
+    empty.base = -1;
+    empty.size = 0;
+    empty.start = 0;
+    m_tracks.assign(MAXID - MINID + 1, empty);
+}
+
+// closes the time step that ends, the counts it leaves behind hold until the next change
+bool HistoryShow::setTime(int time){
+    if (time < m_time) {
+        return false;
+    }
+    if (time > m_time && m_changed) {
+        m_frameTimes.push_back(m_time);
+        for (int i = 0; i < NUMCOLORS; i++) {
+            m_frameCounts[i].push_back(m_show.countDrones(static_cast<LIGHTCOLOR>(i)));
+        }
+        for (int i = 0; i < NUMSTATES; i++) {
+            m_frameCounts[NUMCOLORS + i].push_back(m_show.countDrones(static_cast<STATE>(i)));
+        }
+        m_changed = false;
+    }
+    m_time = time;
+    return true;
+}
+
+void HistoryShow::insert(const Drone& aDrone){
+    int id = aDrone.getID();
+    bool added = MINID <= id && id <= MAXID && current(id) == HISTORY_ABSENT;
+    m_show.insert(aDrone);
+    if (added) {
+        record(id, aDrone.getType() * NUMSTATES + aDrone.getState());
+    }
+}
+
+void HistoryShow::remove(int id){
+    m_show.remove(id);
+    if (MINID <= id && id <= MAXID && current(id) != HISTORY_ABSENT) {
+        record(id, HISTORY_ABSENT);
+    }
+}
+
+bool HistoryShow::setState(int id, STATE state){
+    bool found = m_show.setState(id, state);
+    if (found) {
+        int before = current(id);
+        int after = before / NUMSTATES * NUMSTATES + state;
+        if (after != before) { // the same value again is no transition
+            record(id, after);
+        }
+    }
+    return found;
+}
+
+bool HistoryShow::setColor(int id, LIGHTCOLOR color){
+    bool found = m_show.setColor(id, color);
+    if (found) {
+        int before = current(id);
+        int after = color * NUMSTATES + before % NUMSTATES;
+        if (after != before) {
+            record(id, after);
+        }
+    }
+    return found;
+}
+
+// the show tags the range in O(log n), the history still needs one transition per drone
+void HistoryShow::setStateRange(int lo, int hi, STATE state){
+    lo = lo < MINID ? MINID : lo;
+    hi = hi > MAXID ? MAXID : hi;
+    m_show.setStateRange(lo, hi, state);
+    for (int id = lo; id <= hi; id++) {
+        int before = current(id);
+        if (before != HISTORY_ABSENT && before % NUMSTATES != state) {
+            record(id, before / NUMSTATES * NUMSTATES + state);
+        }
+    }
+}
+
+void HistoryShow::setColorRange(int lo, int hi, LIGHTCOLOR color){
+    lo = lo < MINID ? MINID : lo;
+    hi = hi > MAXID ? MAXID : hi;
+    m_show.setColorRange(lo, hi, color);
+    for (int id = lo; id <= hi; id++) {
+        int before = current(id);
+        if (before != HISTORY_ABSENT && before / NUMSTATES != color) {
+            record(id, color * NUMSTATES + before % NUMSTATES);
+        }
+    }
+}
+
+void HistoryShow::removeLightOff(){
+    vector<int> off = m_show.getDrones(LIGHTOFF);
+    m_show.removeLightOff();
+    for (int i = 0; i < (int)off.size(); i++) {
+        record(off[i], HISTORY_ABSENT);
+    }
+}
+
+void HistoryShow::clear(){
+    m_show.clear();
+    for (int i = 0; i < (int)m_tracks.size(); i++) {
+        if (current(MINID + i) != HISTORY_ABSENT) {
+            record(MINID + i, HISTORY_ABSENT);
+        }
+    }
+}
+
+bool HistoryShow::findDrone(int id, int time) const{
+    return MINID <= id && id <= MAXID && valueAt(id, time) != HISTORY_ABSENT;
+}
+
+bool HistoryShow::stateAt(int id, int time, LIGHTCOLOR & color, STATE & state) const{
+    int value = (MINID <= id && id <= MAXID) ? valueAt(id, time) : HISTORY_ABSENT;
+    if (value == HISTORY_ABSENT) {
+        return false;
+    }
+    color = static_cast<LIGHTCOLOR>(value / NUMSTATES);
+    state = static_cast<STATE>(value % NUMSTATES);
+    return true;
+}
+
+vector<DroneChange> HistoryShow::showAt(int time) const{
+    vector<DroneChange> drones;
+    for (int i = 0; i < (int)m_tracks.size(); i++) {
+        if (m_tracks[i].size == 0) {
+            continue;
+        }
+        int value = valueAt(MINID + i, time);
+        if (value != HISTORY_ABSENT) {
+            DroneChange drone;
+            drone.id = MINID + i;
+            drone.type = static_cast<LIGHTCOLOR>(value / NUMSTATES);
+            drone.state = static_cast<STATE>(value % NUMSTATES);
+            drones.push_back(drone);
+        }
+    }
+    return drones;
+}
+
+int HistoryShow::countDrones(LIGHTCOLOR aColor, int time) const{
+    return time >= m_time ? m_show.countDrones(aColor) : countAt(aColor, time);
+}
+
+int HistoryShow::countDrones(STATE aState, int time) const{
+    return time >= m_time ? m_show.countDrones(aState) : countAt(NUMCOLORS + aState, time);
+}
+
+// a second change at the same time replaces the first, so a ring never holds two
+// transitions with the same time; a full ring drops its oldest one
+void HistoryShow::record(int id, int value){
+    Track & track = m_tracks[id - MINID];
+    if (track.base == -1) {
+        track.base = (int)m_storage.size();
+        m_storage.resize(m_storage.size() + m_depth);
+    }
+    m_changed = true;
+    if (track.size > 0) {
+        Transition & newest = m_storage[track.base + (track.start + track.size - 1) % m_depth];
+        if (newest.time == m_time) {
+            newest.value = value;
+            return;
+        }
+    }
+    Transition next;
+    next.time = m_time;
+    next.value = value;
+    if (track.size < m_depth) {
+        m_storage[track.base + (track.start + track.size) % m_depth] = next;
+        track.size++;
+    }
+    else {
+        m_storage[track.base + track.start] = next;
+        track.start = (track.start + 1) % m_depth;
+        m_horizon = max(m_horizon, m_storage[track.base + track.start].time);
+    }
+    m_recorded++;
+}
+
+int HistoryShow::current(int id) const{
+    const Track & track = m_tracks[id - MINID];
+    if (track.size == 0) {
+        return HISTORY_ABSENT;
+    }
+    return m_storage[track.base + (track.start + track.size - 1) % m_depth].value;
+}
+
+int HistoryShow::valueAt(int id, int time) const{ // the newest transition not after time
+    const Track & track = m_tracks[id - MINID];
+    int low = 0;
+    int high = track.size;
+    while (low < high) { // first transition after time
+        int middle = (low + high) / 2;
+        if (m_storage[track.base + (track.start + middle) % m_depth].time <= time) {
+            low = middle + 1;
+        }
+        else {
+            high = middle;
+        }
+    }
+    if (low == 0) {
+        return HISTORY_ABSENT;
+    }
+    return m_storage[track.base + (track.start + low - 1) % m_depth].value;
+}
+
+int HistoryShow::countAt(int column, int time) const{
+    int frame = (int)(upper_bound(m_frameTimes.begin(), m_frameTimes.end(), time) - m_frameTimes.begin());
+    return frame == 0 ? 0 : m_frameCounts[column][frame - 1];
+}
@@ -0,0 +1,67 @@
+#ifndef HISTORYSHOW_H
+#define HISTORYSHOW_H
+#include "show.h"
+using namespace std;
+#define HISTORY_DEPTH 32 // transitions kept per drone, older ones are overwritten
+#define HISTORY_ABSENT -1 // the drone was not in the show
+// a Show that remembers when every drone changed: each ID keeps its last few transitions,
+// time and color * NUMSTATES + state, in a ring of its own, so the state of a drone at a
+// past time is a binary search in its ring, and the counts of the whole fleet are written
+// down once per time step into a log with one column per color and state
+class HistoryShow{
+public:
+    friend class Tester;
+    HistoryShow(int depth = HISTORY_DEPTH);
+    HistoryShow(const HistoryShow & rhs) = delete;
+    const HistoryShow & operator=(const HistoryShow & rhs) = delete;
+
+    bool setTime(int time);//later mutations happen at time, false if it goes back
+    int getTime() const {return m_time;}
+    void insert(const Drone& aDrone);
+    void remove(int id);
+    bool setState(int id, STATE state);
+    bool setColor(int id, LIGHTCOLOR color);
+    void setStateRange(int lo, int hi, STATE state);
+    void setColorRange(int lo, int hi, LIGHTCOLOR color);
+    void removeLightOff();
+    void clear();
+    const Show & show() const {return m_show;}
+
+    // false if the drone was not in the show at time; the answers are exact from horizon() on,
+    // before it some drone has lost transitions to its ring
+    bool findDrone(int id, int time) const;
+    bool stateAt(int id, int time, LIGHTCOLOR & color, STATE & state) const;
+    vector<DroneChange> showAt(int time) const;//every drone at time in ascending ID order
+    int countDrones(LIGHTCOLOR aColor, int time) const;
+    int countDrones(STATE aState, int time) const;
+    int horizon() const {return m_horizon;}
+    long long getRecorded() const {return m_recorded;}
+
+private:
+    struct Transition{
+        int time;
+        int value;//color * NUMSTATES + state, or HISTORY_ABSENT
+    };
+    struct Track{//the ring of one ID, in time order from start on
+        int base;//where the ring begins in m_storage, -1 before the first transition
+        int size;
+        int start;
+    };
+    Show m_show;
+    int m_depth;
+    int m_time;
+    int m_horizon;
+    long long m_recorded;
+    vector<Track> m_tracks;//one per ID
+    vector<Transition> m_storage;//the rings of the IDs seen so far, depth transitions each
+    // the counts at the end of every time step with a change, one column per class
+    vector<int> m_frameTimes;
+    vector<int> m_frameCounts[NUMCOLORS + NUMSTATES];
+    bool m_changed;//something changed at m_time
+
+    void record(int id, int value);
+    int current(int id) const;//the newest value of the ID, HISTORY_ABSENT if there is none
+    int valueAt(int id, int time) const;
+    int countAt(int column, int time) const;
+};
+#endif
@@ -0,0 +1,357 @@
+#include "journaledshow.h"
+#include <fcntl.h>
+#include <unistd.h>
+#include <cstdio>
+
+JournaledShow::JournaledShow(const string & path, bool sync, int groupSize, long long checkpointEvery){
+    m_journalPath = path + ".journal";
+    m_checkpointPath = path + ".checkpoint";
+    m_journal = -1;
+    m_journalBytes = 0;
+    m_sync = sync;
+    m_groupSize = groupSize > 0 ? groupSize : 1;
+    m_checkpointEvery = checkpointEvery;
+    m_generation = 0;
+    m_sinceCheckpoint = 0;
+    m_logged = 0;
+    m_commits = 0;
+    m_checkpoints = 0;
+    m_replayed = 0;
+    recover();
+}
+
+JournaledShow::~JournaledShow(){
+    commit();
+    if (m_journal != -1) {
+        close(m_journal);
+    }
+}
+
+void JournaledShow::insert(const Drone& aDrone){
+    m_show.insert(aDrone);
+    record(JOP_INSERT, aDrone.getID(), aDrone.getType() * NUMSTATES + aDrone.getState());
+}
+
+void JournaledShow::remove(int id){
+    m_show.remove(id);
+    record(JOP_REMOVE, id, 0);
+}
+
+bool JournaledShow::setState(int id, STATE state){
+    bool found = m_show.setState(id, state);
+    if (found) {
+        record(JOP_STATE, id, state);
+    }
+    return found;
+}
+
+bool JournaledShow::setColor(int id, LIGHTCOLOR color){
+    bool found = m_show.setColor(id, color);
+    if (found) {
+        record(JOP_COLOR, id, color);
+    }
+    return found;
+}
+
+void JournaledShow::setStateRange(int lo, int hi, STATE state){
+    lo = lo < MINID ? MINID : lo;
+    hi = hi > MAXID ? MAXID : hi;
+    if (lo <= hi) {
+        m_show.setStateRange(lo, hi, state);
+        record(JOP_STATERANGE, lo, hi * NUMSTATES + state);
+    }
+}
+
+void JournaledShow::setColorRange(int lo, int hi, LIGHTCOLOR color){
+    lo = lo < MINID ? MINID : lo;
+    hi = hi > MAXID ? MAXID : hi;
+    if (lo <= hi) {
+        m_show.setColorRange(lo, hi, color);
+        record(JOP_COLORRANGE, lo, hi * NUMCOLORS + color);
+    }
+}
+
+void JournaledShow::removeLightOff(){
+    m_show.removeLightOff();
+    record(JOP_REMOVEOFF, 0, 0);
+}
+
+void JournaledShow::clear(){
+    m_show.clear();
+    record(JOP_CLEAR, 0, 0);
+}
+
+// one write (and one sync) for the whole group, that is what keeps the cost per record low;
+// a failed write or sync cuts the file back to the last good group, so a retry doesn't leave
+// a torn record in the middle that would make recovery stop before the groups after it
+bool JournaledShow::commit(){
+    if (m_journal == -1) {
+        return false;
+    }
+    if (m_buffer.empty()) {
+        return true;
+    }
+    long long bytes = (long long)m_buffer.size() * sizeof(Record);
+    if (!writeAll(m_journal, m_buffer.data(), bytes) || (m_sync && fdatasync(m_journal) != 0)) {
+        if (ftruncate(m_journal, m_journalBytes) != 0) { // can't get back to a clean end
+            close(m_journal);
+            m_journal = -1;
+        }
+        return false;
+    }
+    m_journalBytes += bytes;
+    m_buffer.clear();
+    m_commits++;
+    return true;
+}
+
+// the checkpoint is written to a temporary file and renamed over the old one, the new
+// generation number tells recovery that the journal left by a crash right after the
+// rename is already part of the checkpoint
+bool JournaledShow::checkpoint(){
+    if (!commit()) {
+        return false;
+    }
+    Show empty;
+    vector<DroneChange> drones = m_show.diff(empty).added; // every drone, IDs ascending
+    vector<Record> records;
+    records.reserve(drones.size() + 1);
+    records.push_back(makeRecord(JOP_HEADER, m_generation + 1, (int)drones.size()));
+    for (int i = 0; i < (int)drones.size(); i++) {
+        records.push_back(makeRecord(JOP_INSERT, drones[i].id, drones[i].type * NUMSTATES + drones[i].state));
+    }
+
+    string temporary = m_checkpointPath + ".tmp";
+    int file = open(temporary.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (file == -1) {
+        return false;
+    }
+    bool written = writeAll(file, records.data(), (long long)records.size() * sizeof(Record));
+    if (written && m_sync) {
+        written = fsync(file) == 0; // renaming a file that never reached the disk would lose the show
+    }
+    close(file);
+    if (!written || rename(temporary.c_str(), m_checkpointPath.c_str()) != 0) {
+        return false;
+    }
+    // the rename itself lives in the directory, if that can't be synced the new checkpoint is
+    // still the one on disk, so the journal has to move on with it, only the result says so
+    bool durable = !m_sync || syncDirectory();
+
+    m_generation++;
+    bool started = startJournal();
+    m_sinceCheckpoint = 0;
+    m_checkpoints++;
+    return durable && started;
+}
+
+// replays into one slot per ID instead of into the tree, every record is O(1) that way,
+// and then builds the tree once from the IDs in order
+bool JournaledShow::recover(){
+    vector<int> drones(MAXID - MINID + 1, JOURNAL_ABSENT);
+    vector<Record> records;
+    m_buffer.clear();
+    m_generation = 0;
+
+    readRecords(m_checkpointPath, records);
+    if (!records.empty() && valid(records[0]) && records[0].op == JOP_HEADER) {
+        int count = records[0].value;
+        int i = 1;
+        for (; i <= count && i < (int)records.size() && valid(records[i]); i++) {
+            if (MINID <= records[i].id && records[i].id <= MAXID) {
+                drones[records[i].id - MINID] = records[i].value;
+            }
+        }
+        if (i <= count) { // the journal only makes sense on top of the whole checkpoint, so give up
+            m_show.clear(); // and leave both files alone for whoever repairs them
+            if (m_journal != -1) {
+                close(m_journal);
+                m_journal = -1;
+            }
+            m_replayed = 0;
+            m_sinceCheckpoint = 0;
+            return false;
+        }
+        m_generation = records[0].id;
+    }
+
+    readRecords(m_journalPath, records);
+    bool current = !records.empty() && valid(records[0]) && records[0].op == JOP_HEADER
+                   && records[0].id == m_generation; // otherwise it is older than the checkpoint
+    long long replayed = 0;
+    if (current) {
+        for (int i = 1; i < (int)records.size() && valid(records[i]); i++) { // stops at a torn tail
+            const Record & next = records[i];
+            bool inRange = MINID <= next.id && next.id <= MAXID;
+            int *drone = inRange ? &drones[next.id - MINID] : nullptr;
+            switch (next.op) {
+                case JOP_INSERT:
+                    if (inRange && *drone == JOURNAL_ABSENT) {
+                        *drone = next.value;
+                    }
+                    break;
+                case JOP_REMOVE:
+                    if (inRange) {
+                        *drone = JOURNAL_ABSENT;
+                    }
+                    break;
+                case JOP_STATE:
+                    if (inRange && *drone != JOURNAL_ABSENT) {
+                        *drone = *drone / NUMSTATES * NUMSTATES + next.value;
+                    }
+                    break;
+                case JOP_COLOR:
+                    if (inRange && *drone != JOURNAL_ABSENT) {
+                        *drone = next.value * NUMSTATES + *drone % NUMSTATES;
+                    }
+                    break;
+                case JOP_STATERANGE:
+                    for (int j = next.id; inRange && j <= next.value / NUMSTATES && j <= MAXID; j++) {
+                        if (drones[j - MINID] != JOURNAL_ABSENT) {
+                            drones[j - MINID] = drones[j - MINID] / NUMSTATES * NUMSTATES + next.value % NUMSTATES;
+                        }
+                    }
+                    break;
+                case JOP_COLORRANGE:
+                    for (int j = next.id; inRange && j <= next.value / NUMCOLORS && j <= MAXID; j++) {
+                        if (drones[j - MINID] != JOURNAL_ABSENT) {
+                            drones[j - MINID] = next.value % NUMCOLORS * NUMSTATES + drones[j - MINID] % NUMSTATES;
+                        }
+                    }
+                    break;
+                case JOP_REMOVEOFF:
+                    for (int j = 0; j < (int)drones.size(); j++) {
+                        if (drones[j] != JOURNAL_ABSENT && drones[j] % NUMSTATES == LIGHTOFF) {
+                            drones[j] = JOURNAL_ABSENT;
+                        }
+                    }
+                    break;
+                case JOP_CLEAR:
+                    drones.assign(drones.size(), JOURNAL_ABSENT);
+                    break;
+                default:
+                    break;
+            }
+            replayed++;
+        }
+    }
+
+    vector<DroneChange> sorted;
+    for (int i = 0; i < (int)drones.size(); i++) {
+        if (drones[i] != JOURNAL_ABSENT) {
+            DroneChange drone;
+            drone.id = MINID + i;
+            drone.type = static_cast<LIGHTCOLOR>(drones[i] / NUMSTATES);
+            drone.state = static_cast<STATE>(drones[i] % NUMSTATES);
+            sorted.push_back(drone);
+        }
+    }
+    if (!m_show.load(sorted)) { // a record whose check passed but whose color or state doesn't exist
+        m_show.clear();
+    }
+    m_replayed = replayed;
+    m_sinceCheckpoint = replayed;
+
+    if (current) { // keep the good records, drop a torn tail, and append after them
+        if (m_journal != -1) {
+            close(m_journal);
+        }
+        m_journal = open(m_journalPath.c_str(), O_WRONLY | O_APPEND);
+        m_journalBytes = (replayed + 1) * sizeof(Record);
+        if (m_journal != -1 && ftruncate(m_journal, m_journalBytes) != 0) {
+            close(m_journal);
+            m_journal = -1;
+        }
+    }
+    if (m_journal == -1 || !current) {
+        startJournal();
+    }
+    return m_journal != -1;
+}
+
+void JournaledShow::record(OPERATION op, int id, int value){
+    m_buffer.push_back(makeRecord(op, id, value));
+    m_logged++;
+    m_sinceCheckpoint++;
+    if ((int)m_buffer.size() >= m_groupSize) {
+        commit();
+    }
+    if (m_sinceCheckpoint >= m_checkpointEvery) {
+        checkpoint();
+    }
+}
+
+JournaledShow::Record JournaledShow::makeRecord(OPERATION op, int id, int value){
+    Record aRecord;
+    aRecord.op = op;
+    aRecord.id = id;
+    aRecord.value = value;
+    aRecord.check = (int)((((unsigned)op * 131 + (unsigned)id) * 131 + (unsigned)value) ^ JOURNAL_SEED);
+    return aRecord;
+}
+
+bool JournaledShow::valid(const Record & aRecord){ // unsigned math, a garbage record must not overflow
+    return aRecord.check == makeRecord(static_cast<OPERATION>(aRecord.op), aRecord.id, aRecord.value).check;
+}
+
+void JournaledShow::readRecords(const string & path, vector<Record> & records){ // whole records only
+    records.clear();
+    int file = open(path.c_str(), O_RDONLY);
+    if (file == -1) {
+        return;
+    }
+    long long bytes = lseek(file, 0, SEEK_END);
+    lseek(file, 0, SEEK_SET);
+    records.resize(bytes / sizeof(Record));
+    long long done = 0;
+    long long wanted = (long long)records.size() * sizeof(Record);
+    char *data = reinterpret_cast<char*>(records.data());
+    while (done < wanted) {
+        long long got = read(file, data + done, wanted - done);
+        if (got <= 0) {
+            break;
+        }
+        done += got;
+    }
+    records.resize(done / sizeof(Record));
+    close(file);
+}
+
+bool JournaledShow::startJournal(){ // an empty journal is just the header with the generation
+    if (m_journal != -1) {
+        close(m_journal);
+    }
+    m_journal = open(m_journalPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_APPEND, 0644);
+    Record header = makeRecord(JOP_HEADER, m_generation, 0);
+    if (m_journal != -1 && (!writeAll(m_journal, &header, sizeof(Record)) || (m_sync && fdatasync(m_journal) != 0))) {
+        close(m_journal); // records after a missing header would never be replayed
+        m_journal = -1;
+    }
+    m_journalBytes = sizeof(Record);
+    return m_journal != -1;
+}
+
+bool JournaledShow::syncDirectory(){
+    size_t slash = m_checkpointPath.rfind('/');
+    string directory = slash == string::npos ? "." : (slash == 0 ? "/" : m_checkpointPath.substr(0, slash));
+    int file = open(directory.c_str(), O_RDONLY);
+    if (file == -1) {
+        return false;
+    }
+    bool synced = fsync(file) == 0;
+    close(file);
+    return synced;
+}
+
+bool JournaledShow::writeAll(int file, const void * data, long long bytes){
+    const char *next = static_cast<const char*>(data);
+    while (bytes > 0) {
+        long long written = write(file, next, bytes);
+        if (written <= 0) {
+            return false;
+        }
+        next += written;
+        bytes -= written;
+    }
+    return true;
+}
@@ -0,0 +1,76 @@
+#ifndef JOURNALEDSHOW_H
+#define JOURNALEDSHOW_H
+#include "show.h"
+#include <string>
+using namespace std;
+#define JOURNAL_GROUP 256 // records written (and synced) together by one group commit
+#define JOURNAL_CHECKPOINT 1000000 // records between two automatic checkpoints
+#define JOURNAL_ABSENT -1 // no drone with this ID during recovery
+#define JOURNAL_SEED 0x5EED // mixed into every record's check so zeroed or torn records don't pass
+// a Show whose mutations are also appended to a binary journal file, path.journal, with
+// group commits, and whose full tree is written to path.checkpoint every so often,
+// opening the same path again recovers the show from the checkpoint plus the journal
+class JournaledShow{
+public:
+    friend class Tester;
+    JournaledShow(const string & path, bool sync = true, int groupSize = JOURNAL_GROUP,
+                  long long checkpointEvery = JOURNAL_CHECKPOINT);//recovers whatever is at path
+    ~JournaledShow();//commits the last group
+    JournaledShow(const JournaledShow & rhs) = delete;
+    const JournaledShow & operator=(const JournaledShow & rhs) = delete;
+
+    void insert(const Drone& aDrone);
+    void remove(int id);
+    bool setState(int id, STATE state);
+    bool setColor(int id, LIGHTCOLOR color);
+    void setStateRange(int lo, int hi, STATE state);
+    void setColorRange(int lo, int hi, LIGHTCOLOR color);
+    void removeLightOff();
+    void clear();
+    bool commit();//writes the buffered records, after a sync they survive a crash, false if the write failed
+    bool checkpoint();//writes the whole show and starts a new, empty journal
+    bool recover();//throws away the show and reads it back from the files, false and empty if the checkpoint is cut short
+    bool isOpen() const {return m_journal != -1;}//false after a failed recovery, nothing is written then
+    const Show & show() const {return m_show;}
+
+    long long getLogged() const {return m_logged;}
+    long long getCommits() const {return m_commits;}
+    long long getCheckpoints() const {return m_checkpoints;}
+    long long getReplayed() const {return m_replayed;}//journal records read by the last recovery
+
+private:
+    enum OPERATION {JOP_HEADER, JOP_INSERT, JOP_REMOVE, JOP_STATE, JOP_COLOR, JOP_STATERANGE, JOP_COLORRANGE,
+                    JOP_REMOVEOFF, JOP_CLEAR};
+    // same layout in both files, value is color * NUMSTATES + state for an insert,
+    // and for a range, which starts at id, hi * NUMSTATES + state or hi * NUMCOLORS + color
+    struct Record{
+        int op;
+        int id;
+        int value;
+        int check;
+    };
+    Show m_show;
+    string m_journalPath;
+    string m_checkpointPath;
+    int m_journal;//file descriptor, appended to
+    long long m_journalBytes;//length of the journal up to the last group that was written and synced
+    bool m_sync;
+    int m_groupSize;
+    long long m_checkpointEvery;
+    int m_generation;//journal that belongs to the current checkpoint, both files carry it
+    vector<Record> m_buffer;//records waiting for the next group commit
+    long long m_sinceCheckpoint;
+    long long m_logged;
+    long long m_commits;
+    long long m_checkpoints;
+    long long m_replayed;
+
+    void record(OPERATION op, int id, int value);
+    static Record makeRecord(OPERATION op, int id, int value);
+    static bool valid(const Record & aRecord);
+    static void readRecords(const string & path, vector<Record> & records);
+    bool startJournal();//false if the header couldn't be written, no journal is open then
+    bool syncDirectory();//makes the checkpoint's rename durable
+    bool writeAll(int file, const void * data, long long bytes);
+};
+#endif
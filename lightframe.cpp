@@ -0,0 +1,223 @@
+#include "lightframe.h"
+#include <cmath>
+#include <cstring>
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+LightFrame::LightFrame(){
+    for (int i = 0; i < NUMCHANNELS; i++) {
+        m_columns[i].assign(MAXID - MINID + 1, 0);
+    }
+}
+
+Light LightFrame::toLight(LIGHTCOLOR color, STATE state){
+    Light light;
+    light.red = (color == RED) ? LIGHT_FULL : 0;
+    light.green = (color == GREEN) ? LIGHT_FULL : 0;
+    light.blue = (color == BLUE) ? LIGHT_FULL : 0;
+    light.bright = (state == LIGHTON) ? LIGHT_FULL : 0;
+    return light;
+}
+
+// the lists come from the index bitmaps, so no tree walk and no pending values to push
+void LightFrame::load(const Show & aShow){
+    for (int i = 0; i < NUMCHANNELS; i++) {
+        memset(m_columns[i].data(), 0, m_columns[i].size());
+    }
+    for (int color = 0; color < NUMCOLORS; color++) {
+        vector<int> ids = aShow.getDrones(static_cast<LIGHTCOLOR>(color));
+        for (int i = 0; i < (int)ids.size(); i++) {
+            m_columns[color][ids[i] - MINID] = LIGHT_FULL; // the channel of a color has the same number
+        }
+    }
+    vector<int> on = aShow.getDrones(LIGHTON);
+    for (int i = 0; i < (int)on.size(); i++) {
+        m_columns[CHANNEL_BRIGHT][on[i] - MINID] = LIGHT_FULL;
+    }
+}
+
+void LightFrame::setColor(int lo, int hi, LIGHTCOLOR color){
+    Light light = toLight(color, LIGHTON);
+    lo = lo < MINID ? MINID : lo;
+    hi = hi > MAXID ? MAXID : hi;
+    if (lo <= hi) {
+        memset(m_columns[CHANNEL_RED].data() + (lo - MINID), light.red, hi - lo + 1);
+        memset(m_columns[CHANNEL_GREEN].data() + (lo - MINID), light.green, hi - lo + 1);
+        memset(m_columns[CHANNEL_BLUE].data() + (lo - MINID), light.blue, hi - lo + 1);
+    }
+}
+
+void LightFrame::setState(int lo, int hi, STATE state){
+    lo = lo < MINID ? MINID : lo;
+    hi = hi > MAXID ? MAXID : hi;
+    if (lo <= hi) {
+        memset(m_columns[CHANNEL_BRIGHT].data() + (lo - MINID), toLight(RED, state).bright, hi - lo + 1);
+    }
+}
+
+void LightFrame::setLight(int lo, int hi, Light light){
+    lo = lo < MINID ? MINID : lo;
+    hi = hi > MAXID ? MAXID : hi;
+    if (lo <= hi) {
+        memset(m_columns[CHANNEL_RED].data() + (lo - MINID), light.red, hi - lo + 1);
+        memset(m_columns[CHANNEL_GREEN].data() + (lo - MINID), light.green, hi - lo + 1);
+        memset(m_columns[CHANNEL_BLUE].data() + (lo - MINID), light.blue, hi - lo + 1);
+        memset(m_columns[CHANNEL_BRIGHT].data() + (lo - MINID), light.bright, hi - lo + 1);
+    }
+}
+
+Light LightFrame::getLight(int id) const{
+    Light light = {0, 0, 0, 0};
+    if (MINID <= id && id <= MAXID) {
+        light.red = m_columns[CHANNEL_RED][id - MINID];
+        light.green = m_columns[CHANNEL_GREEN][id - MINID];
+        light.blue = m_columns[CHANNEL_BLUE][id - MINID];
+        light.bright = m_columns[CHANNEL_BRIGHT][id - MINID];
+    }
+    return light;
+}
+
+LIGHTCOLOR LightFrame::nearestColor(int id) const{
+    Light light = getLight(id);
+    if (light.red >= light.green && light.red >= light.blue) {
+        return RED;
+    }
+    return (light.green >= light.blue) ? GREEN : BLUE;
+}
+
+void LightFrame::fade(const LightFrame & from, const LightFrame & to, double t){
+    long weight = lround(t * LIGHT_STEPS);
+    weight = weight < 0 ? 0 : (weight > LIGHT_STEPS ? LIGHT_STEPS : weight);
+    for (int i = 0; i < NUMCHANNELS; i++) {
+        fadeBytesSIMD(from.m_columns[i].data(), to.m_columns[i].data(), m_columns[i].data(), (int)m_columns[i].size(), (int)weight);
+    }
+}
+
+// the step rounds up so hi gets all of last, the weights are capped where that overshoots
+void LightFrame::gradient(int lo, int hi, Light first, Light last){
+    lo = lo < MINID ? MINID : lo;
+    hi = hi > MAXID ? MAXID : hi;
+    if (lo >= hi) {
+        setLight(lo, hi, first);
+        return;
+    }
+    int size = hi - lo + 1;
+    int step = ((LIGHT_STEPS << 16) + size - 2) / (size - 1);
+    const unsigned char from[NUMCHANNELS] = {first.red, first.green, first.blue, first.bright};
+    const unsigned char to[NUMCHANNELS] = {last.red, last.green, last.blue, last.bright};
+    for (int i = 0; i < NUMCHANNELS; i++) {
+        gradientBytesSIMD(m_columns[i].data() + (lo - MINID), size, from[i], to[i], step);
+    }
+}
+
+// a mask of period + 32 bytes holds every window of the pattern a vector can need, so the
+// kernel is one load and one and for 32 IDs
+void LightFrame::blink(int lo, int hi, int period, int on, long long frame){
+    lo = lo < MINID ? MINID : lo;
+    hi = hi > MAXID ? MAXID : hi;
+    if (lo > hi || period <= 0) {
+        return;
+    }
+    vector<unsigned char> pattern(period + 32);
+    for (int k = 0; k < (int)pattern.size(); k++) {
+        pattern[k] = (k % period < on) ? 0xFF : 0;
+    }
+    unsigned char *bright = m_columns[CHANNEL_BRIGHT].data() + (lo - MINID);
+    int size = hi - lo + 1;
+    int offset = (int)(((frame % period) + period) % period);
+    int i = 0;
+#if defined(__AVX2__)
+    for (; i + 32 <= size; i += 32) {
+        __m256i mask = _mm256_loadu_si256((const __m256i*)(pattern.data() + offset));
+        __m256i block = _mm256_loadu_si256((const __m256i*)(bright + i));
+        _mm256_storeu_si256((__m256i*)(bright + i), _mm256_and_si256(block, mask));
+        offset = (offset + 32) % period;
+    }
+#elif defined(__SSE2__)
+    for (; i + 16 <= size; i += 16) {
+        __m128i mask = _mm_loadu_si128((const __m128i*)(pattern.data() + offset));
+        __m128i block = _mm_loadu_si128((const __m128i*)(bright + i));
+        _mm_storeu_si128((__m128i*)(bright + i), _mm_and_si128(block, mask));
+        offset = (offset + 16) % period;
+    }
+#endif
+    for (; i < size; i++) {
+        bright[i] &= pattern[offset];
+        offset = (offset + 1) % period;
+    }
+}
+
+void LightFrame::fadeBytes(const unsigned char *from, const unsigned char *to, unsigned char *out, int size, int weight){
+    for (int i = 0; i < size; i++) {
+        out[i] = (unsigned char)((from[i] * (LIGHT_STEPS - weight) + to[i] * weight) >> 8);
+    }
+}
+
+// bytes widen to 16 bit lanes, 255 * LIGHT_STEPS still fits, and pack back after the shift
+void LightFrame::fadeBytesSIMD(const unsigned char *from, const unsigned char *to, unsigned char *out, int size, int weight){
+    int i = 0;
+#if defined(__AVX2__)
+    __m256i zero = _mm256_setzero_si256();
+    __m256i toWeight = _mm256_set1_epi16((short)weight);
+    __m256i fromWeight = _mm256_set1_epi16((short)(LIGHT_STEPS - weight));
+    for (; i + 32 <= size; i += 32) { // unpack and pack both work inside 128 bit lanes, the order comes out right
+        __m256i a = _mm256_loadu_si256((const __m256i*)(from + i));
+        __m256i b = _mm256_loadu_si256((const __m256i*)(to + i));
+        __m256i low = _mm256_add_epi16(_mm256_mullo_epi16(_mm256_unpacklo_epi8(a, zero), fromWeight),
+                                       _mm256_mullo_epi16(_mm256_unpacklo_epi8(b, zero), toWeight));
+        __m256i high = _mm256_add_epi16(_mm256_mullo_epi16(_mm256_unpackhi_epi8(a, zero), fromWeight),
+                                        _mm256_mullo_epi16(_mm256_unpackhi_epi8(b, zero), toWeight));
+        _mm256_storeu_si256((__m256i*)(out + i), _mm256_packus_epi16(_mm256_srli_epi16(low, 8), _mm256_srli_epi16(high, 8)));
+    }
+#elif defined(__SSE2__)
+    __m128i zero = _mm_setzero_si128();
+    __m128i toWeight = _mm_set1_epi16((short)weight);
+    __m128i fromWeight = _mm_set1_epi16((short)(LIGHT_STEPS - weight));
+    for (; i + 16 <= size; i += 16) {
+        __m128i a = _mm_loadu_si128((const __m128i*)(from + i));
+        __m128i b = _mm_loadu_si128((const __m128i*)(to + i));
+        __m128i low = _mm_add_epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(a, zero), fromWeight),
+                                    _mm_mullo_epi16(_mm_unpacklo_epi8(b, zero), toWeight));
+        __m128i high = _mm_add_epi16(_mm_mullo_epi16(_mm_unpackhi_epi8(a, zero), fromWeight),
+                                     _mm_mullo_epi16(_mm_unpackhi_epi8(b, zero), toWeight));
+        _mm_storeu_si128((__m128i*)(out + i), _mm_packus_epi16(_mm_srli_epi16(low, 8), _mm_srli_epi16(high, 8)));
+    }
+#endif
+    fadeBytes(from + i, to + i, out + i, size - i, weight); // the tail
+}
+
+void LightFrame::gradientBytes(unsigned char *out, int start, int size, unsigned char first, unsigned char last, int step){
+    for (int i = start; i < size; i++) {
+        int weight = (i * step) >> 16;
+        weight = weight > LIGHT_STEPS ? LIGHT_STEPS : weight;
+        out[i] = (unsigned char)((first * (LIGHT_STEPS - weight) + last * weight) >> 8);
+    }
+}
+
+// the weights count up in 32 bit lanes, four vectors for 16 IDs, and are packed to 16 bits;
+// AVX2 packs inside 128 bit lanes and would mix up the IDs, so this stays at 16 IDs a step
+void LightFrame::gradientBytesSIMD(unsigned char *out, int size, unsigned char first, unsigned char last, int step){
+    int i = 0;
+#if defined(__SSE2__)
+    __m128i weights[4];
+    for (int part = 0; part < 4; part++) {
+        weights[part] = _mm_setr_epi32(4 * part * step, (4 * part + 1) * step, (4 * part + 2) * step, (4 * part + 3) * step);
+    }
+    __m128i advance = _mm_set1_epi32(16 * step);
+    __m128i full = _mm_set1_epi16(LIGHT_STEPS);
+    __m128i a = _mm_set1_epi16(first);
+    __m128i b = _mm_set1_epi16(last);
+    for (; i + 16 <= size; i += 16) {
+        __m128i lowWeight = _mm_min_epi16(_mm_packs_epi32(_mm_srli_epi32(weights[0], 16), _mm_srli_epi32(weights[1], 16)), full);
+        __m128i highWeight = _mm_min_epi16(_mm_packs_epi32(_mm_srli_epi32(weights[2], 16), _mm_srli_epi32(weights[3], 16)), full);
+        __m128i low = _mm_add_epi16(_mm_mullo_epi16(a, _mm_sub_epi16(full, lowWeight)), _mm_mullo_epi16(b, lowWeight));
+        __m128i high = _mm_add_epi16(_mm_mullo_epi16(a, _mm_sub_epi16(full, highWeight)), _mm_mullo_epi16(b, highWeight));
+        _mm_storeu_si128((__m128i*)(out + i), _mm_packus_epi16(_mm_srli_epi16(low, 8), _mm_srli_epi16(high, 8)));
+        for (int part = 0; part < 4; part++) {
+            weights[part] = _mm_add_epi32(weights[part], advance);
+        }
+    }
+#endif
+    gradientBytes(out, i, size, first, last, step); // the tail
+}
@@ -0,0 +1,48 @@
+#ifndef LIGHTFRAME_H
+#define LIGHTFRAME_H
+#include "show.h"
+using namespace std;
+#define NUMCHANNELS 4
+#define LIGHT_FULL 255 // brightness of a drone that is LIGHTON
+#define LIGHT_STEPS 256 // fade weights go from 0, all of the first color, to LIGHT_STEPS, all of the second
+enum LIGHTCHANNEL {CHANNEL_RED, CHANNEL_GREEN, CHANNEL_BLUE, CHANNEL_BRIGHT};
+struct Light{
+    unsigned char red;
+    unsigned char green;
+    unsigned char blue;
+    unsigned char bright;
+};
+// 24 bit RGB and a brightness for every ID from MINID to MAXID, one column per channel in
+// ascending ID order like the Show; the kernels go over whole columns or ID ranges of them,
+// 32 IDs a step with AVX2, 16 with SSE2 and one at a time otherwise; an ID no drone has
+// keeps whatever it was given, which drones there are is up to the Show
+class LightFrame{
+public:
+    friend class Tester;
+    LightFrame();//every ID dark
+    static Light toLight(LIGHTCOLOR color, STATE state);//how the three colors look
+    void load(const Show & aShow);//the drones get their color and state, the other IDs go dark
+    void setColor(int lo, int hi, LIGHTCOLOR color);//keeps the brightness
+    void setState(int lo, int hi, STATE state);//keeps the color
+    void setLight(int lo, int hi, Light light);
+    Light getLight(int id) const;
+    LIGHTCOLOR nearestColor(int id) const;//the strongest channel, red before green before blue on a tie
+    const unsigned char* channel(LIGHTCHANNEL which) const {return m_columns[which].data();}//MINID first
+
+    // one call each per frame, out may be one of the frames it reads
+    void fade(const LightFrame & from, const LightFrame & to, double t);//every ID, t from 0 to 1
+    void gradient(int lo, int hi, Light first, Light last);//lo gets first, hi gets last, linear in between
+    // IDs lo + k with (k + frame) % period >= on go dark, so the lit groups move down an ID a frame
+    void blink(int lo, int hi, int period, int on, long long frame);
+
+    // out[i] = (from[i] * (LIGHT_STEPS - weight) + to[i] * weight) / LIGHT_STEPS, rounded down
+    static void fadeBytes(const unsigned char* from, const unsigned char* to, unsigned char* out, int size, int weight);
+    static void fadeBytesSIMD(const unsigned char* from, const unsigned char* to, unsigned char* out, int size, int weight);
+    // the same with weight (i * step) >> 16 for out[i], from index start on
+    static void gradientBytes(unsigned char* out, int start, int size, unsigned char first, unsigned char last, int step);
+    static void gradientBytesSIMD(unsigned char* out, int size, unsigned char first, unsigned char last, int step);
+
+private:
+    vector<unsigned char> m_columns[NUMCHANNELS];
+};
+#endif
@@ -1,5 +1,25 @@
 #include "show.h"
+#include "shardedshow.h"
+#include "droneevents.h"
+#include "framepipeline.h"
+#include "journaledshow.h"
+#include "sharedshow.h"
+#include "basicshow.h"
+#include "formation.h"
+#include "historyshow.h"
+#include "cuescheduler.h"
+#include "framecodec.h"
+#include "lightframe.h"
 #include <random>
+#include <algorithm>
+#include <chrono>
+#include <queue>
+#include <functional>
+#include <type_traits>
+#include <sys/wait.h>
+#include <sys/resource.h>
+#include <csignal>
+#include <unistd.h>
 using namespace std;
 
 enum RANDOM {UNIFORMINT, UNIFORMREAL, NORMAL};
@@ -95,6 +115,56 @@ public:
     bool testAssignmentOperatorError(); // test copying empty object should return false
     bool testRemoveTimeMeasurement(); // removes 1000 and 2000 nodes than checks if they fall within range
     bool testInsertTimeMeasurement(); // inserts 10000 and 5000 nodes than checks if they fall in range
+    bool testCopyConstructor(); // copies a show and checks that both trees are independent
+    bool testMoveSemantics(); // moves and swaps shows and checks the nodes are handed over, not copied
+    bool testEmplace(Show & ashow); // builds drones in place with emplace and insert(Drone&&)
+    bool removeTwoKidsCase(Show & ashow); // removes nodes with two kids, checks payloads and node addresses survive
+    bool testRangeAgainstLoop(); // range updates should match setState/setColor called on every ID
+    bool testRangeTimeMeasurement(); // range update of a block vs calling setState for every ID in it
+    bool testColorIndex(Show & ashow); // color and state indexes should match a walk over the tree
+    bool testDiffApply(); // applying the diff of two frames to the older one gives the newer one
+    bool testDiffTimeMeasurement(); // diff and apply vs copying the whole frame with operator=
+    bool testSpatialQueries(Show & ashow); // radius, nearest and collision queries vs checking every drone
+    bool testCollisionTimeMeasurement(); // grid collision check vs the O(n^2) scan of all pairs
+    bool testSparseSpatialQueries(); // far queries on a small fleet only visit its occupied cells
+    bool testPayloadKernels(Show & ashow); // column kernels should agree with the tree walks
+    bool testPayloadMirror(); // every node's color and state match its store slot after any change
+    bool testKernelTimeMeasurement(); // column kernels vs helpCount/helpCountState tree walks
+    bool testFreeze(Show & ashow); // frozen lookups and updates should match the AVL tree
+    bool testFrozenTimeMeasurement(); // frozen findDrone vs findHelper on growing shows
+    bool testBatchLookupTimeMeasurement(); // findDrones on a batch vs findDrone one at a time
+    bool testShardedShow(); // sharded show should answer like a single show
+    bool testShardScalingTimeMeasurement(); // bulk operations on 8 shards with 1 to 8 threads
+    bool testEventQueue(Show & ashow); // events from 4 telemetry threads end up applied in order
+    bool testFramePipeline(); // every acquired frame matches what the writer published
+    bool testFramePublishTimeMeasurement(); // publishing 60 frames while a renderer thread reads them
+    bool testJournalRecovery(); // a crashed journaled show comes back with every committed change
+    bool testJournalTimeMeasurement(); // journal cost per mutation and recovery of 1000000 records
+    bool testSharedShow(); // another process reads the shared show while this one changes it
+    bool testBasicShow(); // Show and BasicShow share one AVL core, the plain tree with Show's types and with 32 bit IDs
+    bool testFingerInsert(); // inserts and accesses that start at the finger keep the tree right
+    bool testFingerInsertTimeMeasurement(); // sequential, near-sequential and random insert streams
+    bool testDeferredRemove(); // a show that defers removes answers like one that doesn't
+    bool testDeferredRemoveTimeMeasurement(); // removeNormalCase and removeBalanced workloads, both modes
+    bool testHotCache(); // cached lookups stay right across removes, clears, copies and range updates
+    bool testHotCacheTimeMeasurement(); // Zipf distributed lookups with and without the cache
+    bool testFormation(); // a constexpr formation answers like a show built from the same list
+    bool testFormationTimeMeasurement(); // startup from a formation table against the insert loop
+    bool testHistory(); // the show at every past time step comes back from the history
+    bool testHistoryTimeMeasurement(); // setState with and without recording, and fleet reconstruction
+    bool testCueScheduler(); // cues on every wheel level land in their tick, in the order they were given
+    bool testCueSchedulerTimeMeasurement(); // scheduling cost and tick jitter for 1000000 cues
+#if defined(__cpp_impl_coroutine)
+    bool testCueCoroutine(); // coroutines wait for ticks and cue lights in the same pass
+#endif
+    bool testFrameCodec(); // full and delta frames decode to the show they were encoded from
+    bool testFrameCodecTimeMeasurement(); // encoding and decoding 90000 drone frames
+    bool testCheckedMode(); // checkTree and the SHOW_CHECKED path checks find broken nodes
+    bool testCheckedModeTimeMeasurement(); // the insert and remove workload, and what full checks would add
+    bool testQuery(); // every query plan and the bulk updates agree with a brute force filter
+    bool testQueryTimeMeasurement(); // planned queries against full tree scans
+    bool testLightFrame(); // the light model maps the three colors and the kernels match the scalar loops
+    bool testLightFrameTimeMeasurement(); // frames per second of a fade, a gradient and a blink over the fleet
 };
 
 int main(){
@@ -213,6 +283,262 @@ int main(){
     else
         cout << "\ttestInsertTimeMeasurement() returned false." << endl;
 
+    if (tester.testCopyConstructor()) // should return true
+        cout << "\ttestCopyConstructor() returned true." << endl;
+    else
+        cout << "\ttestCopyConstructor() returned false." << endl;
+
+    if (tester.testMoveSemantics()) // should return true
+        cout << "\ttestMoveSemantics() returned true." << endl;
+    else
+        cout << "\ttestMoveSemantics() returned false." << endl;
+
+    Show show14;
+
+    if (tester.testEmplace(show14)) // should return true
+        cout << "\ttestEmplace() returned true." << endl;
+    else
+        cout << "\ttestEmplace() returned false." << endl;
+
+    Show show15;
+
+    if (tester.removeTwoKidsCase(show15)) // should return true
+        cout << "\tremoveTwoKidsCase() returned true." << endl;
+    else
+        cout << "\tremoveTwoKidsCase() returned false." << endl;
+
+    if (tester.testRangeAgainstLoop()) // should return true
+        cout << "\ttestRangeAgainstLoop() returned true." << endl;
+    else
+        cout << "\ttestRangeAgainstLoop() returned false." << endl;
+
+    if (tester.testRangeTimeMeasurement()) // should return true
+        cout << "\ttestRangeTimeMeasurement() returned true." << endl;
+    else
+        cout << "\ttestRangeTimeMeasurement() returned false." << endl;
+
+    Show show16;
+
+    if (tester.testColorIndex(show16)) // should return true
+        cout << "\ttestColorIndex() returned true." << endl;
+    else
+        cout << "\ttestColorIndex() returned false." << endl;
+
+    if (tester.testDiffApply()) // should return true
+        cout << "\ttestDiffApply() returned true." << endl;
+    else
+        cout << "\ttestDiffApply() returned false." << endl;
+
+    if (tester.testDiffTimeMeasurement()) // should return true
+        cout << "\ttestDiffTimeMeasurement() returned true." << endl;
+    else
+        cout << "\ttestDiffTimeMeasurement() returned false." << endl;
+
+    Show show17;
+
+    if (tester.testSpatialQueries(show17)) // should return true
+        cout << "\ttestSpatialQueries() returned true." << endl;
+    else
+        cout << "\ttestSpatialQueries() returned false." << endl;
+
+    if (tester.testCollisionTimeMeasurement()) // should return true
+        cout << "\ttestCollisionTimeMeasurement() returned true." << endl;
+    else
+        cout << "\ttestCollisionTimeMeasurement() returned false." << endl;
+
+    if (tester.testSparseSpatialQueries()) // should return true
+        cout << "\ttestSparseSpatialQueries() returned true." << endl;
+    else
+        cout << "\ttestSparseSpatialQueries() returned false." << endl;
+
+    Show show18;
+
+    if (tester.testPayloadKernels(show18)) // should return true
+        cout << "\ttestPayloadKernels() returned true." << endl;
+    else
+        cout << "\ttestPayloadKernels() returned false." << endl;
+
+    if (tester.testPayloadMirror()) // should return true
+        cout << "\ttestPayloadMirror() returned true." << endl;
+    else
+        cout << "\ttestPayloadMirror() returned false." << endl;
+
+    if (tester.testKernelTimeMeasurement()) // should return true
+        cout << "\ttestKernelTimeMeasurement() returned true." << endl;
+    else
+        cout << "\ttestKernelTimeMeasurement() returned false." << endl;
+
+    Show show19;
+
+    if (tester.testFreeze(show19)) // should return true
+        cout << "\ttestFreeze() returned true." << endl;
+    else
+        cout << "\ttestFreeze() returned false." << endl;
+
+    if (tester.testFrozenTimeMeasurement()) // should return true
+        cout << "\ttestFrozenTimeMeasurement() returned true." << endl;
+    else
+        cout << "\ttestFrozenTimeMeasurement() returned false." << endl;
+
+    if (tester.testBatchLookupTimeMeasurement()) // should return true
+        cout << "\ttestBatchLookupTimeMeasurement() returned true." << endl;
+    else
+        cout << "\ttestBatchLookupTimeMeasurement() returned false." << endl;
+
+    if (tester.testShardedShow()) // should return true
+        cout << "\ttestShardedShow() returned true." << endl;
+    else
+        cout << "\ttestShardedShow() returned false." << endl;
+
+    if (tester.testShardScalingTimeMeasurement()) // should return true
+        cout << "\ttestShardScalingTimeMeasurement() returned true." << endl;
+    else
+        cout << "\ttestShardScalingTimeMeasurement() returned false." << endl;
+
+    Show show20;
+
+    if (tester.testEventQueue(show20)) // should return true
+        cout << "\ttestEventQueue() returned true." << endl;
+    else
+        cout << "\ttestEventQueue() returned false." << endl;
+
+    if (tester.testFramePipeline()) // should return true
+        cout << "\ttestFramePipeline() returned true." << endl;
+    else
+        cout << "\ttestFramePipeline() returned false." << endl;
+
+    if (tester.testFramePublishTimeMeasurement()) // should return true
+        cout << "\ttestFramePublishTimeMeasurement() returned true." << endl;
+    else
+        cout << "\ttestFramePublishTimeMeasurement() returned false." << endl;
+
+    if (tester.testJournalRecovery()) // should return true
+        cout << "\ttestJournalRecovery() returned true." << endl;
+    else
+        cout << "\ttestJournalRecovery() returned false." << endl;
+
+    if (tester.testJournalTimeMeasurement()) // should return true
+        cout << "\ttestJournalTimeMeasurement() returned true." << endl;
+    else
+        cout << "\ttestJournalTimeMeasurement() returned false." << endl;
+
+    if (tester.testSharedShow()) // should return true
+        cout << "\ttestSharedShow() returned true." << endl;
+    else
+        cout << "\ttestSharedShow() returned false." << endl;
+
+    if (tester.testBasicShow()) // should return true
+        cout << "\ttestBasicShow() returned true." << endl;
+    else
+        cout << "\ttestBasicShow() returned false." << endl;
+
+    if (tester.testFingerInsert()) // should return true
+        cout << "\ttestFingerInsert() returned true." << endl;
+    else
+        cout << "\ttestFingerInsert() returned false." << endl;
+
+    if (tester.testFingerInsertTimeMeasurement()) // should return true
+        cout << "\ttestFingerInsertTimeMeasurement() returned true." << endl;
+    else
+        cout << "\ttestFingerInsertTimeMeasurement() returned false." << endl;
+
+    if (tester.testDeferredRemove()) // should return true
+        cout << "\ttestDeferredRemove() returned true." << endl;
+    else
+        cout << "\ttestDeferredRemove() returned false." << endl;
+
+    if (tester.testDeferredRemoveTimeMeasurement()) // should return true
+        cout << "\ttestDeferredRemoveTimeMeasurement() returned true." << endl;
+    else
+        cout << "\ttestDeferredRemoveTimeMeasurement() returned false." << endl;
+
+    if (tester.testHotCache()) // should return true
+        cout << "\ttestHotCache() returned true." << endl;
+    else
+        cout << "\ttestHotCache() returned false." << endl;
+
+    if (tester.testHotCacheTimeMeasurement()) // should return true
+        cout << "\ttestHotCacheTimeMeasurement() returned true." << endl;
+    else
+        cout << "\ttestHotCacheTimeMeasurement() returned false." << endl;
+
+    if (tester.testFormation()) // should return true
+        cout << "\ttestFormation() returned true." << endl;
+    else
+        cout << "\ttestFormation() returned false." << endl;
+
+    if (tester.testFormationTimeMeasurement()) // should return true
+        cout << "\ttestFormationTimeMeasurement() returned true." << endl;
+    else
+        cout << "\ttestFormationTimeMeasurement() returned false." << endl;
+
+    if (tester.testHistory()) // should return true
+        cout << "\ttestHistory() returned true." << endl;
+    else
+        cout << "\ttestHistory() returned false." << endl;
+
+    if (tester.testHistoryTimeMeasurement()) // should return true
+        cout << "\ttestHistoryTimeMeasurement() returned true." << endl;
+    else
+        cout << "\ttestHistoryTimeMeasurement() returned false." << endl;
+
+    if (tester.testCueScheduler()) // should return true
+        cout << "\ttestCueScheduler() returned true." << endl;
+    else
+        cout << "\ttestCueScheduler() returned false." << endl;
+
+    if (tester.testCueSchedulerTimeMeasurement()) // should return true
+        cout << "\ttestCueSchedulerTimeMeasurement() returned true." << endl;
+    else
+        cout << "\ttestCueSchedulerTimeMeasurement() returned false." << endl;
+
+#if defined(__cpp_impl_coroutine)
+    if (tester.testCueCoroutine()) // should return true
+        cout << "\ttestCueCoroutine() returned true." << endl;
+    else
+        cout << "\ttestCueCoroutine() returned false." << endl;
+#endif
+
+    if (tester.testFrameCodec()) // should return true
+        cout << "\ttestFrameCodec() returned true." << endl;
+    else
+        cout << "\ttestFrameCodec() returned false." << endl;
+
+    if (tester.testFrameCodecTimeMeasurement()) // should return true
+        cout << "\ttestFrameCodecTimeMeasurement() returned true." << endl;
+    else
+        cout << "\ttestFrameCodecTimeMeasurement() returned false." << endl;
+
+    if (tester.testCheckedMode()) // should return true
+        cout << "\ttestCheckedMode() returned true." << endl;
+    else
+        cout << "\ttestCheckedMode() returned false." << endl;
+
+    if (tester.testCheckedModeTimeMeasurement()) // should return true
+        cout << "\ttestCheckedModeTimeMeasurement() returned true." << endl;
+    else
+        cout << "\ttestCheckedModeTimeMeasurement() returned false." << endl;
+
+    if (tester.testQuery()) // should return true
+        cout << "\ttestQuery() returned true." << endl;
+    else
+        cout << "\ttestQuery() returned false." << endl;
+
+    if (tester.testQueryTimeMeasurement()) // should return true
+        cout << "\ttestQueryTimeMeasurement() returned true." << endl;
+    else
+        cout << "\ttestQueryTimeMeasurement() returned false." << endl;
+
+    if (tester.testLightFrame()) // should return true
+        cout << "\ttestLightFrame() returned true." << endl;
+    else
+        cout << "\ttestLightFrame() returned false." << endl;
+
+    if (tester.testLightFrameTimeMeasurement()) // should return true
+        cout << "\ttestLightFrameTimeMeasurement() returned true." << endl;
+    else
+        cout << "\ttestLightFrameTimeMeasurement() returned false." << endl;
+
 
     {
         Show show;
@@ -790,4 +1116,3028 @@ bool Tester::testInsertTimeMeasurement() {
     result = result && ((1.1-0.4) <= (measureTime2/(2*measureTime1)) && (measureTime2/(2*measureTime1))  <= (1.1+0.4)); // should be true
 
     return result;
-}
\ No newline at end of file
+}
+//Function: Tester::testCopyConstructor
+//Case: Insert 1000 nodes, copy construct a second show and remove a node from the first one
+//Expected result: should return true as the copy has its own nodes and still holds all 1000 drones
+bool Tester::testCopyConstructor(){
+    Random typeGen(0,2);
+    Random stateGen(0,1);
+
+    Show show1;
+    bool result = true;
+
+    int teamSize = 1000;
+    int ID = 10000;
+    for(int i=0;i<teamSize;i++) {
+        Drone drone(ID, static_cast<LIGHTCOLOR>(typeGen.getRandNum()), static_cast<STATE>(stateGen.getRandNum()));
+        show1.insert(drone);
+        ID++;
+    }
+
+    Show show2(show1); // copy constructor
+    show1.remove(10000);
+
+    result = result && (show2.m_root != show1.m_root); // not sharing nodes
+    result = result && (show2.countNodes(show2.m_root) == teamSize);
+    result = result && (show1.countNodes(show1.m_root) == teamSize - 1);
+    result = result && show2.findDrone(10000);
+    result = result && show2.testBSTProperty(show2.m_root);
+    result = result && show2.testBalance(show2.m_root);
+
+    return result;
+}
+//Function: Tester::testMoveSemantics
+//Case: Insert 1000 nodes, move construct, move assign and swap the show
+//Expected result: should return true as the same root node is handed over every time
+//and the moved from shows are left empty
+bool Tester::testMoveSemantics(){
+    Random typeGen(0,2);
+
+    Show show1;
+    bool result = true;
+
+    int teamSize = 1000;
+    int ID = 10000;
+    for(int i=0;i<teamSize;i++) {
+        Drone drone(ID, static_cast<LIGHTCOLOR>(typeGen.getRandNum()));
+        show1.insert(drone);
+        ID++;
+    }
+    Drone *root = show1.m_root;
+
+    Show show2(std::move(show1)); // move constructor
+    result = result && (show2.m_root == root && show1.m_root == nullptr);
+
+    Show show3;
+    show3.insert(Drone(50000));
+    show3 = std::move(show2); // move assignment frees the old tree of show3
+    result = result && (show3.m_root == root && show2.m_root == nullptr);
+    result = result && !show3.findDrone(50000);
+
+    Show show4;
+    show4.insert(Drone(50000));
+    swap(show3, show4);
+    result = result && (show4.m_root == root);
+    result = result && (show3.countNodes(show3.m_root) == 1 && show3.findDrone(50000));
+    result = result && (show4.countNodes(show4.m_root) == teamSize);
+
+    return result;
+}
+//Function: Tester::testEmplace
+//Case: Insert 1000 BLUE nodes with emplace and 1000 with insert(Drone&&), then an invalid and a duplicate ID
+//Expected result: should return true as all 2000 valid drones are added with their color
+//and the invalid and duplicate ones are rejected
+bool Tester::testEmplace(Show & ashow){
+    bool result = true;
+
+    int teamSize = 1000;
+    int ID = 10000;
+    for(int i=0;i<teamSize;i++) {
+        ashow.emplace(ID, BLUE, LIGHTOFF);
+        ID++;
+    }
+    for(int i=0;i<teamSize;i++) {
+        ashow.insert(Drone(ID, GREEN));
+        ID++;
+    }
+    ashow.emplace(5000, RED); // invalid ID
+    ashow.emplace(10000, RED); // duplicate ID
+
+    result = result && (ashow.countNodes(ashow.m_root) == 2 * teamSize);
+    result = result && (ashow.countDrones(BLUE) == teamSize);
+    result = result && (ashow.countDrones(GREEN) == teamSize);
+    result = result && (ashow.helpCountState(ashow.m_root, LIGHTOFF) == teamSize);
+    result = result && ashow.testBSTProperty(ashow.m_root);
+    result = result && ashow.testBalance(ashow.m_root);
+
+    return result;
+}
+//Function: Tester::removeTwoKidsCase
+//Case: Insert 1000 nodes whose color and state follow their ID, then remove the root 500 times
+//Expected result: should return true as the root always has two kids here, the successor keeps
+//its own color and state and its node address, and the tree stays balanced
+bool Tester::removeTwoKidsCase(Show & ashow){
+    bool result = true;
+
+    int teamSize = 1000;
+    int ID = 10000;
+    for(int i=0;i<teamSize;i++) {
+        ashow.insert(Drone(ID, static_cast<LIGHTCOLOR>(ID % 3), static_cast<STATE>(ID % 2)));
+        ID++;
+    }
+
+    for(int i=0;i<teamSize/2;i++) {
+        Drone *root = ashow.m_root;
+        Drone *successor = root->m_right;
+        while (successor->m_left != nullptr) {
+            successor = successor->m_left;
+        }
+        int successorID = successor->m_id;
+        ashow.remove(root->m_id);
+        result = result && (ashow.findHelper(successorID, ashow.m_root) == successor); // same node
+    }
+
+    Drone *check[1000];
+    int count = 0;
+    for(int i=10000;i<10000 + teamSize;i++) {
+        Drone *drone = ashow.findHelper(i, ashow.m_root);
+        if (drone != nullptr) {
+            check[count++] = drone;
+        }
+    }
+    for(int i=0;i<count;i++) { // payload must still match the ID it was inserted with
+        result = result && (ashow.typeOf(check[i]) == check[i]->m_id % 3);
+        result = result && (ashow.stateOf(check[i]) == check[i]->m_id % 2);
+    }
+    result = result && (count == teamSize / 2);
+    result = result && ashow.testBSTProperty(ashow.m_root);
+    result = result && ashow.testBalance(ashow.m_root);
+
+    return result;
+}
+//Function: Tester::testRangeAgainstLoop
+//Case: Two shows with the same 10000 drones, one gets 500 random setStateRange/setColorRange calls
+//and the other one the same updates through setState/setColor on every ID, with inserts and
+//removes mixed in so rotations run while values are still pending
+//Expected result: should return true as every drone, countDrones and the LIGHTOFF count match
+bool Tester::testRangeAgainstLoop(){
+    Random idGen(MINID,MINID + 19999);
+    Random typeGen(0,2);
+    Random stateGen(0,1);
+    Random widthGen(0,3000);
+
+    Show show1; // range updates
+    Show show2; // brute force loop
+    bool result = true;
+
+    for(int i=0;i<10000;i++) {
+        Drone drone(idGen.getRandNum(), static_cast<LIGHTCOLOR>(typeGen.getRandNum()), static_cast<STATE>(stateGen.getRandNum()));
+        show1.insert(drone);
+        show2.insert(drone);
+    }
+
+    for(int i=0;i<500;i++) {
+        int lo = idGen.getRandNum();
+        int hi = lo + widthGen.getRandNum();
+        if (i % 2 == 0) {
+            STATE state = static_cast<STATE>(stateGen.getRandNum());
+            show1.setStateRange(lo, hi, state);
+            for(int id=lo;id<=hi;id++) {
+                show2.setState(id, state);
+            }
+        }
+        else {
+            LIGHTCOLOR color = static_cast<LIGHTCOLOR>(typeGen.getRandNum());
+            show1.setColorRange(lo, hi, color);
+            for(int id=lo;id<=hi;id++) {
+                show2.setColor(id, color);
+            }
+        }
+        int id = idGen.getRandNum(); // same structural change in both
+        if (i % 3 == 0) {
+            show1.remove(id);
+            show2.remove(id);
+        }
+        else {
+            Drone drone(id, static_cast<LIGHTCOLOR>(typeGen.getRandNum()), static_cast<STATE>(stateGen.getRandNum()));
+            show1.insert(drone);
+            show2.insert(drone);
+        }
+    }
+
+    // counts go through the pending values without pushing them
+    result = result && (show1.countDrones(RED) == show2.countDrones(RED));
+    result = result && (show1.countDrones(GREEN) == show2.countDrones(GREEN));
+    result = result && (show1.countDrones(BLUE) == show2.countDrones(BLUE));
+    result = result && (show1.helpCountState(show1.m_root, LIGHTOFF) == show2.helpCountState(show2.m_root, LIGHTOFF));
+
+    for(int id=MINID;id<=MINID + 19999 + 3000;id++) {
+        Drone *drone1 = show1.accessHelper(id, show1.m_root);
+        Drone *drone2 = show2.accessHelper(id, show2.m_root);
+        if (drone1 == nullptr || drone2 == nullptr) {
+            result = result && (drone1 == drone2);
+        }
+        else {
+            result = result && (show1.stateOf(drone1) == show2.stateOf(drone2) && show1.typeOf(drone1) == show2.typeOf(drone2));
+        }
+    }
+    result = result && show1.testBSTProperty(show1.m_root);
+    result = result && show1.testBalance(show1.m_root);
+
+    return result;
+}
+//Function: Tester::testRangeTimeMeasurement
+//Case: Fill the whole ID space (90000 drones) and switch the block 20000-29999 and then everything
+//off and on 100 times, once with setStateRange and once with setState on every ID
+//Expected result: should return true as the range version only tags subtrees and is much faster
+bool Tester::testRangeTimeMeasurement(){
+    Show show1;
+    bool result = true;
+
+    for(int i=MINID;i<=MAXID;i++){
+        show1.emplace(i, static_cast<LIGHTCOLOR>(i % 3));
+    }
+
+    int rounds = 100;
+    clock_t start, stop;//stores the clock ticks while running the program
+    start = clock();
+    for(int i=0;i<rounds;i++) {
+        show1.setStateRange(20000, 29999, LIGHTOFF);
+        show1.setStateRange(MINID, MAXID, static_cast<STATE>(i % 2));
+    }
+    stop = clock();
+    double measureTime1 = (double)(stop - start)/CLOCKS_PER_SEC;//time in seconds
+
+    start = clock();
+    for(int i=0;i<rounds;i++) {
+        for(int id=20000;id<=29999;id++) {
+            show1.setState(id, LIGHTOFF);
+        }
+        for(int id=MINID;id<=MAXID;id++) {
+            show1.setState(id, static_cast<STATE>(i % 2));
+        }
+    }
+    stop = clock();
+    double measureTime2 = (double)(stop - start)/CLOCKS_PER_SEC;//time in seconds
+
+    cout << "range updates: " << measureTime1 << " seconds" << endl;
+    cout << "setState loop: " << measureTime2 << " seconds" << endl;
+    result = result && (measureTime1 < measureTime2);
+    result = result && (show1.helpCountState(show1.m_root, LIGHTOFF) == MAXID - MINID + 1); // last round was LIGHTOFF
+
+    return result;
+}
+//Function: Tester::testColorIndex
+//Case: Insert 5000 nodes, then mix removes, setState, setColor, range updates, removeLightOff
+//and a copy, and compare getDrones and countDrones with the drones found by walking every ID
+//Expected result: should return true as the indexes list exactly the drones of each class in ID order,
+//and a color or state outside the enum counts and lists nothing
+bool Tester::testColorIndex(Show & ashow){
+    Random idGen(MINID,MINID + 9999);
+    Random typeGen(0,2);
+    Random stateGen(0,1);
+
+    bool result = true;
+
+    for(int i=0;i<5000;i++) {
+        ashow.insert(Drone(idGen.getRandNum(), static_cast<LIGHTCOLOR>(typeGen.getRandNum()), static_cast<STATE>(stateGen.getRandNum())));
+    }
+    for(int i=0;i<2000;i++) {
+        int id = idGen.getRandNum();
+        switch (i % 5) {
+            case 0: ashow.remove(id); break;
+            case 1: ashow.setState(id, static_cast<STATE>(stateGen.getRandNum())); break;
+            case 2: ashow.setColor(id, static_cast<LIGHTCOLOR>(typeGen.getRandNum())); break;
+            case 3: ashow.setStateRange(id, id + 100, static_cast<STATE>(stateGen.getRandNum())); break;
+            default: ashow.setColorRange(id, id + 100, static_cast<LIGHTCOLOR>(typeGen.getRandNum())); break;
+        }
+    }
+    ashow.removeLightOff();
+    ashow.setStateRange(MINID, MINID + 999, LIGHTOFF);
+    Show copy(ashow);
+
+    vector<int> colors[NUMCOLORS];
+    vector<int> states[NUMSTATES];
+    for(int id=MINID;id<=MINID + 9999;id++) { // brute force, in ID order
+        Drone *drone = copy.accessHelper(id, copy.m_root);
+        if (drone != nullptr) {
+            colors[copy.typeOf(drone)].push_back(id);
+            states[copy.stateOf(drone)].push_back(id);
+        }
+    }
+    for(int i=0;i<NUMCOLORS;i++) {
+        result = result && (copy.getDrones(static_cast<LIGHTCOLOR>(i)) == colors[i]);
+        result = result && (copy.countDrones(static_cast<LIGHTCOLOR>(i)) == (int)colors[i].size());
+        result = result && (copy.helpCount(copy.m_root, static_cast<LIGHTCOLOR>(i)) == (int)colors[i].size());
+    }
+    for(int i=0;i<NUMSTATES;i++) {
+        result = result && (copy.getDrones(static_cast<STATE>(i)) == states[i]);
+        result = result && (copy.countDrones(static_cast<STATE>(i)) == (int)states[i].size());
+    }
+    result = result && (states[LIGHTOFF].size() > 0); // the last range update turned some off
+    result = result && (copy.countDrones(static_cast<LIGHTCOLOR>(NUMCOLORS)) == 0 && copy.countDrones(static_cast<LIGHTCOLOR>(-1)) == 0);
+    result = result && (copy.countDrones(static_cast<STATE>(NUMSTATES)) == 0 && copy.getDrones(static_cast<STATE>(-1)).empty());
+    result = result && copy.getDrones(static_cast<LIGHTCOLOR>(7)).empty();
+
+    return result;
+}
+//Function: Tester::testDiffApply
+//Case: Copy a show of 5000 drones, change the copy with inserts, removes, single and range updates,
+//then apply the diff between the two to the original
+//Expected result: should return true as the diff lists every kind of change and the original
+//ends up with exactly the same drones, colors and states as the changed copy
+bool Tester::testDiffApply(){
+    Random idGen(MINID,MINID + 9999);
+    Random typeGen(0,2);
+    Random stateGen(0,1);
+
+    Show previous;
+    bool result = true;
+
+    for(int i=0;i<5000;i++) {
+        previous.insert(Drone(idGen.getRandNum(), static_cast<LIGHTCOLOR>(typeGen.getRandNum()), static_cast<STATE>(stateGen.getRandNum())));
+    }
+    Show current(previous);
+    result = result && current.diff(previous).empty();
+
+    for(int i=0;i<1000;i++) {
+        int id = idGen.getRandNum();
+        switch (i % 4) {
+            case 0: current.remove(id); break;
+            case 1: current.emplace(id, static_cast<LIGHTCOLOR>(typeGen.getRandNum())); break;
+            case 2: current.setState(id, static_cast<STATE>(stateGen.getRandNum())); break;
+            default: current.setColorRange(id, id + 20, static_cast<LIGHTCOLOR>(typeGen.getRandNum())); break;
+        }
+    }
+
+    ChangeSet changes = current.diff(previous);
+    result = result && !changes.added.empty() && !changes.removed.empty() && !changes.changed.empty();
+
+    previous.apply(changes);
+    result = result && current.diff(previous).empty();
+    result = result && previous.diff(current).empty();
+    for(int i=0;i<NUMCOLORS;i++) {
+        result = result && (previous.countDrones(static_cast<LIGHTCOLOR>(i)) == current.countDrones(static_cast<LIGHTCOLOR>(i)));
+    }
+    result = result && (previous.countDrones(LIGHTOFF) == current.countDrones(LIGHTOFF));
+    result = result && previous.testBSTProperty(previous.m_root);
+    result = result && previous.testBalance(previous.m_root);
+
+    return result;
+}
+//Function: Tester::testDiffTimeMeasurement
+//Case: 90000 drones where 1% change between frames, 100 frames are synchronized to a second show
+//once with diff and apply and once by copying the whole show with operator=
+//Expected result: should return true as diff and apply skips allocating and linking 90000 nodes
+bool Tester::testDiffTimeMeasurement(){
+    Random idGen(MINID,MAXID);
+    Random stateGen(0,1);
+
+    Show current;
+    Show previous;
+    Show copied;
+    bool result = true;
+
+    for(int i=MINID;i<=MAXID;i++){
+        current.emplace(i, static_cast<LIGHTCOLOR>(i % 3));
+    }
+    previous = current;
+
+    int frames = 100;
+    double diffTime = 0.0;
+    double copyTime = 0.0;
+    clock_t start, stop;//stores the clock ticks while running the program
+    for(int frame=0;frame<frames;frame++) {
+        for(int i=0;i<900;i++) {
+            current.setState(idGen.getRandNum(), static_cast<STATE>(stateGen.getRandNum()));
+        }
+
+        start = clock();
+        previous.apply(current.diff(previous));
+        stop = clock();
+        diffTime += (double)(stop - start)/CLOCKS_PER_SEC;
+
+        start = clock();
+        copied = current;
+        stop = clock();
+        copyTime += (double)(stop - start)/CLOCKS_PER_SEC;
+    }
+
+    cout << "diff and apply: " << diffTime << " seconds" << endl;
+    cout << "operator=: " << copyTime << " seconds" << endl;
+    result = result && current.diff(previous).empty();
+    result = result && (diffTime < copyTime);
+
+    return result;
+}
+//Function: Tester::testSpatialQueries
+//Case: Insert 3000 drones at random positions in a 60m cube, move 1000 of them, remove 500,
+//then run radius, nearest and collision queries and check them against every drone in the tree
+//Expected result: should return true as the grid finds exactly the same drones as the full scan
+bool Tester::testSpatialQueries(Show & ashow){
+    Random idGen(MINID,MAXID);
+    Random posGen(0,60,UNIFORMREAL);
+
+    bool result = true;
+    int ids[3000];
+
+    for(int i=0;i<3000;i++) {
+        Drone drone(idGen.getRandNum());
+        drone.setPosition(posGen.getRealRandNum(), posGen.getRealRandNum(), posGen.getRealRandNum());
+        ashow.insert(drone);
+        ids[i] = drone.getID();
+    }
+    for(int i=0;i<1000;i++) {
+        ashow.moveDrone(ids[i], posGen.getRealRandNum(), posGen.getRealRandNum(), posGen.getRealRandNum());
+    }
+    for(int i=1000;i<1500;i++) {
+        ashow.remove(ids[i]);
+    }
+
+    vector<Drone*> all; // brute force list of every drone
+    for(int id=MINID;id<=MAXID;id++) {
+        Drone *drone = ashow.findHelper(id, ashow.m_root);
+        if (drone != nullptr) {
+            all.push_back(drone);
+        }
+    }
+    result = result && ((int)all.size() == ashow.m_grid.size());
+
+    double radius = 3.0;
+    vector<int> near = ashow.findNear(30, 30, 30, 10);
+    vector<int> expected;
+    for(int i=0;i<(int)all.size();i++) {
+        double dx = all[i]->getX() - 30, dy = all[i]->getY() - 30, dz = all[i]->getZ() - 30;
+        if (dx * dx + dy * dy + dz * dz <= 100) {
+            expected.push_back(all[i]->getID());
+        }
+    }
+    result = result && (near == expected);
+
+    vector<int> nearest = ashow.findNearest(-5, 70, 12, 10); // outside the cube
+    double furthest = 0;
+    for(int i=0;i<(int)nearest.size();i++) {
+        Drone *drone = ashow.findHelper(nearest[i], ashow.m_root);
+        double dx = drone->getX() + 5, dy = drone->getY() - 70, dz = drone->getZ() - 12;
+        furthest = dx * dx + dy * dy + dz * dz; // comes closest first so the last one is the furthest
+    }
+    int closer = 0;
+    for(int i=0;i<(int)all.size();i++) {
+        double dx = all[i]->getX() + 5, dy = all[i]->getY() - 70, dz = all[i]->getZ() - 12;
+        if (dx * dx + dy * dy + dz * dz < furthest) {
+            closer++;
+        }
+    }
+    result = result && (nearest.size() == 10 && closer < 10);
+
+    vector<pair<int,int> > pairs = ashow.findCollisions(radius);
+    vector<pair<int,int> > expectedPairs;
+    for(int i=0;i<(int)all.size();i++) {
+        for(int j=i+1;j<(int)all.size();j++) {
+            double dx = all[i]->getX() - all[j]->getX();
+            double dy = all[i]->getY() - all[j]->getY();
+            double dz = all[i]->getZ() - all[j]->getZ();
+            if (dx * dx + dy * dy + dz * dz <= radius * radius) {
+                expectedPairs.push_back(make_pair(all[i]->getID(), all[j]->getID())); // all is in ID order
+            }
+        }
+    }
+    result = result && !pairs.empty() && (pairs == expectedPairs);
+
+    ashow.setCellSize(7.5); // bigger cells, same answers
+    result = result && (ashow.findCollisions(radius) == expectedPairs);
+    result = result && (ashow.findNear(30, 30, 30, 10) == expected);
+
+    return result;
+}
+//Function: Tester::testCollisionTimeMeasurement
+//Case: 20000 drones spread out with about 2m between them, find every pair closer than 1m with the grid
+//and with the O(n^2) scan, then time the grid on the full 90000 drone ID space
+//Expected result: should return true as both find the same number of pairs and the grid is much faster
+bool Tester::testCollisionTimeMeasurement(){
+    Random posGen(0,55,UNIFORMREAL);
+
+    Show show1;
+    bool result = true;
+    double radius = 1.0;
+    show1.setCellSize(radius);
+
+    for(int i=MINID;i<MINID + 20000;i++){
+        Drone drone(i);
+        drone.setPosition(posGen.getRealRandNum(), posGen.getRealRandNum(), posGen.getRealRandNum());
+        show1.insert(drone);
+    }
+
+    clock_t start, stop;//stores the clock ticks while running the program
+    start = clock();
+    int gridPairs = show1.findCollisions(radius).size();
+    stop = clock();
+    double gridTime = (double)(stop - start)/CLOCKS_PER_SEC;
+
+    vector<Drone*> all;
+    for(int id=MINID;id<MINID + 20000;id++) {
+        all.push_back(show1.findHelper(id, show1.m_root));
+    }
+    start = clock();
+    int scanPairs = 0;
+    for(int i=0;i<(int)all.size();i++) {
+        for(int j=i+1;j<(int)all.size();j++) {
+            double dx = all[i]->getX() - all[j]->getX();
+            double dy = all[i]->getY() - all[j]->getY();
+            double dz = all[i]->getZ() - all[j]->getZ();
+            if (dx * dx + dy * dy + dz * dz <= radius * radius) {
+                scanPairs++;
+            }
+        }
+    }
+    stop = clock();
+    double scanTime = (double)(stop - start)/CLOCKS_PER_SEC;
+
+    for(int i=MINID + 20000;i<=MAXID;i++){ // grow to the whole ID space, same density
+        Drone drone(i);
+        drone.setPosition(posGen.getRealRandNum() * 1.65, posGen.getRealRandNum() * 1.65, posGen.getRealRandNum() * 1.65);
+        show1.insert(drone);
+    }
+    start = clock();
+    show1.findCollisions(radius);
+    stop = clock();
+    double fullTime = (double)(stop - start)/CLOCKS_PER_SEC;
+
+    cout << "grid, 20000 drones: " << gridTime << " seconds, " << gridPairs << " pairs" << endl;
+    cout << "all pairs, 20000 drones: " << scanTime << " seconds, " << scanPairs << " pairs" << endl;
+    cout << "grid, 90000 drones: " << fullTime << " seconds" << endl;
+    result = result && (gridPairs == scanPairs);
+    result = result && (gridTime < scanTime);
+
+    return result;
+}
+//Function: Tester::testPayloadKernels
+//Case: Insert 10000 drones, remove 3000 so the store has free slots, do a range update,
+//then count with the column kernels and flip every state
+//Expected result: should return true as the kernels skip free slots and match the tree walks,
+//and after flipStates the LIGHTON and LIGHTOFF counts have swapped; the nodes' getType and
+//getState agree with the store, and the kernels skip the slots of deferred removes
+bool Tester::testPayloadKernels(Show & ashow){
+    Random idGen(MINID,MAXID);
+    Random typeGen(0,2);
+    Random stateGen(0,1);
+
+    bool result = true;
+    int ids[10000];
+
+    for(int i=0;i<10000;i++) {
+        ids[i] = idGen.getRandNum();
+        ashow.insert(Drone(ids[i], static_cast<LIGHTCOLOR>(typeGen.getRandNum()), static_cast<STATE>(stateGen.getRandNum())));
+    }
+    for(int i=0;i<3000;i++) {
+        ashow.remove(ids[i]);
+    }
+    ashow.setStateRange(30000, 40000, LIGHTOFF); // leaves pending values in the tree
+    ashow.flushTags();
+
+    result = result && (ashow.m_store.slots() > ashow.m_store.size()); // some slots are free
+    for(int i=0;i<NUMCOLORS;i++) {
+        int walk = ashow.helpCount(ashow.m_root, static_cast<LIGHTCOLOR>(i));
+        result = result && (ashow.m_store.countColor(i) == walk);
+        result = result && (PayloadStore::countBytes(ashow.m_store.colors(), ashow.m_store.slots(), i) == walk);
+    }
+    int off = ashow.helpCountState(ashow.m_root, LIGHTOFF);
+    result = result && (ashow.m_store.countState(LIGHTOFF) == off);
+
+    int on = ashow.countDrones(LIGHTON);
+    ashow.setColorRange(50000, 60000, BLUE); // flip has to flush this too
+    ashow.flipStates();
+    result = result && (ashow.countDrones(LIGHTOFF) == on && ashow.countDrones(LIGHTON) == off);
+    result = result && (ashow.m_store.countState(LIGHTOFF) == on);
+    result = result && (ashow.helpCountState(ashow.m_root, LIGHTOFF) == on);
+    result = result && (ashow.getDrones(LIGHTOFF).size() == (unsigned)on);
+    result = result && (ashow.m_store.countColor(BLUE) == ashow.countDrones(BLUE));
+
+    for(int i=3000;i<4000;i++) { // the nodes' own copies follow the store
+        ashow.setState(ids[i], static_cast<STATE>(i % NUMSTATES));
+        ashow.setColor(ids[i], static_cast<LIGHTCOLOR>(i % NUMCOLORS));
+    }
+    ashow.setColorRange(20000, 25000, GREEN);
+    ashow.flushTags();
+    ashow.flipStates();
+    std::function<bool(const Drone*)> sameNodes = [&ashow, &sameNodes](const Drone *curr) { // reached by getLeft and getRight
+        if (curr == nullptr) {
+            return true;
+        }
+        bool same = curr->m_dead || (curr->getType() == ashow.typeOf(curr) && curr->getState() == ashow.stateOf(curr));
+        return same && sameNodes(curr->getLeft()) && sameNodes(curr->getRight());
+    };
+    result = result && sameNodes(ashow.m_root);
+
+    ashow.setDeferredRemove(0.9); // dead slots are masked for the kernels
+    for(int i=4000;i<6000;i++) {
+        ashow.remove(ids[i]);
+    }
+    result = result && (ashow.countDead() > 0);
+    for(int i=0;i<NUMCOLORS;i++) {
+        result = result && (ashow.m_store.countColor(i) == ashow.countDrones(static_cast<LIGHTCOLOR>(i)));
+    }
+    result = result && (ashow.m_store.countState(LIGHTOFF) == ashow.countDrones(LIGHTOFF));
+    ashow.insert(Drone(ids[4000], BLUE, LIGHTOFF)); // comes back with the new payload
+    Drone *revived = ashow.findHelper(ids[4000], ashow.m_root);
+    result = result && (revived->getType() == BLUE && revived->getState() == LIGHTOFF);
+    result = result && (ashow.m_store.countColor(BLUE) == ashow.countDrones(BLUE));
+
+    return result;
+}
+//Function: Tester::testPayloadMirror
+//Case: the node keeps its color and state as a mirror of its PayloadStore slot; a show gets
+//random inserts, removes, single and range changes, query updates, flips, apply of a diff,
+//deferred removes with revivals and compaction, removeLightOff, a copy and a load
+//Expected result: should return true as after every step each live node holds exactly what
+//its slot holds, pending range values included, and every dead node's slot is free
+bool Tester::testPayloadMirror(){
+    bool result = true;
+    std::mt19937 generator(32);
+    Show show;
+    std::function<bool(const Show &, const Drone*)> mirrored = [&mirrored](const Show & aShow, const Drone *curr) {
+        if (curr == nullptr) {
+            return true;
+        }
+        int color = aShow.m_store.getColor(curr->m_slot);
+        int state = aShow.m_store.getState(curr->m_slot);
+        bool same = curr->m_dead ? (color == FREE_SLOT && state == FREE_SLOT)
+                                 : (color == curr->m_payload.type && state == curr->m_payload.state);
+        return same && mirrored(aShow, curr->m_left) && mirrored(aShow, curr->m_right);
+    };
+    for(int round=0;round<40;round++) {
+        if (round == 10) {
+            show.setDeferredRemove(0.3);
+        }
+        for(int i=0;i<300;i++) {
+            int id = MINID + generator() % 3000;
+            switch (generator() % 8) {
+                case 0: case 1: show.emplace(id, static_cast<LIGHTCOLOR>(generator() % NUMCOLORS), static_cast<STATE>(generator() % NUMSTATES)); break;
+                case 2: show.remove(id); break;
+                case 3: show.setState(id, static_cast<STATE>(generator() % NUMSTATES)); break;
+                case 4: show.setColor(id, static_cast<LIGHTCOLOR>(generator() % NUMCOLORS)); break;
+                case 5: show.setStateRange(id, id + generator() % 500, static_cast<STATE>(generator() % NUMSTATES)); break;
+                case 6: show.setColorRange(id, id + generator() % 500, static_cast<LIGHTCOLOR>(generator() % NUMCOLORS)); break;
+                default: show.setColor(DroneQuery{id, id + 300, NO_TAG, LIGHTOFF}, BLUE); break;
+            }
+        }
+        result = result && mirrored(show, show.m_root);
+        switch (round % 5) {
+            case 0: show.flipStates(); break;
+            case 1: { // the next frame has some drones gone, some new and some changed
+                Show next(show);
+                for(int i=0;i<200;i++) {
+                    int id = MINID + generator() % 3000;
+                    next.remove(id);
+                    next.emplace(id + 1, GREEN, LIGHTOFF);
+                    next.setState(id + 2, LIGHTON);
+                }
+                result = result && mirrored(next, next.m_root);
+                show.apply(next.diff(show));
+                break;
+            }
+            case 2: show.removeLightOff(); break;
+            case 3: show.compact(); break;
+            default: {
+                Show copy(show);
+                result = result && mirrored(copy, copy.m_root);
+                show.load(copy.diff(Show()).added);
+                break;
+            }
+        }
+        result = result && mirrored(show, show.m_root);
+    }
+    result = result && (show.countDead() > 0 || show.m_deadFraction > 0);
+    show.flushTags();
+    result = result && mirrored(show, show.m_root);
+
+    return result;
+}
+//Function: Tester::testKernelTimeMeasurement
+//Case: Count colors and states of 90000 drones 100 times with the tree walks and with the column
+//kernels, then count a 1000000 entry column with the scalar loop and the vector kernel
+//Expected result: should return true as every way counts the same and the kernels beat the walks
+bool Tester::testKernelTimeMeasurement(){
+    Show show1;
+    bool result = true;
+
+    for(int i=MINID;i<=MAXID;i++){
+        show1.emplace(i, static_cast<LIGHTCOLOR>(i % 3), static_cast<STATE>(i % 7 == 0));
+    }
+
+    int rounds = 100;
+    int walkCount = 0;
+    int kernelCount = 0;
+    clock_t start, stop;//stores the clock ticks while running the program
+    start = clock();
+    for(int i=0;i<rounds;i++) {
+        walkCount += show1.helpCount(show1.m_root, BLUE) + show1.helpCountState(show1.m_root, LIGHTOFF);
+    }
+    stop = clock();
+    double walkTime = (double)(stop - start)/CLOCKS_PER_SEC;
+
+    start = clock();
+    for(int i=0;i<rounds;i++) {
+        kernelCount += show1.m_store.countColor(BLUE) + show1.m_store.countState(LIGHTOFF);
+    }
+    stop = clock();
+    double kernelTime = (double)(stop - start)/CLOCKS_PER_SEC;
+
+    start = clock();
+    for(int i=0;i<rounds;i++) {
+        show1.flipStates();
+    }
+    stop = clock();
+    double flipTime = (double)(stop - start)/CLOCKS_PER_SEC;
+
+    vector<unsigned char> column(1000000);
+    for(int i=0;i<(int)column.size();i++) {
+        column[i] = (unsigned char)(i % 3);
+    }
+    int scalarCount = 0;
+    int vectorCount = 0;
+    start = clock();
+    for(int i=0;i<rounds;i++) {
+        scalarCount += PayloadStore::countBytes(column.data(), (int)column.size(), BLUE);
+    }
+    stop = clock();
+    double scalarTime = (double)(stop - start)/CLOCKS_PER_SEC;
+    start = clock();
+    for(int i=0;i<rounds;i++) {
+        vectorCount += PayloadStore::countBytesSIMD(column.data(), (int)column.size(), BLUE);
+    }
+    stop = clock();
+    double vectorTime = (double)(stop - start)/CLOCKS_PER_SEC;
+
+    cout << "tree walk counts, 90000 drones: " << walkTime << " seconds" << endl;
+    cout << "column kernel counts, 90000 drones: " << kernelTime << " seconds" << endl;
+    cout << "flipStates, 90000 drones: " << flipTime << " seconds" << endl;
+    cout << "scalar count, 1000000 entries: " << scalarTime << " seconds" << endl;
+    cout << "vector count, 1000000 entries: " << vectorTime << " seconds" << endl;
+    result = result && (walkCount == kernelCount);
+    result = result && (scalarCount == vectorCount);
+    result = result && (kernelTime < walkTime);
+    result = result && (show1.countDrones(LIGHTOFF) == show1.m_store.countState(LIGHTOFF)); // 100 flips, back to start
+
+    return result;
+}
+//Function: Tester::testFreeze
+//Case: Insert 7000 drones with a pending range update, freeze, look up every ID, change states
+//and colors one by one and by range while frozen, then insert a drone which thaws the show
+//Expected result: should return true as frozen lookups find exactly the drones in the tree,
+//the updates land on the same drones and the show is mutable again after the insert
+bool Tester::testFreeze(Show & ashow){
+    Random idGen(MINID,MINID + 19999);
+    Random typeGen(0,2);
+
+    bool result = true;
+
+    for(int i=0;i<7000;i++) {
+        ashow.insert(Drone(idGen.getRandNum(), static_cast<LIGHTCOLOR>(typeGen.getRandNum())));
+    }
+    ashow.setStateRange(MINID, MINID + 4999, LIGHTOFF);
+    Show reference(ashow);
+
+    ashow.freeze();
+    result = result && ashow.isFrozen() && !ashow.m_pending;
+    for(int id=MINID - 10;id<=MINID + 20010;id++) {
+        result = result && (ashow.findDrone(id) == reference.findDrone(id));
+    }
+    for(int id=MINID;id<=MINID + 19999;id += 3) {
+        ashow.setState(id, LIGHTON);
+        reference.setState(id, LIGHTON);
+        ashow.setColor(id + 1, BLUE);
+        reference.setColor(id + 1, BLUE);
+    }
+    ashow.setStateRange(MINID + 10000, MINID + 12000, LIGHTOFF); // updated right away while frozen
+    reference.setStateRange(MINID + 10000, MINID + 12000, LIGHTOFF);
+    ashow.setState(MINID + 11000, LIGHTON);
+    reference.setState(MINID + 11000, LIGHTON);
+    result = result && ashow.diff(reference).empty();
+
+    ashow.emplace(MAXID);
+    result = result && !ashow.isFrozen() && ashow.findDrone(MAXID);
+    result = result && (ashow.countDrones(LIGHTOFF) == reference.countDrones(LIGHTOFF));
+    result = result && ashow.testBalance(ashow.m_root);
+
+    return result;
+}
+//Function: Tester::testFrozenTimeMeasurement
+//Case: Shows of 1000, 10000 and 90000 drones, 2000000 random ID lookups each with findHelper
+//and with the frozen Eytzinger array
+//Expected result: should return true as both find the same IDs and the frozen search is faster
+//on the biggest show
+bool Tester::testFrozenTimeMeasurement(){
+    bool result = true;
+    int sizes[3] = {1000, 10000, 90000};
+    int lookups = 2000000;
+    vector<int> queries(lookups);
+    Random idGen(MINID,MAXID);
+    for(int i=0;i<lookups;i++) {
+        queries[i] = idGen.getRandNum();
+    }
+
+    for(int s=0;s<3;s++) {
+        Show show1;
+        int step = (MAXID - MINID + 1) / sizes[s];
+        for(int i=0;i<sizes[s];i++) {
+            show1.emplace(MINID + i * step);
+        }
+
+        int treeFound = 0;
+        int frozenFound = 0;
+        clock_t start, stop;//stores the clock ticks while running the program
+        start = clock();
+        for(int i=0;i<lookups;i++) {
+            treeFound += (show1.findHelper(queries[i], show1.m_root) != nullptr);
+        }
+        stop = clock();
+        double treeTime = (double)(stop - start)/CLOCKS_PER_SEC;
+
+        show1.freeze();
+        start = clock();
+        for(int i=0;i<lookups;i++) {
+            frozenFound += show1.findDrone(queries[i]);
+        }
+        stop = clock();
+        double frozenTime = (double)(stop - start)/CLOCKS_PER_SEC;
+
+        cout << sizes[s] << " drones, findHelper: " << lookups / treeTime << " lookups/second" << endl;
+        cout << sizes[s] << " drones, frozen: " << lookups / frozenTime << " lookups/second" << endl;
+        result = result && (treeFound == frozenFound);
+        if (s == 2) {
+            result = result && (frozenTime < treeTime);
+        }
+    }
+
+    return result;
+}
+//Function: Tester::testBatchLookupTimeMeasurement
+//Case: Insert every ID of the space in random order so the nodes are scattered in memory,
+//then look up 2000000 random IDs one at a time like sampleTimeMeasurement and as one batch
+//Expected result: should return true as the batch finds the same IDs and hides cache misses
+bool Tester::testBatchLookupTimeMeasurement(){
+    Show show1;
+    bool result = true;
+
+    int total = MAXID - MINID + 1;
+    vector<int> order(total);
+    for(int i=0;i<total;i++) {
+        order[i] = MINID + i;
+    }
+    Random pickGen(0,total - 1);
+    for(int i=total - 1;i>0;i--) { // shuffle
+        int j = pickGen.getRandNum() % (i + 1);
+        int temp = order[i];
+        order[i] = order[j];
+        order[j] = temp;
+    }
+    for(int i=0;i<total;i += 2) { // every other one, so half the lookups miss
+        show1.emplace(order[i]);
+    }
+
+    int lookups = 2000000;
+    vector<int> queries(lookups);
+    Random idGen(MINID,MAXID);
+    for(int i=0;i<lookups;i++) {
+        queries[i] = idGen.getRandNum();
+    }
+
+    double singleTime = sampleTimeMeasurement(show1, queries.data(), lookups);
+    int singleFound = 0;
+    for(int i=0;i<lookups;i++) {
+        singleFound += show1.findDrone(queries[i]);
+    }
+
+    bool *found = new bool[lookups];
+    clock_t start, stop;//stores the clock ticks while running the program
+    start = clock();
+    show1.findDrones(queries.data(), lookups, found);
+    stop = clock();
+    double batchTime = (double)(stop - start)/CLOCKS_PER_SEC;
+
+    int batchFound = 0;
+    for(int i=0;i<lookups;i++) {
+        batchFound += found[i];
+        result = result && (found[i] == show1.findDrone(queries[i]));
+    }
+    delete [] found;
+
+    cout << "one at a time: " << lookups / singleTime << " lookups/second" << endl;
+    cout << "batched: " << lookups / batchTime << " lookups/second" << endl;
+    result = result && (singleFound == batchFound);
+    result = result && (batchTime < singleTime);
+
+    return result;
+}
+//Function: Tester::testShardedShow
+//Case: Run the same inserts, removes, single and range updates and removeLightOff on a single show
+//and on a show split into 7 shards with 3 threads
+//Expected result: should return true as counts, lookups and the ordered lists are the same
+bool Tester::testShardedShow(){
+    Random idGen(MINID,MAXID);
+    Random typeGen(0,2);
+    Random stateGen(0,1);
+
+    Show single;
+    ShardedShow sharded(7, 3);
+    bool result = true;
+
+    vector<Drone> drones;
+    for(int i=0;i<20000;i++) {
+        drones.push_back(Drone(idGen.getRandNum(), static_cast<LIGHTCOLOR>(typeGen.getRandNum()), static_cast<STATE>(stateGen.getRandNum())));
+        single.insert(drones.back());
+    }
+    sharded.insertAll(drones);
+    sharded.insert(Drone(5000)); // invalid ID
+    result = result && (sharded.size() == single.countNodes(single.m_root));
+
+    for(int i=0;i<3000;i++) {
+        int id = idGen.getRandNum();
+        switch (i % 4) {
+            case 0: single.remove(id); sharded.remove(id); break;
+            case 1: single.setState(id, LIGHTOFF); sharded.setState(id, LIGHTOFF); break;
+            case 2: single.setColor(id, BLUE); sharded.setColor(id, BLUE); break;
+            default:
+                single.setStateRange(id, id + 5000, LIGHTON); // crosses shard borders
+                sharded.setStateRange(id, id + 5000, LIGHTON);
+                break;
+        }
+    }
+    single.setColorRange(20000, 60000, GREEN);
+    sharded.setColorRange(20000, 60000, GREEN);
+    single.removeLightOff();
+    sharded.removeLightOff();
+
+    for(int i=0;i<NUMCOLORS;i++) {
+        result = result && (sharded.getDrones(static_cast<LIGHTCOLOR>(i)) == single.getDrones(static_cast<LIGHTCOLOR>(i)));
+        result = result && (sharded.countDrones(static_cast<LIGHTCOLOR>(i)) == single.countDrones(static_cast<LIGHTCOLOR>(i)));
+    }
+    result = result && (sharded.countDrones(LIGHTOFF) == 0);
+    for(int id=MINID;id<=MAXID;id += 7) {
+        result = result && (sharded.findDrone(id) == single.findDrone(id));
+    }
+    for(int i=0;i<sharded.shardCount();i++) { // every shard only holds its own ID range
+        vector<int> ids = sharded.m_shards[i].getDrones(LIGHTON);
+        result = result && (ids.empty() || (sharded.shardOf(ids.front()) == i && sharded.shardOf(ids.back()) == i));
+    }
+
+    return result;
+}
+//Function: Tester::testShardScalingTimeMeasurement
+//Case: Fill all 90000 IDs into 8 shards, range update, flip and removeLightOff, with 1, 2, 4 and 8 threads
+//Expected result: should return true as every run ends with the same drones, the times show
+//how the bulk operations scale with the cores the machine has (wall clock, not clock())
+bool Tester::testShardScalingTimeMeasurement(){
+    bool result = true;
+    vector<Drone> drones;
+    for(int i=MINID;i<=MAXID;i++) {
+        drones.push_back(Drone(i, static_cast<LIGHTCOLOR>(i % 3), static_cast<STATE>(i % 5 == 0)));
+    }
+
+    int expected = -1;
+    for(int threads=1;threads<=8;threads *= 2) {
+        ShardedShow sharded(8, threads);
+        chrono::steady_clock::time_point start = chrono::steady_clock::now();
+        sharded.insertAll(drones);
+        sharded.setStateRange(30000, 39999, LIGHTOFF);
+        sharded.flipStates();
+        sharded.removeLightOff();
+        chrono::steady_clock::time_point stop = chrono::steady_clock::now();
+        double seconds = chrono::duration<double>(stop - start).count();
+
+        cout << threads << " threads, 8 shards: " << seconds << " seconds" << endl;
+        if (expected == -1) {
+            expected = sharded.size();
+        }
+        result = result && (sharded.size() == expected);
+    }
+    result = result && (expected == 10000 + 80000 / 5); // the block plus every fifth ID outside it
+
+    return result;
+}
+//Function: Tester::testEventQueue
+//Case: 4 telemetry threads push 200000 light and battery events each into a 4096 entry queue,
+//each thread for its own block of IDs, while this thread drains them into a show of 40000 drones
+//Expected result: should return true as no event is lost, every drone ends with the last event
+//its thread sent for it, and latency and back-pressure statistics are filled in
+bool Tester::testEventQueue(Show & ashow){
+    bool result = true;
+    int producers = 4;
+    int perProducer = 200000;
+    int block = 10000;
+
+    for(int i=MINID;i<MINID + producers * block;i++) {
+        ashow.emplace(i);
+    }
+
+    DroneEventQueue queue(4096);
+    vector<vector<int> > lastEvent(producers, vector<int>(block, -1)); // what each thread sent last per ID
+    vector<thread> threads;
+    for(int p=0;p<producers;p++) {
+        threads.push_back(thread([&queue, &lastEvent, p, perProducer, block]() {
+            std::mt19937 generator(p);
+            for(int i=0;i<perProducer;i++) {
+                int offset = generator() % block;
+                int roll = generator() % 100;
+                EVENTTYPE type = (roll == 0) ? EVENT_BATTERYFAIL : static_cast<EVENTTYPE>(roll % 2);
+                while (!queue.push(MINID + p * block + offset, type)) {
+                    std::this_thread::yield(); // back-pressure, wait for the owner
+                }
+                if (lastEvent[p][offset] != EVENT_BATTERYFAIL) {
+                    lastEvent[p][offset] = type;
+                }
+            }
+        }));
+    }
+
+    long long total = (long long)producers * perProducer;
+    while (queue.getDrained() < total) {
+        if (queue.drain(ashow, 1024) == 0) {
+            std::this_thread::yield();
+        }
+    }
+    for(int p=0;p<producers;p++) {
+        threads[p].join();
+    }
+
+    for(int p=0;p<producers;p++) {
+        for(int offset=0;offset<block;offset++) {
+            int id = MINID + p * block + offset;
+            Drone *drone = ashow.accessHelper(id, ashow.m_root);
+            switch (lastEvent[p][offset]) {
+                case -1: result = result && drone != nullptr && ashow.stateOf(drone) == LIGHTON; break;
+                case EVENT_BATTERYFAIL: result = result && drone == nullptr; break;
+                default: result = result && drone != nullptr && ashow.stateOf(drone) == lastEvent[p][offset]; break;
+            }
+        }
+    }
+
+    cout << "events: " << queue.getPushed() << " pushed, " << queue.getRejected() << " pushes hit a full queue, "
+         << queue.getCoalesced() << " coalesced, deepest " << queue.getMaxDepth() << endl;
+    cout << "latency: " << queue.getAverageLatency() * 1e6 << " microseconds average, "
+         << queue.getMaxLatency() * 1e6 << " microseconds max" << endl;
+    result = result && (queue.getPushed() == total && queue.getDrained() == total);
+    result = result && (queue.getAverageLatency() > 0);
+
+    return result;
+}//Function: Tester::testFramePipeline
+//Case: the writer makes random single and range changes over 30 frames, the reader acquires
+//after most of them and skips some, then stops reading for a long stretch of changes
+//Expected result: should return true as every acquired frame is the same as the writer's frame
+//at publish time, recycled buffers are caught up by replay, and the lagging one gets a full copy
+bool Tester::testFramePipeline(){
+    bool result = true;
+    FramePipeline pipeline;
+    std::mt19937 generator(37);
+
+    for(int i=MINID;i<MINID+2000;i++) {
+        pipeline.insert(Drone(i, static_cast<LIGHTCOLOR>(i % NUMCOLORS)));
+    }
+    pipeline.publish();
+    result = result && pipeline.acquire().diff(pipeline.current()).empty();
+    pipeline.publish(); // brings the third, still empty, buffer up to date as well
+    pipeline.acquire();
+    long long copies = pipeline.getFullCopies();
+
+    for(int frame=0;frame<30;frame++) {
+        for(int i=0;i<50;i++) {
+            int id = MINID + generator() % 3000;
+            switch (generator() % 4) {
+                case 0: pipeline.insert(Drone(id, RED)); break;
+                case 1: pipeline.remove(id); break;
+                case 2: pipeline.setState(id, static_cast<STATE>(generator() % NUMSTATES)); break;
+                default: pipeline.setColor(id, static_cast<LIGHTCOLOR>(generator() % NUMCOLORS)); break;
+            }
+        }
+        int lo = MINID + generator() % 3000;
+        pipeline.setStateRange(lo, lo + 100, LIGHTOFF);
+        pipeline.publish();
+        if (frame % 3 != 2) { // the renderer misses every third frame
+            result = result && pipeline.acquire().diff(pipeline.current()).empty();
+        }
+    }
+    // from then on the recycled buffers were rebuilt from the log, not copied
+    result = result && (pipeline.getFullCopies() == copies && pipeline.getReplayed() > 0);
+
+    // the reader stops taking frames while far more changes than drones go by
+    Show expected;
+    for(int frame=0;frame<10;frame++) {
+        for(int i=0;i<1000;i++) {
+            int id = MINID + generator() % 3000;
+            pipeline.setState(id, static_cast<STATE>(generator() % NUMSTATES));
+        }
+        pipeline.publish();
+    }
+    expected = pipeline.current();
+    result = result && pipeline.acquire().diff(expected).empty();
+    // the buffer the reader just gave back is next in line and is copied, not replayed
+    pipeline.setColorRange(MINID, MAXID, GREEN);
+    pipeline.publish();
+    result = result && (pipeline.getFullCopies() == copies + 1);
+    result = result && (pipeline.acquire().countDrones(GREEN) == expected.countDrones(LIGHTON) + expected.countDrones(LIGHTOFF));
+    result = result && (pipeline.getPublished() == 43);
+
+    return result;
+}
+//Function: Tester::testFramePublishTimeMeasurement
+//Case: 50000 drones, 60 frames with 500 single changes and one range change each, while a
+//renderer thread keeps acquiring frames and counting their lit drones
+//Expected result: should return true as a publish on average fits in a 60Hz frame (16.7ms)
+//and costs less than copying the whole show
+bool Tester::testFramePublishTimeMeasurement(){
+    bool result = true;
+    int frames = 60;
+    FramePipeline pipeline;
+    std::mt19937 generator(60);
+
+    for(int i=MINID;i<MINID+50000;i++) {
+        pipeline.insert(Drone(i, static_cast<LIGHTCOLOR>(i % NUMCOLORS)));
+    }
+    pipeline.publish();
+
+    atomic<bool> done(false);
+    long long rendered = 0;
+    thread renderer([&pipeline, &done, &rendered]() {
+        while (!done.load()) {
+            const Show & frame = pipeline.acquire();
+            rendered += frame.countDrones(LIGHTON) >= 0;
+            std::this_thread::yield();
+        }
+    });
+
+    double total = 0;
+    double worst = 0;
+    for(int frame=0;frame<frames;frame++) {
+        for(int i=0;i<500;i++) {
+            int id = MINID + generator() % 50000;
+            pipeline.setState(id, static_cast<STATE>(generator() % NUMSTATES));
+        }
+        int lo = MINID + generator() % 50000;
+        pipeline.setColorRange(lo, lo + 1000, BLUE);
+
+        chrono::steady_clock::time_point start = chrono::steady_clock::now();
+        pipeline.publish();
+        chrono::steady_clock::time_point stop = chrono::steady_clock::now();
+        double seconds = chrono::duration<double>(stop - start).count();
+        total += seconds;
+        worst = seconds > worst ? seconds : worst;
+    }
+    done.store(true);
+    renderer.join();
+
+    Show copy;
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    copy = pipeline.current();
+    chrono::steady_clock::time_point stop = chrono::steady_clock::now();
+    double copySeconds = chrono::duration<double>(stop - start).count();
+
+    double average = total / frames;
+    cout << "Publishing a frame of 50000 drones: " << average * 1000 << " ms average, " << worst * 1000
+         << " ms max, a full copy takes " << copySeconds * 1000 << " ms, " << rendered << " frames rendered" << endl;
+    result = result && (average < 1.0 / 60);
+    result = result && (average < copySeconds);
+    result = result && copy.diff(pipeline.current()).empty();
+
+    return result;
+}
+// a fresh directory per call, so two test runs side by side don't share journal files
+string journalPath(){
+    char directory[] = "/tmp/dronesXXXXXX";
+    if (mkdtemp(directory) == nullptr) {
+        return "testjournal";
+    }
+    return string(directory) + "/show";
+}
+void removeJournal(const string & path){
+    std::remove((path + ".journal").c_str());
+    std::remove((path + ".checkpoint").c_str());
+    std::remove((path + ".checkpoint.tmp").c_str());
+    size_t slash = path.rfind('/');
+    if (slash != string::npos) {
+        rmdir(path.substr(0, slash).c_str());
+    }
+}
+//Function: Tester::testJournalRecovery
+//Case: a journaled show gets random inserts, removes, state and color changes, and a few
+//removeLightOff calls, then "crashes" with part of a group still buffered and a torn record
+//at the end of the file; later a crash right between writing a checkpoint and the new journal;
+//then a checkpoint cut short by one record; last a group commit that hits the file size limit
+//halfway through a record and is retried after the limit is lifted
+//Expected result: should return true as the recovered show equals the show at the last commit
+//both times, and it is a balanced BST, and the cut checkpoint is refused, the show comes back
+//empty and nothing is written to either file after that, and the failed commit returns false
+//and leaves nothing behind, so the retried group is replayed in full
+bool Tester::testJournalRecovery(){
+    bool result = true;
+    string path = journalPath();
+    std::mt19937 generator(38);
+    Show committed;
+    {
+        JournaledShow journaled(path, false, 64);
+        for(int i=0;i<5000;i++) {
+            int id = MINID + generator() % 2000;
+            switch (generator() % 5) {
+                case 0: journaled.insert(Drone(id, static_cast<LIGHTCOLOR>(id % NUMCOLORS))); break;
+                case 1: journaled.remove(id); break;
+                case 2: journaled.setState(id, static_cast<STATE>(generator() % NUMSTATES)); break;
+                case 3: journaled.setColor(id, static_cast<LIGHTCOLOR>(generator() % NUMCOLORS)); break;
+                default: journaled.insert(Drone(id, BLUE, LIGHTOFF)); break;
+            }
+            if (i % 1000 == 999) {
+                journaled.removeLightOff();
+            }
+        }
+        journaled.commit();
+        committed = journaled.show();
+        journaled.insert(Drone(MAXID)); // still buffered when the controller dies
+        journaled.m_buffer.clear();
+    }
+    FILE *file = fopen((path + ".journal").c_str(), "ab"); // half of a record made it to disk
+    fwrite("torn", 1, 4, file);
+    fclose(file);
+
+    JournaledShow recovered(path, false, 64);
+    result = result && recovered.show().diff(committed).empty();
+    result = result && !recovered.show().findDrone(MAXID);
+    result = result && (recovered.getReplayed() > 0);
+    result = result && recovered.m_show.testBalance(recovered.m_show.m_root);
+    result = result && recovered.m_show.testBSTProperty(recovered.m_show.m_root);
+
+    // the journal survives the crash, the new checkpoint got renamed in already
+    recovered.setStateRange(MINID, MAXID, LIGHTON);
+    recovered.commit();
+    FILE *old = fopen((path + ".journal").c_str(), "rb");
+    vector<char> bytes;
+    int ch;
+    while ((ch = fgetc(old)) != EOF) {
+        bytes.push_back((char)ch);
+    }
+    fclose(old);
+    recovered.checkpoint();
+    committed = recovered.show();
+    file = fopen((path + ".journal").c_str(), "wb");
+    fwrite(bytes.data(), 1, bytes.size(), file);
+    fclose(file);
+    recovered.recover();
+    result = result && recovered.show().diff(committed).empty();
+    result = result && (recovered.getReplayed() == 0 && recovered.getCheckpoints() == 1);
+    result = result && recovered.recover() && recovered.isOpen();
+
+    // the checkpoint lost its last record, its header still counts it
+    recovered.insert(Drone(MAXID));
+    recovered.checkpoint();
+    FILE *cut = fopen((path + ".checkpoint").c_str(), "rb");
+    bytes.clear();
+    while ((ch = fgetc(cut)) != EOF) {
+        bytes.push_back((char)ch);
+    }
+    fclose(cut);
+    bytes.resize(bytes.size() - 16);
+    cut = fopen((path + ".checkpoint").c_str(), "wb");
+    fwrite(bytes.data(), 1, bytes.size(), cut);
+    fclose(cut);
+    result = result && !recovered.recover() && !recovered.isOpen();
+    result = result && recovered.show().diff(Show()).empty();
+    result = result && !recovered.commit() && !recovered.checkpoint();
+    JournaledShow reopened(path, false, 64);
+    result = result && !reopened.isOpen() && reopened.show().diff(Show()).empty();
+    cut = fopen((path + ".checkpoint").c_str(), "rb"); // nothing overwrote it
+    fseek(cut, 0, SEEK_END);
+    result = result && ftell(cut) == (long)bytes.size();
+    fclose(cut);
+
+    // a group that only partly fits on the disk, then the retry once there is room again
+    std::remove((path + ".journal").c_str());
+    std::remove((path + ".checkpoint").c_str());
+    {
+        JournaledShow full(path, true, 1000);
+        for(int id=MINID;id<MINID + 200;id++) {
+            full.insert(Drone(id));
+            if (id == MINID + 99) {
+                result = result && full.commit();
+            }
+        }
+        struct rlimit limit;
+        getrlimit(RLIMIT_FSIZE, &limit);
+        struct rlimit small = limit;
+        small.rlim_cur = (101 + 50) * 16 + 8; // the header, 100 records, then half a group and half a record
+        signal(SIGXFSZ, SIG_IGN);
+        setrlimit(RLIMIT_FSIZE, &small);
+        bool written = full.commit();
+        setrlimit(RLIMIT_FSIZE, &limit);
+        signal(SIGXFSZ, SIG_DFL);
+        result = result && !written && full.getCommits() == 1;
+        result = result && full.commit() && full.getCommits() == 2;
+    }
+    JournaledShow retried(path, false);
+    result = result && (retried.show().countDrones(LIGHTON) == 200 && retried.getReplayed() == 200);
+
+    removeJournal(path);
+    return result;
+}
+//Function: Tester::testJournalTimeMeasurement
+//Case: random inserts, removes, state and color changes go to a journaled show with synced
+//group commits of 256 records until it has logged 1000000 records, the same calls go to a
+//plain show, then the journaled show is recovered from its journal and again after a checkpoint
+//Expected result: should return true as both recoveries give back the same show and the whole
+//journal is replayed, the timings are printed
+bool Tester::testJournalTimeMeasurement(){
+    bool result = true;
+    string path = journalPath();
+    int operations = 1000000; // records to log, changes of missing drones aren't logged so it takes more calls
+    int calls = 0;
+    std::mt19937 generator(1000000);
+    vector<int> ids(2 * operations);
+    vector<int> kinds(2 * operations);
+    for(int i=0;i<2 * operations;i++) {
+        ids[i] = MINID + generator() % 50000;
+        kinds[i] = generator() % 20;
+    }
+
+    JournaledShow *journaled = new JournaledShow(path, true, JOURNAL_GROUP, 2 * operations);
+    chrono::steady_clock::time_point begin = chrono::steady_clock::now();
+    for(calls=0;journaled->getLogged()<operations;calls++) {
+        int i = calls;
+        int id = ids[i];
+        if (kinds[i] < 6) journaled->insert(Drone(id, static_cast<LIGHTCOLOR>(id % NUMCOLORS)));
+        else if (kinds[i] < 9) journaled->remove(id);
+        else if (kinds[i] < 17) journaled->setState(id, static_cast<STATE>(kinds[i] % NUMSTATES));
+        else journaled->setColor(id, static_cast<LIGHTCOLOR>(kinds[i] % NUMCOLORS));
+    }
+    journaled->commit();
+    chrono::steady_clock::time_point end = chrono::steady_clock::now();
+    double journaledSeconds = chrono::duration<double>(end - begin).count();
+    long long logged = journaled->getLogged();
+    long long commits = journaled->getCommits();
+    delete journaled;
+
+    Show plain;
+    begin = chrono::steady_clock::now();
+    for(int i=0;i<calls;i++) {
+        int id = ids[i];
+        if (kinds[i] < 6) plain.insert(Drone(id, static_cast<LIGHTCOLOR>(id % NUMCOLORS)));
+        else if (kinds[i] < 9) plain.remove(id);
+        else if (kinds[i] < 17) plain.setState(id, static_cast<STATE>(kinds[i] % NUMSTATES));
+        else plain.setColor(id, static_cast<LIGHTCOLOR>(kinds[i] % NUMCOLORS));
+    }
+    end = chrono::steady_clock::now();
+    double plainSeconds = chrono::duration<double>(end - begin).count();
+
+    begin = chrono::steady_clock::now();
+    JournaledShow recovered(path, true, JOURNAL_GROUP, 2 * operations);
+    end = chrono::steady_clock::now();
+    double replaySeconds = chrono::duration<double>(end - begin).count();
+    result = result && recovered.show().diff(plain).empty();
+    result = result && (recovered.getReplayed() == logged);
+
+    result = result && recovered.checkpoint(); // synced, the file and then its directory
+    begin = chrono::steady_clock::now();
+    recovered.recover();
+    end = chrono::steady_clock::now();
+    double checkpointSeconds = chrono::duration<double>(end - begin).count();
+    result = result && recovered.show().diff(plain).empty();
+    result = result && (recovered.getReplayed() == 0);
+
+    cout << calls << " mutations: " << plainSeconds << " seconds plain, " << journaledSeconds << " seconds journaled ("
+         << logged << " records, " << commits << " group commits), "
+         << (journaledSeconds - plainSeconds) / calls * 1e9 << " ns journal cost per mutation" << endl;
+    cout << "Recovery: " << replaySeconds * 1000 << " ms replaying " << logged << " records, "
+         << checkpointSeconds * 1000 << " ms from a checkpoint of " << plain.countDrones(LIGHTON) + plain.countDrones(LIGHTOFF)
+         << " drones" << endl;
+
+    removeJournal(path);
+    return result;
+}
+//Function: Tester::testSharedShow
+//Case: the owner fills a shared show with the same 3000 random drones as a normal show, then a
+//child process attaches read-only and keeps listing it while the owner slides a window of 500
+//IDs along, inserting one ID and removing the one 500 below it 20000 times, last the show
+//is opened again by a new owner
+//Expected result: should return true as the shared show answers like the normal one, every
+//listing the child gets is a full window of 500 or 501 consecutive IDs, never a torn one,
+//and the child ends with the same drones as the owner and can't change them, and a reader
+//attached before a new owner opens the same name still reads the old drones
+bool Tester::testSharedShow(){
+    bool result = true;
+    std::mt19937 generator(39);
+    string name = "drones_test_" + to_string(getpid()); // runs side by side get their own object
+    SharedShow shared(name);
+    Show expected;
+    result = result && shared.isOpen();
+    for(int i=0;i<3000;i++) {
+        Drone drone(MINID + generator() % 5000, static_cast<LIGHTCOLOR>(generator() % NUMCOLORS),
+                    static_cast<STATE>(generator() % NUMSTATES));
+        shared.insert(drone);
+        expected.insert(drone);
+    }
+    for(int i=0;i<500;i++) {
+        int id = MINID + generator() % 5000;
+        shared.remove(id);
+        expected.remove(id);
+    }
+    shared.removeLightOff();
+    expected.removeLightOff();
+    Show empty;
+    vector<DroneChange> listing = shared.getDrones();
+    vector<DroneChange> wanted = expected.diff(empty).added;
+    result = result && (listing.size() == wanted.size());
+    for(int i=0;i<(int)listing.size() && i<(int)wanted.size();i++) {
+        result = result && (listing[i].id == wanted[i].id && listing[i].type == wanted[i].type
+                            && listing[i].state == wanted[i].state);
+    }
+    result = result && (shared.countDrones(RED) == expected.countDrones(RED));
+    result = result && (shared.countDrones(LIGHTOFF) == 0);
+
+    int first = MINID + 20000;
+    int steps = 20000;
+    shared.clear();
+    for(int id=first;id<first+500;id++) {
+        shared.insert(Drone(id));
+    }
+    unsigned long long last = shared.version() + 2 * steps; // every step is an insert and a remove
+    pid_t child = fork();
+    if (child == 0) { // the reader process
+        SharedShow reader(name, false);
+        bool ok = reader.isOpen() && !reader.isOwner();
+        long long listings = 0;
+        while (ok && reader.version() < last) {
+            vector<DroneChange> window = reader.getDrones();
+            ok = ok && (window.size() == 500 || window.size() == 501);
+            for(int i=1;i<(int)window.size();i++) {
+                ok = ok && (window[i].id == window[i - 1].id + 1);
+            }
+            listings++;
+        }
+        reader.insert(Drone(MINID)); // attached read-only, ignored
+        reader.remove(first + steps);
+        ok = ok && reader.findDrone(first + steps) && !reader.findDrone(MINID);
+        ok = ok && (reader.countDrones(LIGHTON) == 500);
+        cout << "Reader process: " << listings << " consistent listings, " << reader.getRetries() << " retried reads" << endl;
+        _exit(ok ? 0 : 1);
+    }
+    for(int step=0;step<steps;step++) {
+        shared.insert(Drone(first + 500 + step));
+        shared.remove(first + step);
+        if (step % 100 == 0) {
+            std::this_thread::yield(); // give the reader a chance on one core
+        }
+    }
+    int status = 1;
+    waitpid(child, &status, 0);
+    result = result && (child > 0 && WIFEXITED(status) && WEXITSTATUS(status) == 0);
+    result = result && (shared.countDrones(LIGHTON) == 500 && shared.findDrone(first + steps));
+
+    SharedShow attached(name, false);
+    {
+        SharedShow reopened(name); // a new owner under the same name
+        result = result && reopened.isOpen() && reopened.countDrones(LIGHTON) == 0;
+        result = result && (attached.countDrones(LIGHTON) == 500 && attached.findDrone(first + steps));
+    }
+    return result;
+}
+//Function: Tester::testBasicShow
+//Case: Show is built on BasicTree over its own types, a plain BasicShow with long long IDs and Show's bounds and payload
+//gets the same random inserts, removes and removeLightOff as a Show, then a BasicShow over all
+//unsigned 32 bit IDs with a one byte payload gets 300000 drones
+//Expected result: should return true as the plain one keeps Show's drones, range check and
+//balance, and the wide one holds more than 90000 drones in order without a range check
+bool Tester::testBasicShow(){
+    bool result = true;
+    std::mt19937 generator(40);
+    typedef BasicShow<long long, MINID, MAXID, DronePayload> PlainShow;
+    static_assert(std::is_base_of<BasicTree<int, MINID, MAXID, DronePayload, Drone, Show>, Show>::value
+                  && std::is_base_of<BasicNode<int, DronePayload, Drone>, Drone>::value, "Show is the core over its own types");
+    PlainShow basic;
+    Show show;
+    result = result && !basic.insert(MINID - 1, DronePayload{RED, LIGHTON}) && !basic.insert(MAXID + 1, DronePayload{RED, LIGHTON});
+    for(int i=0;i<20000;i++) {
+        int id = MINID + generator() % 10000;
+        if (generator() % 3 != 0) {
+            DronePayload payload = {static_cast<LIGHTCOLOR>(generator() % NUMCOLORS), static_cast<STATE>(generator() % NUMSTATES)};
+            basic.insert(id, payload);
+            show.insert(Drone(id, payload.type, payload.state));
+        }
+        else {
+            basic.remove(id);
+            show.remove(id);
+        }
+    }
+    basic.removeIf([](int, const DronePayload & payload) {return payload.state == LIGHTOFF;});
+    show.removeLightOff();
+
+    Show empty;
+    vector<DroneChange> wanted = show.diff(empty).added;
+    int next = 0;
+    bool same = (basic.size() == (long long)wanted.size());
+    basic.forEach([&wanted, &next, &same](int id, const DronePayload & payload) {
+        same = same && next < (int)wanted.size() && wanted[next].id == id
+               && wanted[next].type == payload.type && wanted[next].state == payload.state;
+        next++;
+    });
+    result = result && same;
+    result = result && basic.testBalance(basic.m_root);
+
+    typedef BasicShow<unsigned, 0, 0xFFFFFFFFu, unsigned char> WideShow;
+    static_assert(Show::CHECKS_RANGE && PlainShow::CHECKS_RANGE && !WideShow::CHECKS_RANGE, "only the full range drops the check");
+    WideShow wide;
+    for(unsigned i=0;i<300000;i++) {
+        wide.insert(i * 14321u + 3000000000u, (unsigned char)(i % 256)); // wraps past 2^32
+    }
+    result = result && (wide.size() == 300000 && wide.height() <= 1.45 * 19);
+    result = result && wide.find(3000000000u) != nullptr && *wide.find(3000000000u + 14321u * 7) == 7;
+    unsigned previous = 0;
+    bool ordered = true;
+    bool firstOne = true;
+    wide.forEach([&previous, &ordered, &firstOne](unsigned id, unsigned char) {
+        ordered = ordered && (firstOne || previous < id);
+        previous = id;
+        firstOne = false;
+    });
+    result = result && ordered;
+    WideShow copy(wide);
+    copy.remove(3000000000u);
+    result = result && wide.findDrone(3000000000u) && !copy.findDrone(3000000000u) && copy.size() == 299999;
+
+    return result;
+}
+//Function: Tester::testFingerInsert
+//Case: ascending runs, runs with small jumps back and forth, and random IDs are inserted,
+//mixed with duplicates, state changes, range updates and removes that make the finger stale
+//Expected result: should return true as the show holds exactly the IDs of a BasicShow fed the
+//same calls, every stored height is the real height, and it stays a balanced BST
+bool Tester::testFingerInsert(){
+    bool result = true;
+    std::mt19937 generator(41);
+    Show show;
+    BasicShow<long long, MINID, MAXID, DronePayload> expected; // the plain tree, without Show's finger
+    int next = MINID;
+    for(int round=0;round<40;round++) {
+        for(int i=0;i<500;i++) {
+            int id;
+            switch (round % 3) {
+                case 0: id = next++; break; // ascending
+                case 1: id = next - 20 + (int)(generator() % 40); next++; break; // near-sequential
+                default: id = MINID + generator() % (MAXID - MINID); break; // random
+            }
+            LIGHTCOLOR color = static_cast<LIGHTCOLOR>(generator() % NUMCOLORS);
+            show.insert(Drone(id, color));
+            expected.insert(id, DronePayload{color, LIGHTON});
+            if (i % 50 == 0) {
+                show.setState(id, LIGHTOFF);
+                expected.find(id)->state = LIGHTOFF;
+            }
+        }
+        if (round % 4 == 3) {
+            int lo = MINID + generator() % (MAXID - MINID);
+            show.setStateRange(lo, lo + 2000, LIGHTON);
+            for(int id=lo;id<=lo + 2000;id++) {
+                if (expected.find(id) != nullptr) {
+                    expected.find(id)->state = LIGHTON;
+                }
+            }
+            int gone = MINID + generator() % (MAXID - MINID);
+            show.remove(gone);
+            expected.remove(gone);
+        }
+    }
+
+    Show empty;
+    vector<DroneChange> drones = show.diff(empty).added;
+    int i = 0;
+    bool same = (expected.size() == (long long)drones.size());
+    expected.forEach([&drones, &i, &same](int id, const DronePayload & payload) {
+        same = same && i < (int)drones.size() && drones[i].id == id && drones[i].state == payload.state;
+        i++;
+    });
+    result = result && same;
+    result = result && (show.countDrones(LIGHTON) + show.countDrones(LIGHTOFF) == (int)drones.size());
+
+    auto heightsRight = [](auto & self, Drone *curr) -> int { // real height, -2 once a stored one is wrong
+        if (curr == nullptr) {
+            return -1;
+        }
+        int left = self(self, curr->m_left);
+        int right = self(self, curr->m_right);
+        int height = (left > right ? left : right) + 1;
+        return (left == -2 || right == -2 || height != curr->m_height) ? -2 : height;
+    };
+    result = result && (heightsRight(heightsRight, show.m_root) != -2);
+    result = result && show.testBalance(show.m_root);
+    result = result && show.testBSTProperty(show.m_root);
+
+    return result;
+}
+//Function: Tester::testFingerInsertTimeMeasurement
+//Case: 80000 drones are inserted into an empty show as an ascending stream, a near-sequential
+//stream (ascending, shuffled inside blocks of 16) and a random stream, once with the finger and
+//once with it switched off so every insert starts at the root, the best of 3 runs counts
+//Expected result: should return true as both ways build the same balanced tree and the finger
+//makes the ascending and near-sequential streams cheaper per insert (the random stream is only
+//printed, the finger has nothing to reuse there and recording the path costs a little)
+bool Tester::testFingerInsertTimeMeasurement(){
+    bool result = true;
+    int count = 80000;
+    std::mt19937 generator(4100);
+    vector<vector<int> > streams(3);
+    for(int i=0;i<count;i++) {
+        streams[0].push_back(MINID + i);
+        streams[1].push_back(MINID + i);
+        streams[2].push_back(MINID + i);
+    }
+    for(int i=0;i+16<count;i+=16) { // shuffle inside blocks of 16
+        std::shuffle(streams[1].begin() + i, streams[1].begin() + i + 16, generator);
+    }
+    std::shuffle(streams[2].begin(), streams[2].end(), generator);
+    const char *names[3] = {"ascending", "near-sequential", "random"};
+
+    for(int s=0;s<3;s++) {
+        double best[2] = {1e9, 1e9}; // with the finger, from the root
+        for(int run=0;run<6;run++) {
+            Show show;
+            show.m_fingerOn = (run % 2 == 0);
+            chrono::steady_clock::time_point start = chrono::steady_clock::now();
+            for(int i=0;i<count;i++) {
+                show.emplace(streams[s][i]);
+            }
+            chrono::steady_clock::time_point stop = chrono::steady_clock::now();
+            best[run % 2] = min(best[run % 2], chrono::duration<double>(stop - start).count());
+            result = result && (show.countDrones(LIGHTON) == count) && show.testBalance(show.m_root)
+                     && show.testBSTProperty(show.m_root);
+        }
+        cout << names[s] << " inserts: " << best[0] / count * 1e9 << " ns with the finger, "
+             << best[1] / count * 1e9 << " ns from the root" << endl;
+        if (s < 2) {
+            result = result && (best[0] < best[1]);
+        }
+    }
+
+    return result;
+}
+//Function: Tester::testDeferredRemove
+//Case: a show that defers removes (compacting at 30% dead) and a normal show get the same random
+//inserts, removes, inserts of removed IDs, state and range changes, moves and removeLightOff
+//Expected result: should return true as both always hold the same drones with the same lights
+//and positions, dead drones are hidden from every query, and compaction leaves a balanced tree
+bool Tester::testDeferredRemove(){
+    bool result = true;
+    std::mt19937 generator(42);
+    Show deferred;
+    Show normal;
+    deferred.setDeferredRemove(0.3);
+    bool sawDead = false;
+    for(int round=0;round<20;round++) {
+        for(int i=0;i<1000;i++) {
+            int id = MINID + generator() % 3000;
+            int roll = generator() % 10;
+            if (roll < 4) {
+                Drone drone(id, static_cast<LIGHTCOLOR>(generator() % NUMCOLORS), static_cast<STATE>(generator() % NUMSTATES));
+                drone.setPosition(id % 100, id % 7, 0);
+                deferred.insert(drone);
+                normal.insert(drone);
+            }
+            else if (roll < 8) {
+                deferred.remove(id);
+                normal.remove(id);
+            }
+            else if (roll < 9) {
+                result = result && (deferred.setColor(id, BLUE) == normal.setColor(id, BLUE));
+            }
+            else {
+                result = result && (deferred.moveDrone(id, 5, 5, 5) == normal.moveDrone(id, 5, 5, 5));
+            }
+        }
+        sawDead = sawDead || deferred.countDead() > 0;
+        result = result && (deferred.countDead() <= 0.3 * deferred.m_store.size());
+        int lo = MINID + generator() % 3000;
+        deferred.setStateRange(lo, lo + 300, LIGHTOFF);
+        normal.setStateRange(lo, lo + 300, LIGHTOFF);
+        if (round % 5 == 4) {
+            deferred.removeLightOff();
+            normal.removeLightOff();
+        }
+
+        result = result && deferred.diff(normal).empty() && normal.diff(deferred).empty();
+        result = result && (deferred.countDrones(LIGHTOFF) == normal.countDrones(LIGHTOFF));
+        result = result && (deferred.getDrones(RED) == normal.getDrones(RED));
+        result = result && (deferred.findNear(5, 5, 5, 1) == normal.findNear(5, 5, 5, 1));
+        result = result && (deferred.helpCount(deferred.m_root, GREEN) == normal.countDrones(GREEN));
+        for(int id=MINID;id<MINID + 3000;id+=7) {
+            result = result && (deferred.findDrone(id) == normal.findDrone(id));
+        }
+    }
+    result = result && sawDead;
+
+    Show copy(deferred); // dead nodes come along but stay hidden
+    result = result && copy.diff(normal).empty() && (copy.countDead() == deferred.countDead());
+    deferred.compact();
+    result = result && (deferred.countDead() == 0) && deferred.diff(normal).empty();
+    result = result && (deferred.countNodes(deferred.m_root) == normal.countNodes(normal.m_root));
+    result = result && deferred.testBalance(deferred.m_root) && deferred.testBSTProperty(deferred.m_root);
+    result = result && (deferred.m_store.size() == normal.m_store.size());
+
+    return result;
+}
+//Function: Tester::testDeferredRemoveTimeMeasurement
+//Case: the removeNormalCase workload (insert ascending IDs, remove all of them in order) and the
+//removeBalanced workload (remove the first half) with 10000 and with 80000 drones, once with
+//removes right away and once deferred with compaction at half the tree dead
+//Expected result: should return true as both modes end with the same drones, and deferring is
+//faster on the big workloads
+bool Tester::testDeferredRemoveTimeMeasurement(){
+    bool result = true;
+    int sizes[2] = {10000, 80000};
+    const char *names[2] = {"removeNormalCase", "removeBalanced"};
+    for(int s=0;s<2;s++) {
+        for(int w=0;w<2;w++) {
+            int size = sizes[s];
+            int removed = (w == 0) ? size : size / 2;
+            double seconds[2];
+            int left[2];
+            for(int mode=0;mode<2;mode++) {
+                Show show;
+                if (mode == 1) {
+                    show.setDeferredRemove(0.5);
+                }
+                for(int i=0;i<size;i++) {
+                    show.emplace(MINID + i);
+                }
+                chrono::steady_clock::time_point start = chrono::steady_clock::now();
+                for(int i=0;i<removed;i++) {
+                    show.remove(MINID + i);
+                }
+                chrono::steady_clock::time_point stop = chrono::steady_clock::now();
+                seconds[mode] = chrono::duration<double>(stop - start).count();
+                left[mode] = show.countDrones(LIGHTON);
+                result = result && !show.findDrone(MINID) && show.testBalance(show.m_root);
+            }
+            cout << names[w] << " with " << size << " drones: " << seconds[0] * 1000 << " ms removing right away, "
+                 << seconds[1] * 1000 << " ms deferred" << endl;
+            result = result && (left[0] == size - removed && left[1] == size - removed);
+            if (s == 1) {
+                result = result && (seconds[1] < seconds[0]);
+            }
+        }
+    }
+    return result;
+}
+//Function: Tester::testHotCache
+//Case: a few lead drones are looked up and changed over and over while they are removed and
+//inserted again, the show is cleared, assigned, moved, range updated and compacted
+//Expected result: should return true as every lookup and state change through the cache gives
+//the same answer as the tree, and the cache reports hits, also while range values are pending
+bool Tester::testHotCache(){
+    bool result = true;
+    Show show;
+    for(int i=MINID;i<MINID + 5000;i++) {
+        show.emplace(i);
+    }
+    result = result && (show.m_hot == nullptr); // inserts don't fill it, the first lookup allocates it
+    int leads[4] = {MINID + 7, MINID + 7 + HOT_SIZE, MINID + 1000, MINID + 4999}; // the first two share an entry
+    for(int round=0;round<3;round++) {
+        for(int i=0;i<4;i++) {
+            result = result && show.findDrone(leads[i]) && show.setState(leads[i], LIGHTOFF);
+        }
+    }
+    result = result && (show.getCacheHits() > 0);
+    long long before = show.getCacheHits();
+    result = result && !show.findDrone(DEFAULT_ID) && !show.setState(DEFAULT_ID, LIGHTOFF) && !show.findDrone(MAXID + 1);
+    result = result && (show.getCacheHits() == before); // never answered by an empty entry
+
+    show.remove(leads[0]); // its node is deleted, the entry must not answer for it
+    result = result && !show.findDrone(leads[0]) && !show.setState(leads[0], LIGHTON);
+    show.emplace(leads[0], GREEN);
+    result = result && show.findDrone(leads[0]) && show.setState(leads[0], LIGHTOFF);
+    result = result && (show.findHelper(leads[0], show.m_root)->m_slot != NO_SLOT);
+
+    show.setStateRange(MINID, MAXID, LIGHTON); // a cached node now has a pending value above it
+    result = result && show.setState(leads[2], LIGHTOFF);
+    long long hits = show.getCacheHits();
+    result = result && show.setState(leads[2], LIGHTON) && show.setState(leads[2], LIGHTOFF);
+    result = result && (show.getCacheHits() == hits + 2); // its path was pushed, the values are still pending elsewhere
+    show.setColorRange(MINID, MAXID, BLUE); // and pending above it again
+    result = result && show.setColor(leads[2], RED);
+    show.flushTags();
+    result = result && (show.stateOf(show.findHelper(leads[2], show.m_root)) == LIGHTOFF);
+    result = result && (show.typeOf(show.findHelper(leads[2], show.m_root)) == RED);
+    result = result && (show.countDrones(LIGHTOFF) == 1 && show.countDrones(RED) == 1);
+
+    show.setDeferredRemove(0.1);
+    for(int i=MINID;i<MINID + 1000;i++) {
+        show.findDrone(i);
+        show.remove(i); // compacts along the way, deleting cached nodes
+    }
+    result = result && !show.findDrone(leads[0]) && show.findDrone(leads[2]) && !show.setColor(MINID + 500, RED);
+
+    Show other;
+    other.emplace(leads[3]);
+    result = result && other.findDrone(leads[3]);
+    other = show; // other's entry pointed at its own node
+    result = result && other.findDrone(leads[3]) && other.setState(leads[3], LIGHTOFF) && show.findDrone(leads[3]);
+    result = result && (other.countDrones(LIGHTOFF) == show.countDrones(LIGHTOFF) + 1);
+    Show moved(std::move(other)); // the entries move along with the nodes
+    result = result && (moved.getCacheHits() == 0 && moved.getCacheMisses() == 0);
+    hits = moved.getCacheHits();
+    result = result && !other.findDrone(leads[3]) && moved.findDrone(leads[3]) && moved.getCacheHits() == hits + 1;
+    moved.swap(other);
+    result = result && other.findDrone(leads[3]) && !moved.findDrone(leads[3]) && moved.m_hot == nullptr;
+    show.clear();
+    result = result && !show.findDrone(leads[2]) && !show.setState(leads[2], LIGHTON);
+
+    return result;
+}
+//Function: Tester::testHotCacheTimeMeasurement
+//Case: 2000000 findDrone and setState calls on a show of 80000 drones, the IDs are drawn from
+//a Zipf distribution (exponent 1.2) over the drones in a random order, once through the cached
+//calls and once through findHelper and accessHelper from the root
+//Expected result: should return true as both give the same answers, most calls hit the cache,
+//and the cached lookups are faster
+bool Tester::testHotCacheTimeMeasurement(){
+    bool result = true;
+    int size = 80000;
+    int calls = 2000000;
+    std::mt19937 generator(43);
+    vector<int> ids(size);
+    for(int i=0;i<size;i++) {
+        ids[i] = MINID + i;
+    }
+    std::shuffle(ids.begin(), ids.end(), generator); // rank 1 is some random drone
+    vector<double> weights(size);
+    for(int i=0;i<size;i++) {
+        weights[i] = 1.0 / pow(i + 1, 1.2);
+    }
+    std::discrete_distribution<int> zipf(weights.begin(), weights.end());
+    vector<int> queries(calls);
+    for(int i=0;i<calls;i++) {
+        queries[i] = ids[zipf(generator)];
+    }
+
+    Show show;
+    for(int i=0;i<size;i++) {
+        show.emplace(ids[i]);
+    }
+
+    long long found = 0;
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    for(int i=0;i<calls;i++) {
+        found += show.findDrone(queries[i]);
+    }
+    chrono::steady_clock::time_point stop = chrono::steady_clock::now();
+    double cachedFind = chrono::duration<double>(stop - start).count();
+    long long uncached = 0;
+    start = chrono::steady_clock::now();
+    for(int i=0;i<calls;i++) {
+        uncached += show.findHelper(queries[i], show.m_root) != nullptr;
+    }
+    stop = chrono::steady_clock::now();
+    double rootFind = chrono::duration<double>(stop - start).count();
+    double hitRate = double(show.getCacheHits()) / (show.getCacheHits() + show.getCacheMisses());
+
+    start = chrono::steady_clock::now();
+    for(int i=0;i<calls;i++) {
+        show.setState(queries[i], static_cast<STATE>(i % NUMSTATES));
+    }
+    stop = chrono::steady_clock::now();
+    double cachedSet = chrono::duration<double>(stop - start).count();
+    start = chrono::steady_clock::now();
+    for(int i=0;i<calls;i++) { // what setState did before the cache and the finger
+        Drone *target = show.accessHelper(queries[i], show.m_root);
+        show.indexRemove(queries[i], show.typeOf(target), show.stateOf(target));
+        show.m_store.setState(target->m_slot, i % NUMSTATES);
+        show.indexAdd(queries[i], show.typeOf(target), static_cast<STATE>(i % NUMSTATES));
+    }
+    stop = chrono::steady_clock::now();
+    double rootSet = chrono::duration<double>(stop - start).count();
+
+    cout << "Zipf findDrone: " << cachedFind / calls * 1e9 << " ns cached, " << rootFind / calls * 1e9
+         << " ns from the root, hit rate " << hitRate * 100 << "%" << endl;
+    cout << "Zipf setState: " << cachedSet / calls * 1e9 << " ns cached, " << rootSet / calls * 1e9 << " ns from the root" << endl;
+    result = result && (found == calls && uncached == calls);
+    result = result && (hitRate > 0.5);
+    result = result && (cachedFind < rootFind);
+    result = result && (show.countDrones(LIGHTON) + show.countDrones(LIGHTOFF) == size);
+
+    return result;
+}
+// a ring of drones in scrambled ID order with the colors and states taking turns, the
+// compiler builds it and the Formation made from it
+template <int N>
+constexpr array<DroneChange, N> ringFormation(){
+    array<DroneChange, N> drones{};
+    for(int i=0;i<N;i++) {
+        drones[i].id = MINID + (int)((i * 7919LL) % N) * ((MAXID - MINID) / N);
+        drones[i].type = static_cast<LIGHTCOLOR>(i % NUMCOLORS);
+        drones[i].state = static_cast<STATE>(i % NUMSTATES);
+    }
+    return drones;
+}
+//Function: Tester::testFormation
+//Case: a small formation with a duplicate and an ID out of range, and a ring of 1000 drones,
+//both built at compile time, are searched, counted and turned into shows
+//Expected result: should return true as the compiler already knows the answers, the formation
+//agrees with a show built by inserts, and toShow() gives a tree as low as it can be
+bool Tester::testFormation(){
+    bool result = true;
+    static constexpr DroneChange opening[] = {{10005, RED, LIGHTON}, {10001, GREEN, LIGHTOFF},
+                                             {10003, BLUE, LIGHTON}, {10001, RED, LIGHTON},
+                                             {MAXID + 1, RED, LIGHTON}};
+    static constexpr Formation small(opening);
+    static_assert(small.size() == 3, "the duplicate and the ID out of range are dropped");
+    static_assert(small.findDrone(10001) && small.findDrone(10003) && small.findDrone(10005), "");
+    static_assert(!small.findDrone(10002) && !small.findDrone(MINID) && !small.findDrone(MAXID + 1), "");
+    static_assert(small[0].id == 10001 && small[0].type == GREEN, "the first of the duplicates wins");
+    static_assert(small.countDrones(RED) == 1 && small.countDrones(LIGHTON) == 2, "");
+    Show smallShow = small.toShow();
+    result = result && (smallShow.findDrone(10001) && smallShow.findDrone(10003) && smallShow.findDrone(10005));
+    result = result && (smallShow.countDrones(GREEN) == 1 && smallShow.countDrones(LIGHTOFF) == 1);
+
+    static constexpr Formation ring(ringFormation<1000>());
+    static_assert(ring.size() == 1000, "");
+    Show inserted;
+    array<DroneChange, 1000> drones = ringFormation<1000>();
+    for(int i=0;i<1000;i++) {
+        inserted.insert(Drone(drones[i].id, drones[i].type, drones[i].state));
+    }
+    Show loaded = ring.toShow();
+    result = result && (loaded.diff(inserted).size() == 0 && inserted.diff(loaded).size() == 0);
+    result = result && loaded.testBalance(loaded.m_root);
+    result = result && (loaded.m_root->m_height == 9); // 1000 drones fit in 10 levels
+    for(int id=MINID;id<=MAXID;id+=7) {
+        result = result && (ring.findDrone(id) == inserted.findDrone(id));
+    }
+    for(int i=0;i<NUMCOLORS;i++) {
+        result = result && (ring.countDrones(static_cast<LIGHTCOLOR>(i)) == inserted.countDrones(static_cast<LIGHTCOLOR>(i)));
+    }
+    for(int i=0;i<NUMSTATES;i++) {
+        result = result && (ring.countDrones(static_cast<STATE>(i)) == inserted.countDrones(static_cast<STATE>(i)));
+    }
+    loaded.insert(Drone(MINID + 1)); // the show is an ordinary one from here on
+    loaded.remove(drones[1].id);
+    result = result && (loaded.findDrone(MINID + 1) && !loaded.findDrone(drones[1].id));
+    result = result && loaded.testBalance(loaded.m_root);
+
+    return result;
+}
+//Function: Tester::testFormationTimeMeasurement
+//Case: a formation of 8000 drones is loaded at startup 100 times through the runtime insert
+//loop and 100 times from the compile-time table
+//Expected result: should return true as the table loads faster and both give the same show
+bool Tester::testFormationTimeMeasurement(){
+    bool result = true;
+    const int size = 8000;
+    const int rounds = 100;
+    static constexpr array<DroneChange, size> drones = ringFormation<size>();
+    static constexpr Formation<size> table(drones);
+
+    long long sizes = 0;
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    for(int r=0;r<rounds;r++) {
+        Show show;
+        for(int i=0;i<size;i++) {
+            show.insert(Drone(drones[i].id, drones[i].type, drones[i].state));
+        }
+        sizes += show.countDrones(LIGHTON) + show.countDrones(LIGHTOFF);
+    }
+    chrono::steady_clock::time_point stop = chrono::steady_clock::now();
+    double insertLoop = chrono::duration<double>(stop - start).count();
+    start = chrono::steady_clock::now();
+    for(int r=0;r<rounds;r++) {
+        Show show = table.toShow();
+        sizes += show.countDrones(LIGHTON) + show.countDrones(LIGHTOFF);
+    }
+    stop = chrono::steady_clock::now();
+    double fromTable = chrono::duration<double>(stop - start).count();
+
+    long long found = 0;
+    for(int i=0;i<size;i++) {
+        found += table.findDrone(drones[i].id);
+    }
+    cout << "Formation startup of " << size << " drones: " << insertLoop / rounds * 1e3 << " ms through insert, "
+         << fromTable / rounds * 1e3 << " ms from the table" << endl;
+    result = result && (sizes == 2LL * rounds * size && found == size);
+    result = result && (fromTable < insertLoop);
+
+    return result;
+}
+//Function: Tester::testHistory
+//Case: 200 time steps of random inserts, removes, state and color changes, range updates,
+//removeLightOff and one clear, once with deep rings and once with rings of 4 transitions
+//Expected result: should return true as the reconstructed fleet, the single drone lookups and
+//the counts match a copy of the show saved at every step, from horizon() on for the short rings
+bool Tester::testHistory(){
+    bool result = true;
+    const int steps = 200;
+    const int depths[] = {steps * 20, 4};
+    for(int d=0;d<2;d++) {
+        HistoryShow history(depths[d]);
+        std::mt19937 generator(45 + d);
+        std::uniform_int_distribution<int> ids(MINID, MINID + 300);
+        std::uniform_int_distribution<int> ops(0, 99);
+        vector<vector<DroneChange> > saved;
+        Show empty;
+        result = result && !history.findDrone(MINID, 0) && history.showAt(0).empty();
+        for(int t=1;t<=steps;t++) {
+            history.setTime(t * 10); // time steps don't need to be next to each other
+            for(int i=0;i<20;i++) {
+                int op = ops(generator);
+                int id = ids(generator);
+                if (op < 35) {
+                    history.insert(Drone(id, static_cast<LIGHTCOLOR>(op % NUMCOLORS), static_cast<STATE>(op % NUMSTATES)));
+                }
+                else if (op < 50) {
+                    history.remove(id);
+                }
+                else if (op < 75) {
+                    history.setState(id, static_cast<STATE>(op % NUMSTATES));
+                }
+                else if (op < 97) {
+                    history.setColor(id, static_cast<LIGHTCOLOR>(op % NUMCOLORS));
+                }
+                else if (op < 98) {
+                    history.setStateRange(id, id + 40, LIGHTOFF);
+                }
+                else if (op < 99) {
+                    history.setColorRange(id - 40, id, BLUE);
+                }
+                else {
+                    history.removeLightOff();
+                }
+            }
+            if (t == steps / 2) {
+                history.clear();
+                history.insert(Drone(MINID + 7, GREEN, LIGHTOFF));
+            }
+            saved.push_back(history.show().diff(empty).added);
+        }
+        result = result && !history.setTime(0);
+        result = result && (saved[steps / 2 - 1].size() == 1 && saved[steps / 2 - 1][0].id == MINID + 7);
+        result = result && (d == 1 || history.horizon() == 0);
+        result = result && (d == 0 || history.horizon() > 10);
+        for(int t=1;t<=steps;t++) {
+            int time = t * 10 + (t % 3) * 4; // somewhere between two steps, the earlier one holds
+            if (time < history.horizon()) {
+                continue;
+            }
+            const vector<DroneChange> & expected = saved[t - 1];
+            vector<DroneChange> rebuilt = history.showAt(time);
+            result = result && (rebuilt.size() == expected.size());
+            for(int i=0;i<(int)rebuilt.size() && i<(int)expected.size();i++) {
+                result = result && (rebuilt[i].id == expected[i].id && rebuilt[i].type == expected[i].type
+                                    && rebuilt[i].state == expected[i].state);
+                LIGHTCOLOR color = RED;
+                STATE state = LIGHTON;
+                result = result && history.stateAt(expected[i].id, time, color, state);
+                result = result && (color == expected[i].type && state == expected[i].state);
+            }
+            int colors[NUMCOLORS] = {0};
+            int states[NUMSTATES] = {0};
+            for(int i=0;i<(int)expected.size();i++) {
+                colors[expected[i].type]++;
+                states[expected[i].state]++;
+            }
+            for(int i=0;i<NUMCOLORS;i++) {
+                result = result && (history.countDrones(static_cast<LIGHTCOLOR>(i), time) == colors[i]);
+            }
+            for(int i=0;i<NUMSTATES;i++) {
+                result = result && (history.countDrones(static_cast<STATE>(i), time) == states[i]);
+            }
+            LIGHTCOLOR color = RED;
+            STATE state = LIGHTON;
+            result = result && (history.findDrone(MINID + 7, time) == history.stateAt(MINID + 7, time, color, state));
+        }
+    }
+
+    return result;
+}
+//Function: Tester::testHistoryTimeMeasurement
+//Case: 10000 drones take 2000000 setState calls over 2000 time steps, in a Show and in a
+//HistoryShow, then the whole fleet is rebuilt at 100 past times
+//Expected result: should return true as recording costs less than 4 times the plain setState
+//and a past fleet comes back in a few milliseconds
+bool Tester::testHistoryTimeMeasurement(){
+    bool result = true;
+    const int size = 10000;
+    const int calls = 2000000;
+    const int perStep = 1000;
+    std::mt19937 generator(4545);
+    std::uniform_int_distribution<int> ids(MINID, MINID + size - 1);
+    vector<int> queries(calls);
+    for(int i=0;i<calls;i++) {
+        queries[i] = ids(generator);
+    }
+    Show show;
+    HistoryShow history;
+    for(int i=0;i<size;i++) {
+        show.insert(Drone(MINID + i));
+        history.insert(Drone(MINID + i));
+    }
+
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    for(int i=0;i<calls;i++) {
+        show.setState(queries[i], static_cast<STATE>(i / 3 % NUMSTATES));
+    }
+    chrono::steady_clock::time_point stop = chrono::steady_clock::now();
+    double plain = chrono::duration<double>(stop - start).count();
+    start = chrono::steady_clock::now();
+    for(int i=0;i<calls;i++) {
+        if (i % perStep == 0) {
+            history.setTime(i / perStep + 1);
+        }
+        history.setState(queries[i], static_cast<STATE>(i / 3 % NUMSTATES));
+    }
+    stop = chrono::steady_clock::now();
+    double recorded = chrono::duration<double>(stop - start).count();
+
+    long long drones = 0;
+    start = chrono::steady_clock::now();
+    for(int t=0;t<100;t++) {
+        drones += history.showAt(history.horizon() + t * (calls / perStep - history.horizon()) / 100).size();
+    }
+    stop = chrono::steady_clock::now();
+    double rebuild = chrono::duration<double>(stop - start).count();
+
+    cout << "setState: " << plain / calls * 1e9 << " ns plain, " << recorded / calls * 1e9 << " ns recorded, "
+         << history.getRecorded() << " transitions, " << history.m_storage.size() * sizeof(HistoryShow::Transition) / 1024
+         << " KB of rings" << endl;
+    cout << "Fleet of " << size << " at a past time: " << rebuild / 100 * 1e3 << " ms, horizon " << history.horizon() << endl;
+    result = result && (show.diff(history.show()).size() == 0);
+    result = result && (drones == 100LL * size);
+    result = result && (recorded < 4 * plain);
+    result = result && (history.m_storage.size() == (size_t)size * HISTORY_DEPTH);
+
+    return result;
+}
+struct TimedCue{//a cue as the tests give it to the scheduler and to the reference show
+    long long tick;
+    bool isState;
+    int lo;
+    int hi;
+    int value;
+};
+void applyCue(Show & show, const TimedCue & cue){
+    if (cue.isState) {
+        show.setStateRange(cue.lo, cue.hi, static_cast<STATE>(cue.value));
+    }
+    else {
+        show.setColorRange(cue.lo, cue.hi, static_cast<LIGHTCOLOR>(cue.value));
+    }
+}
+//Function: Tester::testCueScheduler
+//Case: 5000 random cues up to 300000 ticks ahead, a run of neighbouring single drone cues in
+//one tick, cues more than 2^24 ticks ahead, and cues given late for ticks already run
+//Expected result: should return true as the show matches one that applied the same cues in
+//tick and then schedule order at every check, and the neighbouring cues were merged
+bool Tester::testCueScheduler(){
+    bool result = true;
+    const int size = 2000;
+    Show show;
+    Show expected;
+    for(int i=0;i<size;i++) {
+        show.insert(Drone(MINID + i));
+        expected.insert(Drone(MINID + i));
+    }
+    CueScheduler cues(show);
+    result = result && (cues.toTick(12.5) == 1250);
+
+    std::mt19937 generator(46);
+    std::uniform_int_distribution<long long> ticks(1, 300000);
+    std::uniform_int_distribution<int> ids(MINID - 10, MINID + size + 10);
+    std::uniform_int_distribution<int> widths(0, 60);
+    vector<TimedCue> given;
+    for(int i=0;i<5000;i++) {
+        TimedCue cue;
+        cue.tick = (i % 1000 == 999) ? (1LL << 24) + i % 7 : ticks(generator);
+        cue.isState = i % 2 == 0;
+        cue.lo = ids(generator);
+        cue.hi = cue.lo + (i % 3 == 0 ? 0 : widths(generator));
+        cue.value = cue.isState ? (int)(generator() % NUMSTATES) : (int)(generator() % NUMCOLORS);
+        given.push_back(cue);
+    }
+    for(int i=0;i<100;i++) { // a wave down the line, one tick
+        TimedCue cue = {50, false, MINID + 500 + i, MINID + 500 + i, BLUE};
+        given.push_back(cue);
+    }
+    for(int i=0;i<(int)given.size();i++) {
+        if (given[i].isState) {
+            cues.cueStateAt(given[i].tick, given[i].lo, given[i].hi, static_cast<STATE>(given[i].value));
+        }
+        else {
+            cues.cueColorAt(given[i].tick, given[i].lo, given[i].hi, static_cast<LIGHTCOLOR>(given[i].value));
+        }
+    }
+    cues.cueState(12.5, MINID, MINID + 9, LIGHTOFF);
+    given.push_back(TimedCue{1250, true, MINID, MINID + 9, LIGHTOFF});
+
+    const long long checks[] = {49, 50, 1000, 1250, 65536, 70000, 300000, (1LL << 24) + 10};
+    int done = 0;
+    for(int c=0;c<8;c++) {
+        cues.runUntil(checks[c]);
+        if (c == 2) { // given after tick 1000 for ticks before it, they go into 1001
+            cues.cueStateAt(500, MINID + 100, MINID + 200, LIGHTOFF);
+            cues.cueColorAt(1001, MINID + 150, MINID + 250, GREEN);
+            given.push_back(TimedCue{1001, true, MINID + 100, MINID + 200, LIGHTOFF});
+            given.push_back(TimedCue{1001, false, MINID + 150, MINID + 250, GREEN});
+        }
+        vector<TimedCue> due;
+        for(int i=0;i<(int)given.size();i++) {
+            if (given[i].tick <= checks[c] && (c == 0 || given[i].tick > checks[c - 1])) {
+                due.push_back(given[i]);
+            }
+        }
+        std::stable_sort(due.begin(), due.end(), [](const TimedCue & a, const TimedCue & b) {return a.tick < b.tick;});
+        for(int i=0;i<(int)due.size();i++) {
+            applyCue(expected, due[i]);
+        }
+        done += (int)due.size();
+        result = result && (cues.now() == checks[c]);
+        result = result && (show.diff(expected).size() == 0 && expected.diff(show).size() == 0);
+        result = result && (cues.getApplied() == done);
+        if (c == 1) {
+            result = result && (show.countDrones(BLUE) >= 100);
+        }
+    }
+    result = result && (done == (int)given.size() && cues.pending() == 0);
+    result = result && (cues.getUpdates() < cues.getApplied() - 90); // the wave was one range update
+    result = result && (cues.getCascaded() > 0);
+    result = result && show.testBalance(show.m_root);
+
+    return result;
+}
+//Function: Tester::testCueSchedulerTimeMeasurement
+//Case: 1000000 cues over a 10 minute show of 10 ms ticks on 10000 drones are scheduled, the
+//same ticks go through a priority queue, the show is run on the simulated clock tick by tick,
+//and 20000 cues are played over half a second on the real clock
+//Expected result: should return true as every cue is applied, scheduling takes less than a
+//microsecond per cue, and a tick takes far less time than it lasts on average
+bool Tester::testCueSchedulerTimeMeasurement(){
+    bool result = true;
+    const int size = 10000;
+    const int count = 1000000;
+    const long long length = 60000;
+    std::mt19937 generator(4646);
+    std::uniform_int_distribution<long long> ticks(1, length);
+    std::uniform_int_distribution<int> ids(MINID, MINID + size - 1);
+    std::uniform_int_distribution<int> widths(0, 500);
+    vector<TimedCue> given(count);
+    for(int i=0;i<count;i++) {
+        given[i].tick = ticks(generator);
+        given[i].isState = i % 2 == 0;
+        given[i].lo = ids(generator);
+        given[i].hi = given[i].lo + (i % 4 == 0 ? widths(generator) : 0);
+        given[i].value = given[i].isState ? (int)(generator() % NUMSTATES) : (int)(generator() % NUMCOLORS);
+    }
+    Show show;
+    for(int i=0;i<size;i++) {
+        show.insert(Drone(MINID + i));
+    }
+
+    CueScheduler cues(show);
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    for(int i=0;i<count;i++) {
+        if (given[i].isState) {
+            cues.cueStateAt(given[i].tick, given[i].lo, given[i].hi, static_cast<STATE>(given[i].value));
+        }
+        else {
+            cues.cueColorAt(given[i].tick, given[i].lo, given[i].hi, static_cast<LIGHTCOLOR>(given[i].value));
+        }
+    }
+    chrono::steady_clock::time_point stop = chrono::steady_clock::now();
+    double wheel = chrono::duration<double>(stop - start).count();
+    start = chrono::steady_clock::now();
+    priority_queue<pair<long long, int>, vector<pair<long long, int> >, greater<pair<long long, int> > > polled;
+    for(int i=0;i<count;i++) {
+        polled.push(make_pair(given[i].tick, i));
+    }
+    long long order = 0;
+    while (!polled.empty()) { // what a polling loop pays to get them out in order
+        order += polled.top().second;
+        polled.pop();
+    }
+    stop = chrono::steady_clock::now();
+    double heap = chrono::duration<double>(stop - start).count();
+
+    double total = 0;
+    double worst = 0;
+    double squares = 0;
+    for(long long t=0;t<length;t++) {
+        start = chrono::steady_clock::now();
+        cues.advance();
+        stop = chrono::steady_clock::now();
+        double tick = chrono::duration<double>(stop - start).count();
+        total += tick;
+        squares += tick * tick;
+        worst = max(worst, tick);
+    }
+    double mean = total / length;
+    double deviation = sqrt(max(0.0, squares / length - mean * mean));
+
+    CueScheduler live(show);
+    for(int i=0;i<20000;i++) {
+        live.cueState(0.01 + (i % 50) * 0.01, given[i].lo, given[i].hi, static_cast<STATE>(i % NUMSTATES));
+    }
+    double late = live.play(0.5);
+
+    cout << "Scheduling " << count << " cues: " << wheel / count * 1e9 << " ns per cue in the wheel, "
+         << heap / count * 1e9 << " ns to push and pop a priority queue" << endl;
+    cout << "Tick of " << CUE_TICK * 1e3 << " ms on the simulated clock: " << mean * 1e6 << " us mean, "
+         << deviation * 1e6 << " us deviation, " << worst * 1e6 << " us worst, "
+         << cues.getUpdates() << " show updates for " << cues.getApplied() << " cues" << endl;
+    cout << "Real clock: ticks started at most " << late * 1e3 << " ms late" << endl;
+    result = result && (cues.getApplied() == count && cues.pending() == 0);
+    result = result && (live.getApplied() == 20000);
+    result = result && (order == (long long)count * (count - 1) / 2);
+    result = result && (wheel / count < 1e-6);
+    result = result && (mean < CUE_TICK / 10);
+
+    return result;
+}
+#if defined(__cpp_impl_coroutine)
+struct CueGuard{//tells the test when a coroutine frame is destroyed
+    bool *destroyed;
+    ~CueGuard() {*destroyed = true;}
+};
+CueScheduler::Task chaseCue(CueScheduler & cues, int first, int count, vector<long long> & woke){
+    for(int i=0;i<count;i++) {
+        co_await cues.after(0.05);
+        woke.push_back(cues.now());
+        cues.show().setState(first + i, LIGHTOFF);
+        cues.cueColorAt(cues.now(), first + i, first + i, BLUE); // still in this tick
+    }
+}
+CueScheduler::Task foreverCue(CueScheduler & cues, bool & destroyed){
+    CueGuard guard = {&destroyed};
+    while (true) {
+        co_await cues.after(1.0);
+    }
+}
+//Function: Tester::testCueCoroutine
+//Case: a coroutine turns one drone after another off every 50 ms and cues it BLUE for the
+//same tick, another one waits in a loop forever and is left when the scheduler goes away
+//Expected result: should return true as the first wakes on every fifth tick with its cues
+//applied in that tick, and the second's frame is destroyed with the scheduler
+bool Tester::testCueCoroutine(){
+    bool result = true;
+    Show show;
+    for(int i=0;i<10;i++) {
+        show.insert(Drone(MINID + i, RED, LIGHTON));
+    }
+    bool destroyed = false;
+    vector<long long> woke;
+    {
+        CueScheduler cues(show);
+        chaseCue(cues, MINID, 10, woke);
+        foreverCue(cues, destroyed);
+        cues.runUntil(24);
+        result = result && (woke.size() == 4 && woke[0] == 5 && woke[3] == 20);
+        result = result && (show.countDrones(LIGHTOFF) == 4 && show.countDrones(BLUE) == 4);
+        cues.runUntil(300);
+        result = result && (woke.size() == 10 && woke[9] == 50);
+        result = result && (show.countDrones(LIGHTOFF) == 10 && show.countDrones(BLUE) == 10);
+        result = result && (cues.pending() == 1 && !destroyed);
+    }
+    result = result && destroyed;
+
+    return result;
+}
+#endif
+bool sameDrones(const vector<DroneChange> & one, const vector<DroneChange> & other){
+    if (one.size() != other.size()) {
+        return false;
+    }
+    for(int i=0;i<(int)one.size();i++) {
+        if (one[i].id != other[i].id || one[i].type != other[i].type || one[i].state != other[i].state) {
+            return false;
+        }
+    }
+    return true;
+}
+//Function: Tester::testFrameCodec
+//Case: 60 frames of random inserts, removes, state and color changes, range updates and
+//deferred removes are sent as a full frame followed by delta frames, with a second full frame
+//halfway; then a delta frame goes missing, frames are torn or corrupt, the buffer is too small,
+//and the show is empty or has every ID
+//Expected result: should return true as the decoder holds the show after every frame it takes,
+//refuses the frames it can't trust without changing, and the frame sizes are the expected ones
+bool Tester::testFrameCodec(){
+    bool result = true;
+    Show show;
+    Show empty;
+    show.setDeferredRemove(0.3);
+    FrameEncoder encoder;
+    FrameDecoder decoder;
+    vector<unsigned char> buffer(FrameEncoder::maxBytes());
+    long long base = sizeof(FrameHeader) + FRAME_SUMMARY * sizeof(unsigned long long);
+
+    long long bytes = encoder.encode(show, buffer.data(), buffer.size());
+    result = result && (bytes == base && decoder.decode(buffer.data(), bytes) && decoder.size() == 0);
+    std::mt19937 generator(47);
+    std::uniform_int_distribution<int> ids(MINID, MAXID);
+    std::uniform_int_distribution<int> ops(0, 99);
+    for(int frame=1;frame<=60;frame++) {
+        for(int i=0;i<200;i++) {
+            int op = ops(generator);
+            int id = frame < 30 ? ids(generator) : MINID + ids(generator) % 2000; // later on, a crowded corner
+            if (op < 50) {
+                show.insert(Drone(id, static_cast<LIGHTCOLOR>(op % NUMCOLORS), static_cast<STATE>(op % NUMSTATES)));
+            }
+            else if (op < 65) {
+                show.remove(id);
+            }
+            else if (op < 80) {
+                show.setState(id, static_cast<STATE>(op % NUMSTATES));
+            }
+            else if (op < 98) {
+                show.setColor(id, static_cast<LIGHTCOLOR>(op % NUMCOLORS));
+            }
+            else {
+                show.setColorRange(id, id + 500, static_cast<LIGHTCOLOR>(op % NUMCOLORS));
+            }
+        }
+        FRAMEKIND kind = frame == 30 ? FRAME_FULL : FRAME_DELTA;
+        bytes = encoder.encode(show, buffer.data(), buffer.size(), kind);
+        result = result && (bytes > base && decoder.decode(buffer.data(), bytes));
+        result = result && (decoder.getSequence() == (unsigned)frame && decoder.size() == show.countDrones(LIGHTON) + show.countDrones(LIGHTOFF));
+        result = result && sameDrones(decoder.getDrones(), show.diff(empty).added);
+    }
+    LIGHTCOLOR color = RED;
+    STATE state = LIGHTON;
+    vector<DroneChange> before = decoder.getDrones();
+    result = result && decoder.getDrone(before[0].id, color, state) && color == before[0].type && state == before[0].state;
+    result = result && !decoder.findDrone(MINID - 1) && !decoder.findDrone(MAXID + 1);
+
+    bytes = encoder.encode(show, buffer.data(), buffer.size(), FRAME_DELTA); // nothing changed
+    result = result && (bytes == base && decoder.decode(buffer.data(), bytes));
+    show.setStateRange(MINID, MAXID, LIGHTOFF);
+    result = result && (encoder.encode(show, buffer.data(), base, FRAME_DELTA) == -1); // too small, nothing sent
+    bytes = encoder.encode(show, buffer.data(), buffer.size(), FRAME_DELTA);
+    vector<unsigned char> torn(buffer.begin(), buffer.begin() + bytes);
+    result = result && !decoder.decode(torn.data(), bytes - 8) && sameDrones(decoder.getDrones(), before);
+    torn[0] ^= 1;
+    result = result && !decoder.decode(torn.data(), bytes);
+    torn[0] ^= 1;
+    result = result && decoder.decode(torn.data(), bytes) && decoder.size() == show.countDrones(LIGHTOFF);
+
+    show.removeLightOff();
+    show.insert(Drone(MINID, BLUE, LIGHTON));
+    encoder.encode(show, buffer.data(), buffer.size(), FRAME_DELTA); // lost on the way
+    show.insert(Drone(MAXID, GREEN, LIGHTON));
+    bytes = encoder.encode(show, buffer.data(), buffer.size(), FRAME_DELTA);
+    result = result && !decoder.decode(buffer.data(), bytes) && decoder.size() == (int)before.size();
+    bytes = encoder.encode(show, buffer.data(), buffer.size(), FRAME_FULL);
+    result = result && decoder.decode(buffer.data(), bytes) && sameDrones(decoder.getDrones(), show.diff(empty).added);
+    result = result && (decoder.size() == 2 && decoder.findDrone(MAXID));
+
+    Show everyone;
+    for(int id=MINID;id<=MAXID;id++) {
+        everyone.insert(Drone(id, static_cast<LIGHTCOLOR>(id % NUMCOLORS), static_cast<STATE>(id / 7 % NUMSTATES)));
+    }
+    FrameEncoder fresh;
+    bytes = fresh.encode(everyone, buffer.data(), buffer.size());
+    result = result && (bytes == FrameEncoder::maxBytes() && decoder.decode(buffer.data(), bytes));
+    result = result && sameDrones(decoder.getDrones(), everyone.diff(empty).added);
+
+    return result;
+}
+//Function: Tester::testFrameCodecTimeMeasurement
+//Case: a show of all 90000 IDs is encoded as 1000 full frames, then takes 900 random changes
+//before each of 1000 delta frames, and the full frame is decoded 200 times
+//Expected result: should return true as a full frame is encoded in less than a millisecond,
+//is 3 bits per drone plus the bitmaps, and a delta frame is a small part of it
+bool Tester::testFrameCodecTimeMeasurement(){
+    bool result = true;
+    const int frames = 1000;
+    Show show;
+    for(int id=MINID;id<=MAXID;id++) {
+        show.insert(Drone(id, static_cast<LIGHTCOLOR>(id % NUMCOLORS), static_cast<STATE>(id % 5 % NUMSTATES)));
+    }
+    int size = MAXID - MINID + 1;
+    FrameEncoder encoder;
+    vector<unsigned char> buffer(FrameEncoder::maxBytes());
+    long long full = 0;
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    for(int i=0;i<frames;i++) {
+        full = encoder.encode(show, buffer.data(), buffer.size(), FRAME_FULL);
+    }
+    chrono::steady_clock::time_point stop = chrono::steady_clock::now();
+    double encodeFull = chrono::duration<double>(stop - start).count() / frames;
+
+    std::mt19937 generator(4747);
+    std::uniform_int_distribution<int> ids(MINID, MAXID);
+    double encodeDelta = 0;
+    long long deltaBytes = 0;
+    for(int i=0;i<frames;i++) {
+        for(int j=0;j<size/100;j++) {
+            show.setState(ids(generator), static_cast<STATE>(j % NUMSTATES));
+        }
+        start = chrono::steady_clock::now();
+        deltaBytes += encoder.encode(show, buffer.data(), buffer.size(), FRAME_DELTA);
+        stop = chrono::steady_clock::now();
+        encodeDelta += chrono::duration<double>(stop - start).count();
+    }
+    encodeDelta /= frames;
+    deltaBytes /= frames;
+
+    full = encoder.encode(show, buffer.data(), buffer.size(), FRAME_FULL);
+    FrameDecoder decoder;
+    bool decoded = true;
+    start = chrono::steady_clock::now();
+    for(int i=0;i<200;i++) {
+        decoded = decoded && decoder.decode(buffer.data(), full);
+    }
+    stop = chrono::steady_clock::now();
+    double decodeFull = chrono::duration<double>(stop - start).count() / 200;
+
+    cout << "Full frame of " << size << " drones: " << full << " bytes, " << encodeFull * 1e6 << " us to encode ("
+         << full / encodeFull / 1e9 << " GB/s), " << decodeFull * 1e6 << " us to decode" << endl;
+    cout << "Delta frame with 1% changed: " << deltaBytes << " bytes, " << encodeDelta * 1e6 << " us to encode" << endl;
+    result = result && (full == FrameEncoder::maxBytes() && decoded && decoder.size() == size);
+    result = result && (deltaBytes * 10 < full);
+    result = result && (encodeFull < 1e-3);
+
+    return result;
+}
+//Function: Tester::testCheckedMode
+//Case: random inserts, removes, deferred removes with compaction and a load keep the tree
+//right; then a stored height and an ID are broken by hand, and an insert passes the broken ID
+//Expected result: should return true as checkTree finds both, and the insert reports the
+//broken ID when SHOW_CHECKED is defined and costs nothing otherwise
+bool Tester::testCheckedMode(){
+    bool result = true;
+    Show show;
+    std::mt19937 generator(48);
+    std::uniform_int_distribution<int> ids(MINID, MINID + 5000);
+    for(int i=0;i<20000;i++) {
+        if (i % 3 == 2) {
+            show.remove(ids(generator));
+        }
+        else {
+            show.insert(Drone(ids(generator)));
+        }
+        if (i == 10000) {
+            show.setDeferredRemove(0.2);
+        }
+    }
+    result = result && show.checkTree() && show.getViolations() == 0;
+    Show loaded;
+    vector<DroneChange> drones = show.diff(Show()).added;
+    result = result && loaded.load(drones) && loaded.checkTree() && loaded.getViolations() == 0;
+    int size = loaded.countDrones(LIGHTOFF) + loaded.countDrones(LIGHTON);
+    swap(drones[0], drones[1]); // out of order
+    result = result && !loaded.load(drones);
+    swap(drones[0], drones[1]);
+    int second = drones[1].id;
+    drones[1].id = drones[0].id; // duplicate
+    result = result && !loaded.load(drones);
+    drones[1].id = second;
+    drones.back().id = MAXID + 1; // out of range
+    result = result && !loaded.load(drones);
+    drones.back().id = MAXID;
+    drones[0].id = MINID - 1;
+    result = result && !loaded.load(drones);
+    result = result && loaded.countDrones(LIGHTOFF) + loaded.countDrones(LIGHTON) == size && loaded.checkTree();
+
+    show.m_root->m_height++;
+    result = result && !show.checkTree();
+    show.m_root->m_height--;
+    Drone *leftMax = show.m_root->m_left;
+    while (leftMax->m_right != nullptr) {
+        leftMax = leftMax->m_right;
+    }
+    int id = leftMax->m_id;
+    leftMax->m_id = show.m_root->m_id + 1; // on the wrong side of the root
+    result = result && !show.checkTree();
+    leftMax->m_id = id;
+    result = result && show.checkTree();
+
+    Show small;
+    small.insert(Drone(20000));
+    small.insert(Drone(10000));
+    small.insert(Drone(30000));
+    small.m_root->m_right->m_id = 15000; // the root's check sees it when the insert retraces
+    small.insert(Drone(12000));
+#ifdef SHOW_CHECKED
+    result = result && (small.getViolations() > 0);
+#else
+    result = result && (small.getViolations() == 0);
+#endif
+    small.m_root->m_right->m_id = 30000;
+    result = result && small.checkTree();
+
+    return result;
+}
+//Function: Tester::testCheckedModeTimeMeasurement
+//Case: 200000 random inserts and removes on up to 50000 drones, then checkTree on the result
+//Expected result: should return true as no check fails and a full check costs more than a
+//hundred mutations, it prints the workload time next to what a full check would add; the same test built with and without
+//SHOW_CHECKED shows what the path checks cost
+bool Tester::testCheckedModeTimeMeasurement(){
+    bool result = true;
+    const int calls = 200000;
+    std::mt19937 generator(4848);
+    std::uniform_int_distribution<int> ids(MINID, MINID + 50000);
+    vector<int> queries(calls);
+    for(int i=0;i<calls;i++) {
+        queries[i] = ids(generator);
+    }
+    Show show;
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    for(int i=0;i<calls;i++) {
+        if (i % 4 == 3) {
+            show.remove(queries[i]);
+        }
+        else {
+            show.insert(Drone(queries[i]));
+        }
+    }
+    chrono::steady_clock::time_point stop = chrono::steady_clock::now();
+    double workload = chrono::duration<double>(stop - start).count();
+    bool checked = true;
+    start = chrono::steady_clock::now();
+    for(int i=0;i<10;i++) {
+        checked = checked && show.checkTree();
+    }
+    stop = chrono::steady_clock::now();
+    double fullCheck = chrono::duration<double>(stop - start).count() / 10;
+
+#ifdef SHOW_CHECKED
+    cout << "Checked mode compiled in: ";
+#else
+    cout << "Checked mode compiled out: ";
+#endif
+    cout << workload / calls * 1e9 << " ns per insert or remove, a full check of "
+         << show.m_store.size() << " drones takes " << fullCheck * 1e3 << " ms" << endl;
+    result = result && checked && show.getViolations() == 0;
+    result = result && (fullCheck > 100 * workload / calls); // a full check costs more than a hundred mutations
+
+    return result;
+}
+bool matchesQuery(const DroneChange & drone, const DroneQuery & query){
+    return query.lo <= drone.id && drone.id <= query.hi && (query.color == NO_TAG || query.color == drone.type)
+           && (query.state == NO_TAG || query.state == drone.state);
+}
+//Function: Tester::testQuery
+//Case: random drones with range updates still pending and deferred removes, 300 random
+//queries over ID ranges, colors and states, some of them outside MINID and MAXID, run with
+//every plan; then bulk updates next to a copy that gets one setState or setColor per drone
+//Expected result: should return true as every plan counts and lists what a filter over all
+//drones finds, the bulk updates leave both shows the same, and the planner picks the index
+//for the dense show and walks the tree for a show with a few drones over a wide range
+bool Tester::testQuery(){
+    bool result = true;
+    Show show;
+    std::mt19937 generator(49);
+    std::uniform_int_distribution<int> ids(MINID, MINID + 20000);
+    std::uniform_int_distribution<int> colors(0, NUMCOLORS - 1);
+    std::uniform_int_distribution<int> states(0, NUMSTATES - 1);
+    show.setDeferredRemove(0.3);
+    for(int i=0;i<8000;i++) {
+        show.insert(Drone(ids(generator), static_cast<LIGHTCOLOR>(colors(generator)), static_cast<STATE>(states(generator))));
+        if (i % 5 == 0) {
+            show.remove(ids(generator));
+        }
+        if (i % 500 == 0) {
+            int lo = ids(generator);
+            show.setStateRange(lo, lo + 3000, static_cast<STATE>(states(generator)));
+            show.setColorRange(lo + 1000, lo + 2000, static_cast<LIGHTCOLOR>(colors(generator)));
+        }
+    }
+    vector<DroneChange> all = show.diff(Show()).added;
+    std::uniform_int_distribution<int> kinds(NO_TAG, NUMCOLORS - 1);
+    for(int i=0;i<300;i++) {
+        int lo = ids(generator) - 100;
+        DroneQuery query = {lo, lo + (i % 3 == 0 ? 20 : ids(generator) - MINID), kinds(generator), kinds(generator) % NUMSTATES};
+        vector<int> expected;
+        for(int j=0;j<(int)all.size();j++) {
+            if (matchesQuery(all[j], query)) {
+                expected.push_back(all[j].id);
+            }
+        }
+        for(int plan=PLAN_SCAN;plan<=PLAN_INDEX;plan++) {
+            vector<int> found;
+            int count = show.runQuery(query, static_cast<QUERYPLAN>(plan), &found);
+            result = result && (count == (int)expected.size() && found == expected);
+            result = result && (show.runQuery(query, static_cast<QUERYPLAN>(plan), nullptr) == count);
+        }
+        result = result && (show.countDrones(query) == (int)expected.size() && show.getDrones(query) == expected);
+    }
+
+    Show reference(show);
+    for(int i=0;i<40;i++) {
+        int lo = ids(generator);
+        DroneQuery query = {lo, lo + 4000, kinds(generator), kinds(generator) % NUMSTATES};
+        vector<int> matched;
+        reference.runQuery(query, PLAN_SCAN, &matched);
+        int changed = 0;
+        if (i % 2 == 0) {
+            STATE state = static_cast<STATE>(states(generator));
+            changed = show.setState(query, state);
+            for(int j=0;j<(int)matched.size();j++) reference.setState(matched[j], state);
+        }
+        else {
+            LIGHTCOLOR color = static_cast<LIGHTCOLOR>(colors(generator));
+            changed = show.setColor(query, color);
+            for(int j=0;j<(int)matched.size();j++) reference.setColor(matched[j], color);
+        }
+        result = result && (changed == (int)matched.size());
+    }
+    result = result && sameDrones(show.diff(Show()).added, reference.diff(Show()).added);
+    result = result && show.checkTree();
+
+    DroneQuery narrow = {MINID + 5000, MINID + 5003, RED, NO_TAG};
+    DroneQuery everything = {MINID, MAXID, NO_TAG, LIGHTOFF};
+    DroneQuery wide = {MINID, MINID + 20000, RED, LIGHTON};
+    result = result && (show.planQuery(narrow) == PLAN_INDEX && show.planQuery(everything) == PLAN_INDEX);
+    Show sparse;
+    for(int i=0;i<10;i++) {
+        sparse.insert(Drone(MINID + 1000 * i));
+    }
+    result = result && (sparse.planQuery(wide) == PLAN_RANGE && sparse.planQuery(everything) == PLAN_SCAN);
+    result = result && (sparse.countDrones(wide) == sparse.runQuery(wide, PLAN_INDEX, nullptr));
+    DroneQuery empty = {MINID + 10, MINID + 5, NO_TAG, NO_TAG};
+    result = result && (show.countDrones(empty) == 0 && show.setState(empty, LIGHTON) == 0);
+    result = result && (Show().countDrones(everything) == 0 && Show().planQuery(everything) == PLAN_SCAN);
+
+    return result;
+}
+//Function: Tester::testQueryTimeMeasurement
+//Case: 50000 random drones, a count of the red drones that are off in 40000 to 45000, the
+//list of the blue drones, a count over ten IDs and a bulk setState of the green drones in
+//20000 to 60000, each with the planned access path and with a scan of the whole tree
+//Expected result: should return true as both give the same answers and the planned path is
+//faster for the count, the list and the bulk update, it prints both times of each query
+bool Tester::testQueryTimeMeasurement(){
+    bool result = true;
+    const int size = 50000;
+    const int repeats = 50;
+    Show show;
+    std::mt19937 generator(4949);
+    std::uniform_int_distribution<int> ids(MINID, MAXID);
+    std::uniform_int_distribution<int> colors(0, NUMCOLORS - 1);
+    std::uniform_int_distribution<int> states(0, NUMSTATES - 1);
+    while (show.m_store.size() < size) {
+        show.insert(Drone(ids(generator), static_cast<LIGHTCOLOR>(colors(generator)), static_cast<STATE>(states(generator))));
+    }
+    DroneQuery queries[] = {{40000, 45000, RED, LIGHTOFF}, {MINID, MAXID, BLUE, NO_TAG}, {50000, 50009, NO_TAG, LIGHTON}};
+    const char *names[] = {"count red and off in 40000-45000", "list blue", "count on in 50000-50009"};
+    double planned[4];
+    double scan[4];
+    for(int q=0;q<3;q++) {
+        long long plannedSum = 0;
+        long long scanSum = 0;
+        chrono::steady_clock::time_point start = chrono::steady_clock::now();
+        for(int i=0;i<repeats;i++) {
+            plannedSum += (q == 1) ? (long long)show.getDrones(queries[q]).size() : show.countDrones(queries[q]);
+        }
+        chrono::steady_clock::time_point stop = chrono::steady_clock::now();
+        planned[q] = chrono::duration<double>(stop - start).count() / repeats;
+        start = chrono::steady_clock::now();
+        for(int i=0;i<repeats;i++) {
+            vector<int> found;
+            scanSum += show.runQuery(queries[q], PLAN_SCAN, (q == 1) ? &found : nullptr);
+        }
+        stop = chrono::steady_clock::now();
+        scan[q] = chrono::duration<double>(stop - start).count() / repeats;
+        result = result && (plannedSum == scanSum);
+    }
+
+    Show updated(show); // both laid out the same by the copy
+    Show scanned(show);
+    DroneQuery bulk = {20000, 60000, GREEN, NO_TAG};
+    int changed = 0;
+    int matchedSum = 0;
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    for(int i=0;i<10;i++) { // the same drones each time, every other time back on
+        changed += updated.setState(bulk, (i % 2 == 0) ? LIGHTOFF : LIGHTON);
+    }
+    chrono::steady_clock::time_point stop = chrono::steady_clock::now();
+    planned[3] = chrono::duration<double>(stop - start).count() / 10;
+    start = chrono::steady_clock::now();
+    for(int i=0;i<10;i++) {
+        vector<int> matched;
+        scanned.runQuery(bulk, PLAN_SCAN, &matched);
+        for(int j=0;j<(int)matched.size();j++) {
+            scanned.setState(matched[j], (i % 2 == 0) ? LIGHTOFF : LIGHTON);
+        }
+        matchedSum += (int)matched.size();
+    }
+    stop = chrono::steady_clock::now();
+    scan[3] = chrono::duration<double>(stop - start).count() / 10;
+    result = result && (changed == matchedSum);
+    result = result && sameDrones(updated.diff(Show()).added, scanned.diff(Show()).added);
+
+    for(int q=0;q<4;q++) {
+        cout << "Query " << (q < 3 ? names[q] : "setState green in 20000-60000") << ": " << planned[q] * 1e6
+             << " us planned, " << scan[q] * 1e6 << " us with a full scan" << endl;
+    }
+    result = result && (planned[0] < scan[0] && planned[1] < scan[1] && planned[3] < scan[3]);
+
+    return result;
+}
+bool sameLight(const Light & one, const Light & other){
+    return one.red == other.red && one.green == other.green && one.blue == other.blue && one.bright == other.bright;
+}
+//Function: Tester::testLightFrame
+//Case: a show with range updates still pending is loaded into a light frame and range set
+//with colors and states; then fades, gradients and blinks of odd lengths and offsets run
+//next to the scalar loops and a per ID formula
+//Expected result: should return true as every drone has the light of its color and state,
+//nearestColor gives the color back, IDs without a drone are dark, and the kernels agree with
+//the scalar loops byte for byte, with the ends of a fade and a gradient exact
+bool Tester::testLightFrame(){
+    bool result = true;
+    Show show;
+    std::mt19937 generator(50);
+    std::uniform_int_distribution<int> ids(MINID, MAXID);
+    std::uniform_int_distribution<int> colors(0, NUMCOLORS - 1);
+    std::uniform_int_distribution<int> states(0, NUMSTATES - 1);
+    for(int i=0;i<20000;i++) {
+        show.insert(Drone(ids(generator), static_cast<LIGHTCOLOR>(colors(generator)), static_cast<STATE>(states(generator))));
+    }
+    show.setColorRange(30000, 35000, BLUE);
+    show.setStateRange(33000, 40000, LIGHTOFF);
+    LightFrame frame;
+    frame.load(show);
+    vector<DroneChange> drones = show.diff(Show()).added;
+    vector<bool> present(MAXID - MINID + 1, false);
+    for(int i=0;i<(int)drones.size();i++) {
+        present[drones[i].id - MINID] = true;
+        result = result && sameLight(frame.getLight(drones[i].id), LightFrame::toLight(drones[i].type, drones[i].state));
+        result = result && (frame.nearestColor(drones[i].id) == drones[i].type);
+    }
+    Light dark = {0, 0, 0, 0};
+    for(int id=MINID;id<=MAXID;id++) {
+        result = result && (present[id - MINID] || sameLight(frame.getLight(id), dark));
+    }
+    frame.setColor(MINID - 5, MINID + 10, GREEN);
+    frame.setState(MINID, MINID + 4, LIGHTON);
+    frame.setState(MINID + 5, MINID + 10, LIGHTOFF);
+    result = result && sameLight(frame.getLight(MINID + 3), LightFrame::toLight(GREEN, LIGHTON));
+    result = result && sameLight(frame.getLight(MINID + 7), LightFrame::toLight(GREEN, LIGHTOFF));
+    result = result && sameLight(frame.getLight(MINID - 1), dark) && frame.nearestColor(MINID + 10) == GREEN;
+
+    std::uniform_int_distribution<int> bytes(0, 255);
+    const int sizes[] = {0, 1, 15, 16, 17, 33, 1000, 1031};
+    const int weights[] = {0, 1, 77, 128, 255, LIGHT_STEPS};
+    for(int s=0;s<8;s++) {
+        vector<unsigned char> from(sizes[s]), to(sizes[s]), scalar(sizes[s]), packed(sizes[s]);
+        for(int i=0;i<sizes[s];i++) {
+            from[i] = (unsigned char)bytes(generator);
+            to[i] = (unsigned char)bytes(generator);
+        }
+        for(int w=0;w<6;w++) {
+            LightFrame::fadeBytes(from.data(), to.data(), scalar.data(), sizes[s], weights[w]);
+            LightFrame::fadeBytesSIMD(from.data(), to.data(), packed.data(), sizes[s], weights[w]);
+            result = result && (scalar == packed);
+            result = result && (weights[w] != 0 || scalar == from) && (weights[w] != LIGHT_STEPS || scalar == to);
+        }
+        if (sizes[s] > 1) {
+            int step = ((LIGHT_STEPS << 16) + sizes[s] - 2) / (sizes[s] - 1);
+            LightFrame::gradientBytes(scalar.data(), 0, sizes[s], from[0], to[0], step);
+            LightFrame::gradientBytesSIMD(packed.data(), sizes[s], from[0], to[0], step);
+            result = result && (scalar == packed && scalar[0] == from[0] && scalar[sizes[s] - 1] == to[0]);
+        }
+    }
+
+    LightFrame other;
+    other.load(show);
+    Light first = {255, 0, 40, 255};
+    Light last = {0, 200, 40, 10};
+    other.gradient(50000, 50999, first, last);
+    result = result && sameLight(other.getLight(50000), first) && sameLight(other.getLight(50999), last);
+    for(int id=50001;id<=50999;id++) { // red only goes down, green only up
+        result = result && (other.getLight(id).red <= other.getLight(id - 1).red && other.getLight(id).green >= other.getLight(id - 1).green);
+        result = result && (other.getLight(id).blue == 40);
+    }
+    LightFrame mixed;
+    mixed.fade(frame, other, 0.5);
+    for(int id=MINID;id<=MAXID;id+=97) {
+        Light a = frame.getLight(id);
+        Light b = other.getLight(id);
+        result = result && (mixed.getLight(id).red == (a.red + b.red) / 2 && mixed.getLight(id).bright == (a.bright + b.bright) / 2);
+    }
+    mixed.fade(mixed, other, 1.0); // out is one of the frames it reads
+    for(int id=MINID;id<=MAXID;id+=97) {
+        result = result && sameLight(mixed.getLight(id), other.getLight(id));
+    }
+
+    const int periods[] = {1, 3, 8, 16, 40, 100};
+    for(int p=0;p<6;p++) {
+        LightFrame blinking;
+        blinking.setState(MINID, MAXID, LIGHTON);
+        int on = periods[p] / 2 + 1;
+        long long when = 1000 + p;
+        blinking.blink(20000 + p, 20999, periods[p], on, when);
+        for(int id=19990;id<=21010;id++) {
+            bool lit = id < 20000 + p || id > 20999 || (id - 20000 - p + when) % periods[p] < on;
+            result = result && (blinking.getLight(id).bright == (lit ? LIGHT_FULL : 0));
+        }
+    }
+
+    return result;
+}
+//Function: Tester::testLightFrameTimeMeasurement
+//Case: 90000 drones, every frame fades the whole fleet between two key frames, lays a
+//gradient over 20000 IDs and blinks half of them, with the kernels and with the scalar
+//loops; then one frame of 90000 Show::setColor calls for comparison
+//Expected result: should return true as both ways end on the same frame and the kernels
+//keep well above 60 frames per second, it prints the frames per second of each way
+bool Tester::testLightFrameTimeMeasurement(){
+    bool result = true;
+    const int frames = 200;
+    Show show;
+    for(int i=MINID;i<=MAXID;i++){
+        show.emplace(i, static_cast<LIGHTCOLOR>(i % 3), static_cast<STATE>(i % 7 == 0));
+    }
+    LightFrame start;
+    start.load(show);
+    LightFrame finish;
+    finish.load(show);
+    finish.setColor(MINID, MAXID, BLUE);
+    Light first = {255, 128, 0, 255};
+    Light last = {0, 128, 255, 255};
+
+    LightFrame kernels;
+    chrono::steady_clock::time_point begin = chrono::steady_clock::now();
+    for(int f=0;f<frames;f++) {
+        kernels.fade(start, finish, (double)f / (frames - 1));
+        kernels.gradient(40000, 59999, first, last);
+        kernels.blink(50000, 59999, 12, 7, f);
+    }
+    chrono::steady_clock::time_point end = chrono::steady_clock::now();
+    double kernelTime = chrono::duration<double>(end - begin).count() / frames;
+
+    LightFrame scalar;
+    begin = chrono::steady_clock::now();
+    for(int f=0;f<frames;f++) { // the same frame from the scalar loops
+        int weight = (int)lround((double)f / (frames - 1) * LIGHT_STEPS);
+        for(int c=0;c<NUMCHANNELS;c++) {
+            LightFrame::fadeBytes(start.m_columns[c].data(), finish.m_columns[c].data(), scalar.m_columns[c].data(), MAXID - MINID + 1, weight);
+        }
+        const unsigned char from[NUMCHANNELS] = {first.red, first.green, first.blue, first.bright};
+        const unsigned char to[NUMCHANNELS] = {last.red, last.green, last.blue, last.bright};
+        int step = ((LIGHT_STEPS << 16) + 20000 - 2) / (20000 - 1);
+        for(int c=0;c<NUMCHANNELS;c++) {
+            LightFrame::gradientBytes(scalar.m_columns[c].data() + (40000 - MINID), 0, 20000, from[c], to[c], step);
+        }
+        unsigned char *bright = scalar.m_columns[CHANNEL_BRIGHT].data();
+        for(int id=50000;id<=59999;id++) {
+            if ((id - 50000 + f) % 12 >= 7) {
+                bright[id - MINID] = 0;
+            }
+        }
+    }
+    end = chrono::steady_clock::now();
+    double scalarTime = chrono::duration<double>(end - begin).count() / frames;
+
+    begin = chrono::steady_clock::now();
+    for(int i=MINID;i<=MAXID;i++) { // one frame the old way, a drone at a time
+        show.setColor(i, static_cast<LIGHTCOLOR>((i + 1) % 3));
+    }
+    end = chrono::steady_clock::now();
+    double droneTime = chrono::duration<double>(end - begin).count();
+
+    cout << "Light frames of 90000 drones: " << 1 / kernelTime << " frames per second with the kernels, "
+         << 1 / scalarTime << " with scalar loops, " << 1 / droneTime << " with a setColor per drone" << endl;
+    for(int c=0;c<NUMCHANNELS;c++) {
+        result = result && (kernels.m_columns[c] == scalar.m_columns[c]);
+    }
+    result = result && (kernelTime < 1.0 / 60); // fits in a frame at 60 fps
+    result = result && (kernelTime < droneTime);
+
+    return result;
+}
+//Function: Tester::testSparseSpatialQueries
+//Case: 10 drones within a few metres of the origin, then nearest and radius queries from
+//(1000,1000,1000) and further away, where the cube around the search ball has millions of cells;
+//then drones 2^21 cells apart and one past the cells the keys can hold
+//Expected result: should return true as the queries find the same drones as checking every
+//drone and all of them together take well under a second, they only visit the occupied cells,
+//and the far drones are neither mixed up with the ones near the origin nor lost
+bool Tester::testSparseSpatialQueries(){
+    bool result = true;
+    Show show;
+    for(int i=0;i<10;i++) {
+        Drone drone(MINID + i);
+        drone.setPosition(i * 0.7, -i * 0.4, i % 3);
+        show.insert(drone);
+    }
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    vector<int> nearest = show.findNearest(1000, 1000, 1000, 1);
+    vector<int> nearestAll = show.findNearest(-1e6, 5e5, 2e6, 20); // more than there are
+    vector<int> everything = show.findNear(1000, 1000, 1000, 5000);
+    vector<int> nothing = show.findNear(1000, 1000, 1000, 1500);
+    vector<int> huge = show.findNear(0, 0, 0, 1e300);
+    chrono::steady_clock::time_point stop = chrono::steady_clock::now();
+    double seconds = chrono::duration<double>(stop - start).count();
+
+    int closest = MINID;
+    double best = -1;
+    for(int i=0;i<10;i++) {
+        double dx = i * 0.7 - 1000, dy = -i * 0.4 - 1000, dz = i % 3 - 1000;
+        if (best < 0 || dx * dx + dy * dy + dz * dz < best) {
+            best = dx * dx + dy * dy + dz * dz;
+            closest = MINID + i;
+        }
+    }
+    result = result && (nearest.size() == 1 && nearest[0] == closest);
+    result = result && (nearestAll.size() == 10 && everything.size() == 10 && huge.size() == 10 && nothing.empty());
+    cout << "Sparse fleet, far nearest and radius queries: " << seconds * 1e3 << " ms" << endl;
+    result = result && (seconds < 0.1);
+
+    Show far; // 2^21 cells apart on x, and past the last cell the keys can hold
+    double xs[4] = {0, 4194304, 4194305, 1e9};
+    for(int i=0;i<4;i++) {
+        Drone drone(MINID + i);
+        drone.setPosition(xs[i], 0, 0);
+        far.insert(drone);
+    }
+    result = result && (far.findNear(4194304, 0, 0, 1000).size() == 2 && far.findNear(0, 0, 0, 1000).size() == 1);
+    result = result && (far.findNear(1e9, 0, 0, 10).size() == 1 && far.findNear(1e9 - 100, 0, 0, 10).empty());
+    vector<int> farthest = far.findNearest(2e9, 0, 0, 1);
+    result = result && (farthest.size() == 1 && farthest[0] == MINID + 3);
+    vector<pair<int,int> > pairs = far.findCollisions(1.0); // exactly 1 m apart counts
+    result = result && (pairs.size() == 1 && pairs[0] == make_pair(MINID + 1, MINID + 2));
+
+    return result;
+}
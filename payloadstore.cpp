@@ -0,0 +1,109 @@
+#include "payloadstore.h"
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+PayloadStore::PayloadStore(){
+}
+
+int PayloadStore::add(int id, int color, int state){
+    int slot;
+    if (!m_free.empty()) {
+        slot = m_free.back();
+        m_free.pop_back();
+        m_ids[slot] = id;
+        m_colors[slot] = (unsigned char)color;
+        m_states[slot] = (unsigned char)state;
+    }
+    else {
+        slot = (int)m_ids.size();
+        m_ids.push_back(id);
+        m_colors.push_back((unsigned char)color);
+        m_states.push_back((unsigned char)state);
+    }
+    return slot;
+}
+
+void PayloadStore::release(int slot){
+    m_colors[slot] = FREE_SLOT; // the kernels skip it without a separate mask
+    m_states[slot] = FREE_SLOT;
+    m_free.push_back(slot);
+}
+
+void PayloadStore::clear(){
+    m_ids.clear();
+    m_colors.clear();
+    m_states.clear();
+    m_free.clear();
+}
+
+void PayloadStore::swap(PayloadStore & rhs){
+    m_ids.swap(rhs.m_ids);
+    m_colors.swap(rhs.m_colors);
+    m_states.swap(rhs.m_states);
+    m_free.swap(rhs.m_free);
+}
+
+int PayloadStore::countColor(int color) const{
+    return countBytesSIMD(m_colors.data(), (int)m_colors.size(), (unsigned char)color);
+}
+
+int PayloadStore::countState(int state) const{
+    return countBytesSIMD(m_states.data(), (int)m_states.size(), (unsigned char)state);
+}
+
+int PayloadStore::countBytes(const unsigned char *column, int size, unsigned char value){
+    int count = 0;
+    for (int i = 0; i < size; i++) {
+        count += (column[i] == value);
+    }
+    return count;
+}
+
+int PayloadStore::countBytesSIMD(const unsigned char *column, int size, unsigned char value){
+    int count = 0;
+    int i = 0;
+#if defined(__AVX2__)
+    __m256i wanted = _mm256_set1_epi8((char)value);
+    for (; i + 32 <= size; i += 32) { // 32 drones per compare
+        __m256i block = _mm256_loadu_si256((const __m256i*)(column + i));
+        count += __builtin_popcount((unsigned)_mm256_movemask_epi8(_mm256_cmpeq_epi8(block, wanted)));
+    }
+#elif defined(__SSE2__)
+    __m128i wanted = _mm_set1_epi8((char)value);
+    for (; i + 16 <= size; i += 16) { // 16 drones per compare
+        __m128i block = _mm_loadu_si128((const __m128i*)(column + i));
+        count += __builtin_popcount((unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(block, wanted)));
+    }
+#endif
+    return count + countBytes(column + i, size - i, value); // the tail
+}
+
+// states are 0 or 1, so xor with 1 flips them, free slots are masked out
+void PayloadStore::flipStates(){
+    unsigned char *column = m_states.data();
+    int size = (int)m_states.size();
+    int i = 0;
+#if defined(__AVX2__)
+    __m256i freeSlot = _mm256_set1_epi8((char)FREE_SLOT);
+    __m256i one = _mm256_set1_epi8(1);
+    for (; i + 32 <= size; i += 32) {
+        __m256i block = _mm256_loadu_si256((const __m256i*)(column + i));
+        __m256i flip = _mm256_andnot_si256(_mm256_cmpeq_epi8(block, freeSlot), one);
+        _mm256_storeu_si256((__m256i*)(column + i), _mm256_xor_si256(block, flip));
+    }
+#elif defined(__SSE2__)
+    __m128i freeSlot = _mm_set1_epi8((char)FREE_SLOT);
+    __m128i one = _mm_set1_epi8(1);
+    for (; i + 16 <= size; i += 16) {
+        __m128i block = _mm_loadu_si128((const __m128i*)(column + i));
+        __m128i flip = _mm_andnot_si128(_mm_cmpeq_epi8(block, freeSlot), one);
+        _mm_storeu_si128((__m128i*)(column + i), _mm_xor_si128(block, flip));
+    }
+#endif
+    for (; i < size; i++) {
+        if (column[i] != FREE_SLOT) {
+            column[i] ^= 1;
+        }
+    }
+}
@@ -0,0 +1,40 @@
+#ifndef PAYLOADSTORE_H
+#define PAYLOADSTORE_H
+#include <vector>
+using namespace std;
+#define FREE_SLOT 0xFF // color and state of a slot that holds no drone
+// structure of arrays for the drone payloads of one Show, every tree node
+// keeps the index (slot) of its entry, freed slots are reused by the next add
+class PayloadStore{
+public:
+    PayloadStore();
+    int add(int id, int color, int state);//returns the slot
+    void release(int slot);
+    void clear();
+    void swap(PayloadStore & rhs);
+    int size() const {return (int)m_ids.size() - (int)m_free.size();}//drones stored
+    int slots() const {return (int)m_ids.size();}
+    int getID(int slot) const {return m_ids[slot];}
+    int getColor(int slot) const {return m_colors[slot];}
+    int getState(int slot) const {return m_states[slot];}
+    void setColor(int slot, int color) {m_colors[slot] = (unsigned char)color;}
+    void setState(int slot, int state) {m_states[slot] = (unsigned char)state;}
+    const unsigned char* colors() const {return m_colors.data();}
+    const unsigned char* states() const {return m_states.data();}
+
+    // bulk kernels over the columns, AVX2 or SSE2 when the compiler targets them; Show keeps
+    // its own counters for countDrones, these count the slots as stored, which skips free
+    // slots and the slots of dead nodes, and is exact once no range value is pending
+    int countColor(int color) const;
+    int countState(int state) const;
+    void flipStates();//LIGHTON <-> LIGHTOFF for every stored drone
+    static int countBytes(const unsigned char* column, int size, unsigned char value);//scalar version
+    static int countBytesSIMD(const unsigned char* column, int size, unsigned char value);
+
+private:
+    vector<int> m_ids;
+    vector<unsigned char> m_colors;
+    vector<unsigned char> m_states;
+    vector<int> m_free;//released slots
+};
+#endif
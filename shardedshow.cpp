@@ -0,0 +1,143 @@
+#include "shardedshow.h"
+
+ShardedShow::ShardedShow(int shards, int threads)
+        : m_shards(shards < 1 ? 1 : shards), m_pool(threads < 1 ? 0 : threads) {
+    m_width = (MAXID - MINID) / (int)m_shards.size() + 1;
+}
+
+void ShardedShow::insert(const Drone& aDrone){
+    if (MINID <= aDrone.getID() && aDrone.getID() <= MAXID) {
+        m_shards[shardOf(aDrone.getID())].insert(aDrone);
+    }
+}
+
+void ShardedShow::insertAll(const vector<Drone> & drones){
+    vector<vector<const Drone*> > routed(m_shards.size());
+    for (int i = 0; i < (int)drones.size(); i++) {
+        if (MINID <= drones[i].getID() && drones[i].getID() <= MAXID) {
+            routed[shardOf(drones[i].getID())].push_back(&drones[i]);
+        }
+    }
+    m_pool.parallelFor((int)m_shards.size(), [this, &routed](int shard) {
+        for (int i = 0; i < (int)routed[shard].size(); i++) {
+            m_shards[shard].insert(*routed[shard][i]);
+        }
+    });
+}
+
+void ShardedShow::remove(int id){
+    if (MINID <= id && id <= MAXID) {
+        m_shards[shardOf(id)].remove(id);
+    }
+}
+
+bool ShardedShow::findDrone(int id) const{
+    if (MINID <= id && id <= MAXID) {
+        return m_shards[shardOf(id)].findDrone(id);
+    }
+    return false;
+}
+
+bool ShardedShow::setState(int id, STATE state){
+    if (MINID <= id && id <= MAXID) {
+        return m_shards[shardOf(id)].setState(id, state);
+    }
+    return false;
+}
+
+bool ShardedShow::setColor(int id, LIGHTCOLOR color){
+    if (MINID <= id && id <= MAXID) {
+        return m_shards[shardOf(id)].setColor(id, color);
+    }
+    return false;
+}
+
+void ShardedShow::setStateRange(int lo, int hi, STATE state){
+    if (lo < MINID) lo = MINID;
+    if (hi > MAXID) hi = MAXID;
+    if (lo > hi) {
+        return;
+    }
+    int first = shardOf(lo);
+    m_pool.parallelFor(shardOf(hi) - first + 1, [this, first, lo, hi, state](int i) {
+        m_shards[first + i].setStateRange(lo, hi, state); // each shard only holds its own IDs
+    });
+}
+
+void ShardedShow::setColorRange(int lo, int hi, LIGHTCOLOR color){
+    if (lo < MINID) lo = MINID;
+    if (hi > MAXID) hi = MAXID;
+    if (lo > hi) {
+        return;
+    }
+    int first = shardOf(lo);
+    m_pool.parallelFor(shardOf(hi) - first + 1, [this, first, lo, hi, color](int i) {
+        m_shards[first + i].setColorRange(lo, hi, color);
+    });
+}
+
+void ShardedShow::removeLightOff(){
+    m_pool.parallelFor((int)m_shards.size(), [this](int shard) {
+        m_shards[shard].removeLightOff();
+    });
+}
+
+void ShardedShow::flipStates(){
+    m_pool.parallelFor((int)m_shards.size(), [this](int shard) {
+        m_shards[shard].flipStates();
+    });
+}
+
+void ShardedShow::clear(){
+    m_pool.parallelFor((int)m_shards.size(), [this](int shard) {
+        m_shards[shard].clear();
+    });
+}
+
+int ShardedShow::countDrones(LIGHTCOLOR aColor) const{
+    int count = 0;
+    for (int i = 0; i < (int)m_shards.size(); i++) {
+        count += m_shards[i].countDrones(aColor);
+    }
+    return count;
+}
+
+int ShardedShow::countDrones(STATE aState) const{
+    int count = 0;
+    for (int i = 0; i < (int)m_shards.size(); i++) {
+        count += m_shards[i].countDrones(aState);
+    }
+    return count;
+}
+
+int ShardedShow::size() const{
+    return countDrones(LIGHTON) + countDrones(LIGHTOFF);
+}
+
+vector<int> ShardedShow::getDrones(LIGHTCOLOR aColor) const{ // shards hold ascending ID ranges, so appending keeps the order
+    vector<int> ids;
+    for (int i = 0; i < (int)m_shards.size(); i++) {
+        vector<int> part = m_shards[i].getDrones(aColor);
+        ids.insert(ids.end(), part.begin(), part.end());
+    }
+    return ids;
+}
+
+vector<int> ShardedShow::getDrones(STATE aState) const{
+    vector<int> ids;
+    for (int i = 0; i < (int)m_shards.size(); i++) {
+        vector<int> part = m_shards[i].getDrones(aState);
+        ids.insert(ids.end(), part.begin(), part.end());
+    }
+    return ids;
+}
+
+void ShardedShow::listDrones() const{
+    for (int i = 0; i < (int)m_shards.size(); i++) {
+        m_shards[i].listDrones();
+    }
+}
+
+int ShardedShow::shardOf(int id) const{
+    return (id - MINID) / m_width;
+}
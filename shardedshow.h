@@ -0,0 +1,38 @@
+#ifndef SHARDEDSHOW_H
+#define SHARDEDSHOW_H
+#include "show.h"
+#include "threadpool.h"
+// splits MINID..MAXID into equal ID ranges, each one kept by its own Show, single drone
+// calls go to the shard that owns the ID and bulk calls run on all shards in parallel
+class ShardedShow{
+public:
+    friend class Tester;
+    ShardedShow(int shards, int threads);
+    void insert(const Drone& aDrone);
+    void insertAll(const vector<Drone> & drones);//routes every drone, then the shards insert in parallel
+    void remove(int id);
+    bool findDrone(int id) const;
+    bool setState(int id, STATE state);
+    bool setColor(int id, LIGHTCOLOR color);
+    void setStateRange(int lo, int hi, STATE state);
+    void setColorRange(int lo, int hi, LIGHTCOLOR color);
+    void removeLightOff();
+    void flipStates();
+    void clear();
+    int countDrones(LIGHTCOLOR aColor) const;
+    int countDrones(STATE aState) const;
+    int size() const;
+    vector<int> getDrones(LIGHTCOLOR aColor) const;//IDs in ascending order across all shards
+    vector<int> getDrones(STATE aState) const;
+    void listDrones() const;
+    int shardCount() const {return (int)m_shards.size();}
+    int threadCount() const {return m_pool.size();}
+
+private:
+    vector<Show> m_shards;
+    int m_width;//IDs per shard
+    ThreadPool m_pool;
+
+    int shardOf(int id) const;
+};
+#endif
@@ -0,0 +1,413 @@
+#include "sharedshow.h"
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <new>
+#include <thread>
+
+SharedShow::SharedShow(const string & name, bool owner){
+    m_name = (!name.empty() && name[0] == '/') ? name : "/" + name; // shm_open wants one leading slash
+    m_owner = owner;
+    m_header = nullptr;
+    m_nodes = nullptr;
+    m_bytes = sizeof(Header) + (long long)SHARED_CAPACITY * sizeof(Node);
+    m_retries = 0;
+
+    if (owner) { // a fresh object, truncating one a reader still maps would make its reads fault
+        shm_unlink(m_name.c_str());
+    }
+    int file = owner ? shm_open(m_name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644)
+                     : shm_open(m_name.c_str(), O_RDONLY, 0);
+    if (file == -1) {
+        return;
+    }
+    struct stat info;
+    if ((owner && ftruncate(file, m_bytes) != 0) || fstat(file, &info) != 0 || info.st_size < m_bytes) {
+        close(file);
+        return;
+    }
+    void *region = mmap(nullptr, m_bytes, owner ? PROT_READ | PROT_WRITE : PROT_READ, MAP_SHARED, file, 0);
+    close(file); // the mapping keeps the object alive
+    if (region == MAP_FAILED) {
+        return;
+    }
+    m_header = static_cast<Header*>(region);
+    m_nodes = reinterpret_cast<Node*>(static_cast<char*>(region) + sizeof(Header));
+
+    if (owner) {
+        new (m_header) Header();
+        m_header->sequence.store(0);
+        m_header->root = NO_NODE;
+        m_header->freeList = NO_NODE;
+        m_header->used = 0;
+        for (int i = 0; i < NUMCOLORS; i++) {
+            m_header->colorCount[i] = 0;
+        }
+        for (int i = 0; i < NUMSTATES; i++) {
+            m_header->stateCount[i] = 0;
+        }
+        m_header->magic = SHARED_MAGIC;
+    }
+    else if (m_header->magic != SHARED_MAGIC) { // not a show, or the owner is still setting it up
+        munmap(region, m_bytes);
+        m_header = nullptr;
+        m_nodes = nullptr;
+    }
+}
+
+SharedShow::~SharedShow(){
+    if (m_header != nullptr) {
+        munmap(m_header, m_bytes);
+        if (m_owner) {
+            shm_unlink(m_name.c_str()); // readers that still have it mapped keep their copy
+        }
+    }
+}
+
+void SharedShow::insert(const Drone& aDrone){
+    int id = aDrone.getID();
+    if (!m_owner || m_header == nullptr || id < MINID || id > MAXID || findNode(id) != NO_NODE) {
+        return;
+    }
+    beginWrite();
+    int node = newNode(aDrone);
+    m_header->root = insertHelper(m_header->root, node);
+    m_header->colorCount[aDrone.getType()]++;
+    m_header->stateCount[aDrone.getState()]++;
+    endWrite();
+}
+
+void SharedShow::remove(int id){
+    if (!m_owner || m_header == nullptr || findNode(id) == NO_NODE) {
+        return;
+    }
+    beginWrite();
+    m_header->root = removeHelper(m_header->root, id);
+    endWrite();
+}
+
+bool SharedShow::setState(int id, STATE state){
+    int node = (m_owner && m_header != nullptr) ? findNode(id) : NO_NODE;
+    if (node == NO_NODE) {
+        return false;
+    }
+    beginWrite();
+    m_header->stateCount[m_nodes[node].state]--;
+    m_header->stateCount[state]++;
+    m_nodes[node].state = state;
+    endWrite();
+    return true;
+}
+
+bool SharedShow::setColor(int id, LIGHTCOLOR color){
+    int node = (m_owner && m_header != nullptr) ? findNode(id) : NO_NODE;
+    if (node == NO_NODE) {
+        return false;
+    }
+    beginWrite();
+    m_header->colorCount[m_nodes[node].type]--;
+    m_header->colorCount[color]++;
+    m_nodes[node].type = color;
+    endWrite();
+    return true;
+}
+
+void SharedShow::removeLightOff(){ // one write section, a reader sees all of them gone or none
+    if (!m_owner || m_header == nullptr || m_header->stateCount[LIGHTOFF] == 0) {
+        return;
+    }
+    vector<DroneChange> drones;
+    collect(drones);
+    beginWrite();
+    for (int i = 0; i < (int)drones.size(); i++) {
+        if (drones[i].state == LIGHTOFF) {
+            m_header->root = removeHelper(m_header->root, drones[i].id);
+        }
+    }
+    endWrite();
+}
+
+void SharedShow::clear(){
+    if (!m_owner || m_header == nullptr) {
+        return;
+    }
+    beginWrite();
+    m_header->root = NO_NODE;
+    m_header->freeList = NO_NODE;
+    m_header->used = 0;
+    for (int i = 0; i < NUMCOLORS; i++) {
+        m_header->colorCount[i] = 0;
+    }
+    for (int i = 0; i < NUMSTATES; i++) {
+        m_header->stateCount[i] = 0;
+    }
+    endWrite();
+}
+
+bool SharedShow::findDrone(int id) const{
+    if (m_header == nullptr) {
+        return false;
+    }
+    unsigned long long begin;
+    bool found;
+    do {
+        begin = beginRead();
+        found = findNode(id) != NO_NODE;
+    } while (!endRead(begin));
+    return found;
+}
+
+int SharedShow::countDrones(LIGHTCOLOR aColor) const{
+    if (m_header == nullptr) {
+        return 0;
+    }
+    unsigned long long begin;
+    int count;
+    do {
+        begin = beginRead();
+        count = readInt(m_header->colorCount[aColor]);
+    } while (!endRead(begin));
+    return count;
+}
+
+int SharedShow::countDrones(STATE aState) const{
+    if (m_header == nullptr) {
+        return 0;
+    }
+    unsigned long long begin;
+    int count;
+    do {
+        begin = beginRead();
+        count = readInt(m_header->stateCount[aState]);
+    } while (!endRead(begin));
+    return count;
+}
+
+vector<DroneChange> SharedShow::getDrones() const{
+    vector<DroneChange> drones;
+    if (m_header == nullptr) {
+        return drones;
+    }
+    unsigned long long begin;
+    do {
+        begin = beginRead();
+        collect(drones);
+    } while (!endRead(begin));
+    return drones;
+}
+
+void SharedShow::listDrones() const{ // print in order from low to high, like Show::listDrones
+    vector<DroneChange> drones = getDrones();
+    for (int i = 0; i < (int)drones.size(); i++) {
+        Drone shown(drones[i].id, drones[i].type, drones[i].state);
+        cout << shown.getID() << ":" << shown.getStateStr() << ":" << shown.getTypeStr() << endl;
+    }
+}
+
+unsigned long long SharedShow::version() const{
+    return m_header == nullptr ? 0 : m_header->sequence.load(memory_order_acquire) / 2;
+}
+
+void SharedShow::beginWrite(){ // odd sequence, readers that started before will retry
+    unsigned long long sequence = m_header->sequence.load(memory_order_relaxed);
+    m_header->sequence.store(sequence + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+}
+
+void SharedShow::endWrite(){
+    unsigned long long sequence = m_header->sequence.load(memory_order_relaxed);
+    m_header->sequence.store(sequence + 1, memory_order_release);
+}
+
+unsigned long long SharedShow::beginRead() const{ // waits out a write in progress
+    unsigned long long sequence = m_header->sequence.load(memory_order_acquire);
+    while (sequence & 1) {
+        std::this_thread::yield();
+        sequence = m_header->sequence.load(memory_order_acquire);
+    }
+    return sequence;
+}
+
+bool SharedShow::endRead(unsigned long long begin) const{ // true if nothing changed while reading
+    atomic_thread_fence(memory_order_acquire);
+    if (m_header->sequence.load(memory_order_relaxed) == begin) {
+        return true;
+    }
+    m_retries++;
+    return false;
+}
+
+int SharedShow::readInt(const int & field) const{ // the owner may be writing it right now
+    return __atomic_load_n(&field, __ATOMIC_RELAXED);
+}
+
+// a reader can see links in the middle of a change, so every link is checked before it
+// is followed and the walk gives up past MAX_DEPTH, the sequence check throws the result away
+int SharedShow::findNode(int id) const{
+    int node = readInt(m_header->root);
+    for (int depth = 0; node != NO_NODE && depth < MAX_DEPTH; depth++) {
+        if (node < 0 || node >= SHARED_CAPACITY) {
+            return NO_NODE;
+        }
+        int nodeId = readInt(m_nodes[node].id);
+        if (id == nodeId) {
+            return node;
+        }
+        node = (id < nodeId) ? readInt(m_nodes[node].left) : readInt(m_nodes[node].right);
+    }
+    return NO_NODE;
+}
+
+void SharedShow::collect(vector<DroneChange> & drones) const{ // in-order walk with its own stack
+    drones.clear();
+    int stack[MAX_DEPTH];
+    int depth = 0;
+    int node = readInt(m_header->root);
+    while (node != NO_NODE || depth > 0) {
+        while (node != NO_NODE) {
+            if (node < 0 || node >= SHARED_CAPACITY || depth == MAX_DEPTH) {
+                return;
+            }
+            stack[depth++] = node;
+            node = readInt(m_nodes[node].left);
+        }
+        node = stack[--depth];
+        if ((int)drones.size() == SHARED_CAPACITY) { // a cycle through a recycled node
+            return;
+        }
+        DroneChange drone;
+        drone.id = readInt(m_nodes[node].id);
+        drone.type = static_cast<LIGHTCOLOR>(readInt(m_nodes[node].type));
+        drone.state = static_cast<STATE>(readInt(m_nodes[node].state));
+        drones.push_back(drone);
+        node = readInt(m_nodes[node].right);
+    }
+}
+
+int SharedShow::newNode(const Drone& aDrone){
+    int node = m_header->freeList;
+    if (node != NO_NODE) {
+        m_header->freeList = m_nodes[node].left;
+    }
+    else {
+        node = m_header->used++;
+    }
+    m_nodes[node].id = aDrone.getID();
+    m_nodes[node].left = NO_NODE;
+    m_nodes[node].right = NO_NODE;
+    m_nodes[node].height = 0;
+    m_nodes[node].type = aDrone.getType();
+    m_nodes[node].state = aDrone.getState();
+    return node;
+}
+
+void SharedShow::freeNode(int node){
+    m_nodes[node].left = m_header->freeList;
+    m_header->freeList = node;
+}
+
+int SharedShow::insertHelper(int node, int added){
+    if (node == NO_NODE) {
+        return added;
+    }
+    if (m_nodes[added].id < m_nodes[node].id) {
+        m_nodes[node].left = insertHelper(m_nodes[node].left, added);
+    }
+    else {
+        m_nodes[node].right = insertHelper(m_nodes[node].right, added);
+    }
+    fixHeight(node);
+    return rebalance(node);
+}
+
+int SharedShow::removeHelper(int node, int id){
+    if (node == NO_NODE) {
+        return node;
+    }
+    Node &curr = m_nodes[node];
+    if (id < curr.id) {
+        curr.left = removeHelper(curr.left, id);
+    }
+    else if (id > curr.id) {
+        curr.right = removeHelper(curr.right, id);
+    }
+    else {
+        m_header->colorCount[curr.type]--;
+        m_header->stateCount[curr.state]--;
+        int replacement;
+        if (curr.left == NO_NODE || curr.right == NO_NODE) {
+            replacement = (curr.left == NO_NODE) ? curr.right : curr.left;
+        }
+        else { // the successor takes curr's place, no payload is moved between nodes
+            int right = detachMin(curr.right, replacement);
+            m_nodes[replacement].left = curr.left;
+            m_nodes[replacement].right = right;
+        }
+        freeNode(node);
+        if (replacement == NO_NODE) {
+            return replacement;
+        }
+        fixHeight(replacement);
+        return rebalance(replacement);
+    }
+    fixHeight(node);
+    return rebalance(node);
+}
+
+int SharedShow::detachMin(int node, int & minNode){
+    if (m_nodes[node].left == NO_NODE) {
+        minNode = node;
+        return m_nodes[node].right;
+    }
+    m_nodes[node].left = detachMin(m_nodes[node].left, minNode);
+    fixHeight(node);
+    return rebalance(node);
+}
+
+int SharedShow::rebalance(int node){
+    int balance = heightOf(m_nodes[node].left) - heightOf(m_nodes[node].right);
+    if (balance > 1) {
+        int left = m_nodes[node].left;
+        if (heightOf(m_nodes[left].left) < heightOf(m_nodes[left].right)) {
+            m_nodes[node].left = rotateLeft(left);
+        }
+        return rotateRight(node);
+    }
+    if (balance < -1) {
+        int right = m_nodes[node].right;
+        if (heightOf(m_nodes[right].right) < heightOf(m_nodes[right].left)) {
+            m_nodes[node].right = rotateRight(right);
+        }
+        return rotateLeft(node);
+    }
+    return node;
+}
+
+int SharedShow::rotateRight(int node){
+    int left = m_nodes[node].left;
+    m_nodes[node].left = m_nodes[left].right;
+    m_nodes[left].right = node;
+    fixHeight(node);
+    fixHeight(left);
+    return left;
+}
+
+int SharedShow::rotateLeft(int node){
+    int right = m_nodes[node].right;
+    m_nodes[node].right = m_nodes[right].left;
+    m_nodes[right].left = node;
+    fixHeight(node);
+    fixHeight(right);
+    return right;
+}
+
+int SharedShow::heightOf(int node) const{
+    return node == NO_NODE ? -1 : m_nodes[node].height;
+}
+
+void SharedShow::fixHeight(int node){
+    int left = heightOf(m_nodes[node].left);
+    int right = heightOf(m_nodes[node].right);
+    m_nodes[node].height = (left > right ? left : right) + 1;
+}
@@ -0,0 +1,84 @@
+#ifndef SHAREDSHOW_H
+#define SHAREDSHOW_H
+#include "show.h"
+#include <atomic>
+#include <string>
+using namespace std;
+#define SHARED_MAGIC 0x44524F4E // "DRON", the region was set up by a SharedShow
+#define SHARED_CAPACITY (MAXID - MINID + 1) // one node for every possible ID
+#define NO_NODE -1 // null link
+// an AVL tree of drones that lives in a POSIX shared memory object, links are node
+// numbers instead of pointers so every process can map it at its own address; the
+// owner changes it, other processes attach read-only and read it without copying,
+// a sequence counter (seqlock) tells a reader to retry if the owner changed it meanwhile
+class SharedShow{
+public:
+    friend class Tester;
+    SharedShow(const string & name, bool owner = true);//owner creates name, others attach read-only
+    ~SharedShow();//the owner also removes name
+    SharedShow(const SharedShow & rhs) = delete;
+    const SharedShow & operator=(const SharedShow & rhs) = delete;
+    bool isOpen() const {return m_header != nullptr;}
+    bool isOwner() const {return m_owner;}
+
+    // owner only, each call is one write section for the readers
+    void insert(const Drone& aDrone);
+    void remove(int id);
+    bool setState(int id, STATE state);
+    bool setColor(int id, LIGHTCOLOR color);
+    void removeLightOff();
+    void clear();
+
+    // any process
+    bool findDrone(int id) const;
+    int countDrones(LIGHTCOLOR aColor) const;
+    int countDrones(STATE aState) const;
+    vector<DroneChange> getDrones() const;//every drone in ascending ID order
+    void listDrones() const;
+    unsigned long long version() const;//goes up with every change
+    long long getRetries() const {return m_retries;}//reads this process had to repeat
+
+private:
+    struct Node{
+        int id;
+        int left;
+        int right;
+        int height;
+        int type;
+        int state;
+    };
+    struct Header{
+        unsigned magic;
+        atomic<unsigned long long> sequence;//odd while the owner is changing the tree
+        int root;
+        int freeList;//unused nodes linked through left
+        int used;//nodes handed out at least once, the rest are above it
+        int colorCount[NUMCOLORS];
+        int stateCount[NUMSTATES];
+    };
+    string m_name;
+    bool m_owner;
+    Header* m_header;//start of the mapped region
+    Node* m_nodes;//right after the header
+    long long m_bytes;
+    mutable long long m_retries;
+
+    void beginWrite();
+    void endWrite();
+    unsigned long long beginRead() const;
+    bool endRead(unsigned long long begin) const;
+    int readInt(const int & field) const;
+    int findNode(int id) const;//one read attempt, NO_NODE if absent
+    void collect(vector<DroneChange> & drones) const;//one read attempt, stops early if it looks torn
+    int newNode(const Drone& aDrone);
+    void freeNode(int node);
+    int insertHelper(int node, int added);
+    int removeHelper(int node, int id);
+    int detachMin(int node, int & minNode);
+    int rebalance(int node);
+    int rotateRight(int node);
+    int rotateLeft(int node);
+    int heightOf(int node) const;
+    void fixHeight(int node);
+};
+#endif
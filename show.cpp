@@ -1,6 +1,70 @@
 #include "show.h"
+#include <algorithm>
 Show::Show(){
     m_root = nullptr;
+    m_index = nullptr;
+    m_pending = false;
+    m_frozen = false;
+    m_finger.depth = 0;
+    m_fingerOn = true;
+    m_deadFraction = 0;
+    m_deadCount = 0;
+    m_violations = 0;
+    m_hotHits = 0;
+    m_hotMisses = 0;
+    m_ranges = 0;
+    m_hot = nullptr;
+    indexClear();
+}
+
+Show::Show(const Show & rhs){
+    m_root = helpCopy(rhs.m_root); // the copied nodes keep their slots
+    m_index = nullptr;
+    m_store = rhs.m_store;
+    m_pending = rhs.m_pending;
+    m_frozen = false; // the copy starts out mutable
+    m_finger.depth = 0;
+    m_fingerOn = rhs.m_fingerOn;
+    m_deadFraction = rhs.m_deadFraction;
+    m_deadCount = rhs.m_deadCount; // the dead nodes are copied too
+    m_violations = 0;
+    m_hotHits = 0;
+    m_hotMisses = 0;
+    m_ranges = 0;
+    m_hot = nullptr; // rhs's entries point at rhs's nodes
+    indexCopy(rhs);
+    m_grid.setCellSize(rhs.m_grid.getCellSize());
+    gridFill(m_root);
+}
+
+Show::Show(Show && rhs) noexcept{ // steals the tree, rhs is left empty
+    m_root = rhs.m_root;
+    rhs.m_root = nullptr;
+    m_index = rhs.m_index;
+    rhs.m_index = nullptr;
+    for (int i = 0; i < NUMCOLORS; i++) m_colorCount[i] = rhs.m_colorCount[i];
+    for (int i = 0; i < NUMSTATES; i++) m_stateCount[i] = rhs.m_stateCount[i];
+    rhs.indexClear();
+    m_grid.swap(rhs.m_grid);
+    m_store.swap(rhs.m_store);
+    m_pending = rhs.m_pending;
+    rhs.m_pending = false;
+    m_frozen = rhs.m_frozen; // the frozen arrays point at the nodes that just moved here
+    rhs.m_frozen = false;
+    m_frozenIds.swap(rhs.m_frozenIds);
+    m_frozenNodes.swap(rhs.m_frozenNodes);
+    m_finger.depth = 0;
+    rhs.m_finger.depth = 0;
+    m_fingerOn = rhs.m_fingerOn;
+    m_deadFraction = rhs.m_deadFraction;
+    m_deadCount = rhs.m_deadCount;
+    rhs.m_deadCount = 0;
+    m_violations = 0;
+    m_hotHits = 0;
+    m_hotMisses = 0;
+    m_hot = rhs.m_hot; // the entries point at the nodes that just moved here
+    rhs.m_hot = nullptr;
+    m_ranges = rhs.m_ranges;
 }
 
 Show::~Show(){
@@ -8,24 +72,65 @@ Show::~Show(){
         clear();
     }
     m_root = nullptr;
+    delete [] m_index;
+    delete [] m_hot;
 }
 
 void Show::insert(const Drone& aDrone){
 
-    if (!findDrone(aDrone.m_id)) { // no duplicates
-        if (MINID <= aDrone.m_id && aDrone.m_id <= MAXID) { // ID within range
-                    m_root = insertHelper(aDrone, m_root);
-            }
+    if (inRange(aDrone.m_id)) { // ID within range, linkDrone drops duplicates
+        linkDrone(createDrone(aDrone, m_root));
+    }
+}
+
+void Show::insert(Drone&& aDrone){
+
+    if (inRange(aDrone.m_id)) { // ID within range, linkDrone drops duplicates
+        Drone *newDrone = new Drone(aDrone.m_id, aDrone.m_payload.type, aDrone.m_payload.state);
+        newDrone->setPosition(aDrone.m_x, aDrone.m_y, aDrone.m_z);
+        linkDrone(newDrone);
+    }
+}
+
+void Show::emplace(int id, LIGHTCOLOR type, STATE state){
+
+    if (inRange(id)) { // ID within range, linkDrone drops duplicates
+        linkDrone(new Drone(id, type, state));
     }
 }
 
 void Show::clear(){
+    thaw();
     helpClear(m_root);
+    m_root = nullptr;
+    m_finger.depth = 0;
+    m_deadCount = 0;
+    hotClear();
+    indexClear();
+    m_grid.clear();
+    m_store.clear();
+    m_pending = false;
 }
 
 void Show::remove(int id){ // need to do this
+    if (m_deadFraction > 0) { // deferred, no rotations now
+        thaw();
+        Drone *target = fingerFind(id);
+        if (target != nullptr && !target->m_dead) {
+            buryDrone(target);
+            if (m_deadCount > m_deadFraction * m_store.size()) {
+                compact();
+            }
+        }
+        return;
+    }
     if (findDrone(id)) { // finds ID to remove
-        m_root = removeHelper(m_root, id);
+        thaw();
+        m_finger.depth = 0;
+        hotForget(id); // its node is deleted
+        Drone *removed = nullptr;
+        m_root = removeHelper(m_root, id, removed);
+        dropDrone(removed);
     }
 }
 
@@ -48,23 +153,133 @@ void Show::listDrones() const { // print in order from low to high
 }
 
 bool Show::setState(int id, STATE state){
-    Drone *target = findHelper(id, m_root);
+    Drone *target = hotFind(id, true);
+    if (target == nullptr) { // the finger walk pushes every pending value off the path
+        target = m_frozen ? frozenFind(id) : fingerFind(id);
+        hotStore(id, target, true);
+    }
 
-    if (target != nullptr) {
-        target->m_state = state;
+    if (target != nullptr && !target->m_dead) {
+        indexRemove(id, typeOf(target), stateOf(target));
+        writeState(target, state);
+        indexAdd(id, typeOf(target), state);
         return true;
     }
     return false;
 }
 
-void Show::removeLightOff(){
-    if(m_root != nullptr) {
-        helpLightOff(m_root);
+bool Show::setColor(int id, LIGHTCOLOR color){
+    Drone *target = hotFind(id, true);
+    if (target == nullptr) { // the finger walk pushes every pending value off the path
+        target = m_frozen ? frozenFind(id) : fingerFind(id);
+        hotStore(id, target, true);
+    }
+
+    if (target != nullptr && !target->m_dead) {
+        indexRemove(id, typeOf(target), stateOf(target));
+        writeColor(target, color);
+        indexAdd(id, color, stateOf(target));
+        return true;
+    }
+    return false;
+}
+
+void Show::setStateRange(int lo, int hi, STATE state){
+    if (lo <= hi) {
+        m_finger.depth = 0; // the finger's ancestors may get pending values it wouldn't push
+        rangeHelper(m_root, lo, hi, MINID, MAXID, state, NO_TAG);
+        indexMoveRange(lo, hi, NUMCOLORS + state, NUMCOLORS, NUMCOLORS + NUMSTATES);
+    }
+}
+
+void Show::setColorRange(int lo, int hi, LIGHTCOLOR color){
+    if (lo <= hi) {
+        m_finger.depth = 0;
+        rangeHelper(m_root, lo, hi, MINID, MAXID, NO_TAG, color);
+        indexMoveRange(lo, hi, color, 0, NUMCOLORS);
+    }
+}
+
+void Show::removeLightOff(){ // the state index already knows every LIGHTOFF drone
+    vector<int> off = getDrones(LIGHTOFF);
+    if (m_deadFraction > 0 && !off.empty()) { // ascending IDs, each one found from the finger
+        thaw();
+        for (int i = 0; i < (int)off.size(); i++) {
+            buryDrone(fingerFind(off[i]));
+        }
+        if (m_deadCount > m_deadFraction * m_store.size()) {
+            compact();
+        }
+        return;
+    }
+    if (!off.empty()) {
+        thaw();
+        m_finger.depth = 0;
+    }
+    for (int i = 0; i < (int)off.size(); i++) {
+        hotForget(off[i]);
+        Drone *removed = nullptr;
+        m_root = removeHelper(m_root, off[i], removed);
+        dropDrone(removed);
     }
 }
 
 bool Show::findDrone(int id) const {
-    return findHelper(id, m_root) != nullptr;
+    Drone *found = hotFind(id);
+    if (found != nullptr) {
+        return !found->m_dead;
+    }
+    if (m_frozen) { // frozen shows have no dead nodes, so the node itself isn't read
+        found = frozenFind(id);
+        hotStore(id, found, true);
+        return found != nullptr;
+    }
+    found = findHelper(id, m_root); // doesn't push, so the payload is only exact with nothing pending
+    hotStore(id, found, !m_pending);
+    return found != nullptr && !found->m_dead;
+}
+
+// runs LOOKUP_GROUP searches in lock step, each round moves every search one level down
+// and prefetches the node it needs next, so the cache misses of the group overlap
+void Show::findDrones(const int ids[], int count, bool found[]) const {
+    if (m_frozen) { // the frozen search already prefetches
+        for (int i = 0; i < count; i++) {
+            found[i] = frozenFind(ids[i]) != nullptr;
+        }
+        return;
+    }
+    for (int first = 0; first < count; first += LOOKUP_GROUP) {
+        int size = (count - first < LOOKUP_GROUP) ? count - first : LOOKUP_GROUP;
+        Drone *curr[LOOKUP_GROUP];
+        for (int i = 0; i < size; i++) {
+            curr[i] = m_root;
+            found[first + i] = false;
+        }
+        int active = (m_root != nullptr) ? size : 0;
+
+        while (active > 0) {
+            active = 0;
+            for (int i = 0; i < size; i++) {
+                Drone *node = curr[i];
+                if (node == nullptr) {
+                    continue;
+                }
+                int id = ids[first + i];
+                if (node->m_id == id) {
+                    found[first + i] = !node->m_dead;
+                    curr[i] = nullptr;
+                }
+                else {
+                    node = (id < node->m_id) ? node->m_left : node->m_right;
+                    if (node != nullptr) {
+                        __builtin_prefetch(node);
+                        active++;
+                    }
+                    curr[i] = node;
+                }
+            }
+        }
+    }
 }
 
 const Show & Show::operator=(const Show & rhs){
@@ -72,348 +287,1136 @@ const Show & Show::operator=(const Show & rhs){
     if (&rhs != this) {
         clear();
         m_root = helpCopy(rhs.m_root);
+        m_store = rhs.m_store;
+        m_pending = rhs.m_pending;
+        m_deadFraction = rhs.m_deadFraction;
+        m_deadCount = rhs.m_deadCount;
+        indexCopy(rhs);
+        m_grid.setCellSize(rhs.m_grid.getCellSize());
+        gridFill(m_root);
     }
     return *this;
 }
 
-int Show::countDrones(LIGHTCOLOR aColor) const{
-    return helpCount(m_root, aColor);
+Show & Show::operator=(Show && rhs) noexcept{
+
+    if (&rhs != this) {
+        clear();
+        m_root = rhs.m_root; // takes over rhs nodes, no copying
+        rhs.m_root = nullptr;
+        delete [] m_index;
+        m_index = rhs.m_index;
+        rhs.m_index = nullptr;
+        for (int i = 0; i < NUMCOLORS; i++) m_colorCount[i] = rhs.m_colorCount[i];
+        for (int i = 0; i < NUMSTATES; i++) m_stateCount[i] = rhs.m_stateCount[i];
+        rhs.indexClear();
+        m_grid.swap(rhs.m_grid);
+        m_store.swap(rhs.m_store);
+        m_pending = rhs.m_pending;
+        rhs.m_pending = false;
+        m_frozen = rhs.m_frozen;
+        rhs.m_frozen = false;
+        m_frozenIds.swap(rhs.m_frozenIds);
+        m_frozenNodes.swap(rhs.m_frozenNodes);
+        rhs.m_finger.depth = 0;
+        m_deadFraction = rhs.m_deadFraction;
+        m_deadCount = rhs.m_deadCount;
+        rhs.m_deadCount = 0;
+        m_hot = rhs.m_hot; // clear() freed ours
+        rhs.m_hot = nullptr;
+        m_ranges = rhs.m_ranges;
+    }
+    return *this;
 }
-// create drone helper to create drones
-Drone * Show::createDrone(const Drone &aDrone, Drone* curr) {
-    Drone *newDrone = new Drone(aDrone.m_id, aDrone.m_type, aDrone.m_state);
-    newDrone->m_right = nullptr;
-    newDrone->m_left = nullptr;
-    newDrone->m_height = 0;
-    return newDrone;
+
+void Show::swap(Show & rhs) noexcept{
+    Drone *temp = m_root;
+    m_root = rhs.m_root;
+    rhs.m_root = temp;
+    m_grid.swap(rhs.m_grid);
+    m_store.swap(rhs.m_store);
+    bool pending = m_pending;
+    m_pending = rhs.m_pending;
+    rhs.m_pending = pending;
+    bool frozen = m_frozen;
+    m_frozen = rhs.m_frozen;
+    rhs.m_frozen = frozen;
+    m_frozenIds.swap(rhs.m_frozenIds);
+    m_frozenNodes.swap(rhs.m_frozenNodes);
+    m_finger.depth = 0;
+    rhs.m_finger.depth = 0;
+    double fraction = m_deadFraction;
+    m_deadFraction = rhs.m_deadFraction;
+    rhs.m_deadFraction = fraction;
+    int dead = m_deadCount;
+    m_deadCount = rhs.m_deadCount;
+    rhs.m_deadCount = dead;
+    HotEntry *hot = m_hot; // the entries go with their nodes
+    m_hot = rhs.m_hot;
+    rhs.m_hot = hot;
+    unsigned ranges = m_ranges;
+    m_ranges = rhs.m_ranges;
+    rhs.m_ranges = ranges;
+    unsigned long long *index = m_index;
+    m_index = rhs.m_index;
+    rhs.m_index = index;
+    for (int i = 0; i < NUMCOLORS; i++) {
+        int count = m_colorCount[i];
+        m_colorCount[i] = rhs.m_colorCount[i];
+        rhs.m_colorCount[i] = count;
+    }
+    for (int i = 0; i < NUMSTATES; i++) {
+        int count = m_stateCount[i];
+        m_stateCount[i] = rhs.m_stateCount[i];
+        rhs.m_stateCount[i] = count;
+    }
 }
 
-Drone *Show::insertHelper(const Drone &aDrone, Drone *curr) {
-    if (curr == nullptr){
-       curr = createDrone(aDrone, curr); //adds node if curr == nullptr
+int Show::countDrones(LIGHTCOLOR aColor) const{ // a value cast from an int may be no color at all
+    return (0 <= aColor && aColor < NUMCOLORS) ? m_colorCount[aColor] : 0;
+}
+
+int Show::countDrones(STATE aState) const{
+    return (0 <= aState && aState < NUMSTATES) ? m_stateCount[aState] : 0;
+}
+
+vector<int> Show::getDrones(LIGHTCOLOR aColor) const{
+    return (0 <= aColor && aColor < NUMCOLORS) ? indexList(aColor) : vector<int>();
+}
+
+vector<int> Show::getDrones(STATE aState) const{
+    return (0 <= aState && aState < NUMSTATES) ? indexList(NUMCOLORS + aState) : vector<int>();
+}
+
+int Show::countDrones(const DroneQuery & query) const{
+    return runQuery(query, planQuery(query), nullptr);
+}
+
+vector<int> Show::getDrones(const DroneQuery & query) const{
+    vector<int> ids;
+    runQuery(query, planQuery(query), &ids);
+    return ids;
+}
+
+int Show::setState(const DroneQuery & query, STATE state){
+    return queryUpdate(query, NUMCOLORS + state, state);
+}
+
+int Show::setColor(const DroneQuery & query, LIGHTCOLOR color){
+    return queryUpdate(query, color, color);
+}
+
+// the index reads a word per 64 IDs for each bitmap the query needs, a walk of the range
+// visits the path down to it and the nodes in it, guessed from the share of all IDs the
+// range covers; a query over every ID only walks the tree if the index costs more
+QUERYPLAN Show::planQuery(const DroneQuery & query) const{
+    int lo = query.lo < MINID ? MINID : query.lo;
+    int hi = query.hi > MAXID ? MAXID : query.hi;
+    QUERYPLAN walk = (lo == MINID && hi == MAXID) ? PLAN_SCAN : PLAN_RANGE;
+    if (m_index == nullptr || lo > hi) {
+        return walk;
     }
-    else if (aDrone.m_id < curr->m_id) { // going left
-        if (curr->m_left != nullptr) { // keep's going recursive until it hit's nullptr and adds
-            curr->m_left = insertHelper(aDrone, curr->m_left);
-        } else {
-            curr->m_left = createDrone(aDrone, curr->m_left);
+    long long words = (hi - MINID) / 64 - (lo - MINID) / 64 + 1;
+    long long indexCost = words * ((query.color == NO_TAG ? NUMCOLORS : 1) + (query.state == NO_TAG ? 0 : 1));
+    long long height = (m_root == nullptr) ? 0 : m_root->m_height + 1;
+    long long nodes = (long long)m_store.size() * (hi - lo + 1) / (MAXID - MINID + 1); // dead nodes are walked too
+    return (indexCost <= (height + nodes) * QUERY_NODE_COST) ? PLAN_INDEX : walk;
+}
+
+bool Show::moveDrone(int id, double x, double y, double z){
+    Drone *target = findHelper(id, m_root);
+
+    if (target != nullptr && !target->m_dead) {
+        m_grid.move(target, x, y, z);
+        return true;
+    }
+    return false;
+}
+
+vector<int> Show::findNear(double x, double y, double z, double radius) const{
+    vector<Drone*> found;
+    m_grid.near(x, y, z, radius, found);
+    vector<int> ids(found.size());
+    for (int i = 0; i < (int)found.size(); i++) {
+        ids[i] = found[i]->m_id;
+    }
+    sort(ids.begin(), ids.end());
+    return ids;
+}
+
+vector<int> Show::findNearest(double x, double y, double z, int k) const{
+    vector<Drone*> found;
+    m_grid.nearest(x, y, z, k, found);
+    vector<int> ids(found.size());
+    for (int i = 0; i < (int)found.size(); i++) {
+        ids[i] = found[i]->m_id;
+    }
+    return ids;
+}
+
+vector<pair<int,int> > Show::findCollisions(double radius) const{
+    vector<pair<Drone*,Drone*> > found;
+    m_grid.collisions(radius, found);
+    vector<pair<int,int> > pairs(found.size());
+    for (int i = 0; i < (int)found.size(); i++) {
+        int first = found[i].first->m_id;
+        int second = found[i].second->m_id;
+        pairs[i] = (first < second) ? make_pair(first, second) : make_pair(second, first);
+    }
+    sort(pairs.begin(), pairs.end());
+    return pairs;
+}
+
+void Show::flipStates(){ // column kernel plus swapping the two state bitmaps
+    flushTags();
+    m_store.flipStates();
+    flipHelper(m_root);
+    if (m_index != nullptr) {
+        unsigned long long *on = indexBits(NUMCOLORS + LIGHTON);
+        unsigned long long *off = indexBits(NUMCOLORS + LIGHTOFF);
+        for (int i = 0; i < INDEX_WORDS; i++) {
+            unsigned long long temp = on[i];
+            on[i] = off[i];
+            off[i] = temp;
         }
-    } else if (aDrone.m_id > curr->m_id) {   // going right
-        if (curr->m_right != nullptr) { // keep's going recursive until it hit's nullptr and adds
-            curr->m_right = insertHelper(aDrone, curr->m_right);
+    }
+    int count = m_stateCount[LIGHTON];
+    m_stateCount[LIGHTON] = m_stateCount[LIGHTOFF];
+    m_stateCount[LIGHTOFF] = count;
+}
+
+// pending values are pushed down first, the frozen lookups write straight into the store
+void Show::freeze(){
+    if (m_frozen) {
+        return;
+    }
+    compact(); // the frozen search doesn't know about dead nodes
+    flushTags();
+    vector<Drone*> sorted;
+    sorted.reserve(m_store.size());
+    inorderNodes(m_root, sorted);
+
+    m_frozenIds.assign(sorted.size() + 1, 0);
+    m_frozenNodes.assign(sorted.size() + 1, nullptr);
+    int next = 0;
+    eytzingerFill(sorted, next, 1);
+    m_frozen = true;
+}
+
+void Show::thaw(){
+    if (m_frozen) {
+        m_frozen = false;
+        vector<int>().swap(m_frozenIds); // gives the memory back
+        vector<Drone*>().swap(m_frozenNodes);
+    }
+}
+
+void Show::setCellSize(double size){
+    if (size > 0) {
+        m_grid.setCellSize(size);
+    }
+}
+
+// walks both trees in order at the same time, like merging two sorted lists
+ChangeSet Show::diff(const Show & previous) const{
+    ChangeSet changes;
+    Walk now;
+    Walk before;
+    DroneChange curr;
+    DroneChange prev;
+    now.depth = 0;
+    before.depth = 0;
+    walkLeft(now, m_root, NO_TAG, NO_TAG);
+    walkLeft(before, previous.m_root, NO_TAG, NO_TAG);
+    bool hasCurr = walkNext(now, curr);
+    bool hasPrev = previous.walkNext(before, prev);
 
-        } else {
-            curr->m_right = createDrone(aDrone, curr->m_right);
+    while (hasCurr || hasPrev) {
+        if (!hasPrev || (hasCurr && curr.id < prev.id)) { // only in the new frame
+            changes.added.push_back(curr);
+            hasCurr = walkNext(now, curr);
+        }
+        else if (!hasCurr || prev.id < curr.id) { // only in the old frame
+            changes.removed.push_back(prev.id);
+            hasPrev = previous.walkNext(before, prev);
+        }
+        else { // in both, keep it if the light changed
+            if (curr.type != prev.type || curr.state != prev.state) {
+                changes.changed.push_back(curr);
+            }
+            hasCurr = walkNext(now, curr);
+            hasPrev = previous.walkNext(before, prev);
         }
     }
+    return changes;
+}
 
-    helpHeight(curr); // adjust height
-    curr = rebalanceHelper(curr); // rebalances
+// runs of consecutive IDs that get the same state (or color) are applied as one range update,
+// nothing else can be inside such a run so the result is the same as setting them one by one
+void Show::apply(const ChangeSet & changes){
+    for (int i = 0; i < (int)changes.removed.size(); i++) {
+        remove(changes.removed[i]);
+    }
+    for (int i = 0; i < (int)changes.added.size(); i++) {
+        emplace(changes.added[i].id, changes.added[i].type, changes.added[i].state);
+    }
 
-    return curr;
+    const vector<DroneChange> & changed = changes.changed;
+    int start = 0;
+    for (int i = 1; i <= (int)changed.size(); i++) { // state runs
+        if (i == (int)changed.size() || changed[i].id != changed[i - 1].id + 1 || changed[i].state != changed[start].state) {
+            setStateRange(changed[start].id, changed[i - 1].id, changed[start].state);
+            start = i;
+        }
+    }
+    start = 0;
+    for (int i = 1; i <= (int)changed.size(); i++) { // color runs
+        if (i == (int)changed.size() || changed[i].id != changed[i - 1].id + 1 || changed[i].type != changed[start].type) {
+            setColorRange(changed[start].id, changed[i - 1].id, changed[start].type);
+            start = i;
+        }
+    }
+}
+void Show::setDeferredRemove(double fraction){
+    m_deadFraction = fraction > 0 ? fraction : 0;
+    if (m_deadFraction == 0) {
+        compact();
+    }
 }
 
-Drone *Show::findHelper(int id, Drone *curr) const {
+// the live nodes are relinked in place, in order, so their addresses (and the grid) stay valid
+void Show::compact(){
+    if (m_deadCount == 0) {
+        return;
+    }
+    thaw();
+    flushTags(); // no node may keep a pending value for kids it is about to lose
+    m_finger.depth = 0;
+    hotClear(); // dead nodes are deleted
+    vector<Drone*> nodes;
+    nodes.reserve(m_store.size());
+    inorderNodes(m_root, nodes);
+    int live = 0;
+    for (int i = 0; i < (int)nodes.size(); i++) {
+        if (nodes[i]->m_dead) {
+            m_store.release(nodes[i]->m_slot);
+            delete nodes[i];
+        }
+        else {
+            nodes[live++] = nodes[i];
+        }
+    }
+    m_root = compactHelper(nodes, 0, live - 1);
+    m_deadCount = 0;
+}
 
-    if (curr == nullptr) {
+Drone * Show::compactHelper(const vector<Drone*> & nodes, int first, int last) {
+    if (first > last) {
         return nullptr;
     }
-    else if(curr->m_id == id) { // if ID found returns it
-        return curr;
+    int middle = first + (last - first) / 2;
+    Drone *node = nodes[middle];
+    node->m_left = compactHelper(nodes, first, middle - 1);
+    node->m_right = compactHelper(nodes, middle + 1, last);
+    fixHeight(node);
+    SHOW_CHECK(node, MINID, MAXID);
+    return node;
+}
+
+bool Show::load(const vector<DroneChange> & drones){
+    // checked up front, an ID out of range would index past the bitmaps and one out of
+    // order would build a tree that isn't a search tree
+    for (int i = 0; i < (int)drones.size(); i++) {
+        const DroneChange & drone = drones[i];
+        if (!inRange(drone.id) || (i > 0 && drone.id <= drones[i - 1].id)
+            || drone.type < 0 || drone.type >= NUMCOLORS || drone.state < 0 || drone.state >= NUMSTATES) {
+            return false;
+        }
     }
-    else if (id < curr->m_id) { // left
-        return findHelper(id, curr->m_left);
+    clear(); // also drops the finger
+    m_root = loadHelper(drones, 0, (int)drones.size() - 1);
+    return true;
+}
+// create drone helper to create drones
+Drone * Show::createDrone(const Drone &aDrone, Drone* curr) {
+    Drone *newDrone = new Drone(aDrone.m_id, aDrone.m_payload.type, aDrone.m_payload.state);
+    newDrone->m_right = nullptr;
+    newDrone->m_left = nullptr;
+    newDrone->m_height = 0;
+    newDrone->setPosition(aDrone.m_x, aDrone.m_y, aDrone.m_z);
+    return newDrone;
+}
+
+// the middle drone becomes the root of first..last, so both halves differ by at most one node
+Drone * Show::loadHelper(const vector<DroneChange> & drones, int first, int last) {
+    if (first > last) {
+        return nullptr;
+    }
+    int middle = first + (last - first) / 2;
+    const DroneChange & drone = drones[middle];
+    Drone *node = new Drone(drone.id, drone.type, drone.state);
+    node->m_slot = m_store.add(drone.id, drone.type, drone.state);
+    indexAdd(drone.id, drone.type, drone.state);
+    m_grid.add(node);
+    node->m_left = loadHelper(drones, first, middle - 1);
+    node->m_right = loadHelper(drones, middle + 1, last);
+    fixHeight(node);
+    SHOW_CHECK(node, MINID, MAXID);
+    return node;
+}
+
+// adds a new node to the tree, the store, the indexes and the grid, or deletes it if its ID is
+// taken; the slot comes after the node is linked, nothing on the finger path has a pending
+// value left by then so the new node can't be tagged before it has one
+void Show::linkDrone(Drone *aNode) {
+    if (m_frozen && frozenFind(aNode->m_id) != nullptr) { // no duplicates, and stay frozen
+        delete aNode;
+        return;
     }
-    else { // right
-        return findHelper(id, curr->m_right);
+    thaw();
+    if (!fingerInsert(aNode)) {
+        Drone *found = m_finger.node[m_finger.depth - 1];
+        if (found->m_dead) { // the ID was removed while deferring, the old node comes back
+            reviveDrone(found, aNode);
+        }
+        delete aNode;
+        return;
     }
+    aNode->m_slot = m_store.add(aNode->m_id, aNode->m_payload.type, aNode->m_payload.state);
+    indexAdd(aNode->m_id, aNode->m_payload.type, aNode->m_payload.state);
+    m_grid.add(aNode);
 }
 
-void Show::listHelper(Drone *aDrone) const { // prints out a list of Drones with state and color
+// state and type are pending values inherited from an ancestor, they win over the node's own values
+void Show::listHelper(Drone *aDrone, int state, int type) const { // prints out a list of Drones with state and color
     if (aDrone != nullptr){
-        listHelper(aDrone->m_left);//first visit the left child
-        cout << aDrone->m_id << ":" << aDrone->getStateStr() << ":" << aDrone->getTypeStr() << endl;//second visit the node itself
-        listHelper(aDrone->m_right);//third visit the right child
+        Drone shown(aDrone->m_id, typeOf(aDrone), stateOf(aDrone));
+        if (state != NO_TAG) shown.m_payload.state = static_cast<STATE>(state);
+        if (type != NO_TAG) shown.m_payload.type = static_cast<LIGHTCOLOR>(type);
+        int kidState = (state == NO_TAG && aDrone->m_tagState) ? aDrone->m_pendState : state;
+        int kidType = (type == NO_TAG && aDrone->m_tagType) ? aDrone->m_pendType : type;
+
+        listHelper(aDrone->m_left, kidState, kidType);//first visit the left child
+        if (!aDrone->m_dead)
+            cout << shown.m_id << ":" << shown.getStateStr() << ":" << shown.getTypeStr() << endl;//second visit the node itself
+        listHelper(aDrone->m_right, kidState, kidType);//third visit the right child
     }
 }
 
-int Show::helpCount(Drone *aDrone, LIGHTCOLOR aColor)const { // counts specific color
+int Show::helpCount(Drone *aDrone, LIGHTCOLOR aColor, int type)const { // counts specific color
     int holder = 0;
     if (aDrone == nullptr) {
         return 0;
     }
     else{
-        if (aDrone->m_type == aColor) { // adds to holder when ID type equals that color
+        LIGHTCOLOR current = (type != NO_TAG) ? static_cast<LIGHTCOLOR>(type) : typeOf(aDrone);
+        if (current == aColor && !aDrone->m_dead) { // adds to holder when ID type equals that color
             holder += 1;
         }
-        holder += helpCount(aDrone->m_left, aColor);
-        holder += helpCount(aDrone->m_right, aColor);
+        int kidType = (type == NO_TAG && aDrone->m_tagType) ? aDrone->m_pendType : type;
+        holder += helpCount(aDrone->m_left, aColor, kidType);
+        holder += helpCount(aDrone->m_right, aColor, kidType);
     }
     return holder;
 }
 
-void Show::helpClear(Drone *curr) { // helps clearing everything
-
-    if (curr == nullptr) {
-
+int Show::helpCountState(Drone *aDrone, STATE LIGHTOFF, int state) const { // function for counting LIGHTOFF for testing
+    int amount = 0;
+    if (aDrone == nullptr) {
+        return 0;
     }
     else{
-        helpClear(curr->m_left);
-        helpClear(curr->m_right);
+        STATE current = (state != NO_TAG) ? static_cast<STATE>(state) : stateOf(aDrone);
+        if (current == LIGHTOFF && !aDrone->m_dead) {
+            amount += 1;
+        }
+        int kidState = (state == NO_TAG && aDrone->m_tagState) ? aDrone->m_pendState : state;
+        amount += helpCountState(aDrone->m_left, LIGHTOFF, kidState);
+        amount += helpCountState(aDrone->m_right, LIGHTOFF, kidState);
     }
-    delete curr;
+    return amount;
 }
 
-Drone * Show::helpCopy(Drone *curr) { // for assignment operator copying
-    Drone *temp = nullptr;
-    if (curr != nullptr) {
-        temp = new Drone(*curr);
-        temp->m_left = helpCopy(curr->m_left);
-        temp->m_right = helpCopy(curr->m_right);
+// drops finger entries from the bottom until one's ID interval holds id, then walks down
+// from there like accessHelper, recording the path; true if the last node on it is id
+bool Show::fingerDescend(int id) {
+    if (!m_fingerOn) {
+        m_finger.depth = 0;
+    }
+    while (m_finger.depth > 0 && (id < m_finger.low[m_finger.depth - 1] || m_finger.high[m_finger.depth - 1] < id)) {
+        m_finger.depth--;
+    }
+    Drone *curr = m_root;
+    int low = MINID;
+    int high = MAXID;
+    if (m_finger.depth > 0) { // restart at that entry, it is pushed again below
+        m_finger.depth--;
+        curr = m_finger.node[m_finger.depth];
+        low = m_finger.low[m_finger.depth];
+        high = m_finger.high[m_finger.depth];
+    }
+    while (curr != nullptr) {
+        pushDown(curr);
+        m_finger.node[m_finger.depth] = curr;
+        m_finger.low[m_finger.depth] = low;
+        m_finger.high[m_finger.depth] = high;
+        m_finger.depth++;
+        if (id == curr->m_id) {
+            return true;
+        }
+        if (id < curr->m_id) { // left
+            high = curr->m_id - 1;
+            curr = curr->m_left;
+        }
+        else { // right
+            low = curr->m_id + 1;
+            curr = curr->m_right;
+        }
     }
-    return temp;
+    return false;
 }
 
-int Show::countNodes(Drone * curr) { // count total nodes
-    if (curr == nullptr) {
-        return 0;
+// links aNode below the end of the finger path and retraces upward only while heights
+// change, after a rotation the subtree is as high as before so nothing above moves
+bool Show::fingerInsert(Drone *aNode) {
+    int id = aNode->m_id;
+    if (fingerDescend(id)) { // no duplicates
+        return false;
     }
-    else{
-        return 1 + countNodes(curr->m_left) + countNodes(curr->m_right);
+    int depth = m_finger.depth;
+    int low = MINID;
+    int high = MAXID;
+    if (depth == 0) {
+        m_root = aNode;
+    }
+    else {
+        Drone *parent = m_finger.node[depth - 1];
+        low = m_finger.low[depth - 1];
+        high = m_finger.high[depth - 1];
+        if (id < parent->m_id) {
+            parent->m_left = aNode;
+            high = parent->m_id - 1;
+        }
+        else {
+            parent->m_right = aNode;
+            low = parent->m_id + 1;
+        }
+    }
+    m_finger.node[depth] = aNode;
+    m_finger.low[depth] = low;
+    m_finger.high[depth] = high;
+    m_finger.depth = depth + 1;
+    SHOW_CHECK(aNode, low, high);
+
+    for (int k = depth - 1; k >= 0; k--) {
+        Drone *curr = m_finger.node[k];
+        int before = curr->m_height;
+        fixHeight(curr);
+        Drone *top = rebalanceHelper(curr);
+        SHOW_CHECK(top, m_finger.low[k], m_finger.high[k]); // the order against the whole path
+        if (top != curr) { // rotated, top covers the same IDs at the same place
+            if (k == 0) {
+                m_root = top;
+            }
+            else if (m_finger.node[k - 1]->m_left == curr) {
+                m_finger.node[k - 1]->m_left = top;
+            }
+            else {
+                m_finger.node[k - 1]->m_right = top;
+            }
+            m_finger.node[k] = top;
+            m_finger.depth = k + 1; // the path below top changed
+            break;
+        }
+        if (curr->m_height == before) {
+            break;
+        }
     }
+    return true;
 }
 
-void Show::helpLightOff(Drone *curr) { // finds all the lightoff NODES and call remove for them
-    Drone * temp = curr;
+Drone *Show::fingerFind(int id) { // accessHelper that starts at the finger
+    if (fingerDescend(id)) {
+        return m_finger.node[m_finger.depth - 1];
+    }
+    return nullptr;
+}
 
-    if (temp == nullptr) {
-        return;
+Drone *Show::hotFind(int id, bool exact) const {
+    if (!inRange(id)) { // empty entries hold DEFAULT_ID, it must not match them
+        return nullptr;
+    }
+    if (m_hot != nullptr) {
+        const HotEntry &entry = m_hot[id & (HOT_SIZE - 1)];
+        if (entry.id == id && (!exact || entry.ranges == m_ranges)) {
+            m_hotHits++;
+            return entry.node;
+        }
     }
-        if (temp->m_state == LIGHTOFF) {
-            remove(temp->getID());
-            helpLightOff(m_root); // important as with rebalancing after remove you miss some nodes so back to mroot
-        }
-    helpLightOff(temp->m_left);
-    helpLightOff(temp->m_right);
-}
-
-void Show::helpHeight(Drone * curr) {
-    if(curr != nullptr) {
-        helpHeight(curr->m_left); // these two recursive function makes sure the heights are correct
-        helpHeight(curr->m_right);
-
-        // all cases for remove
-        if (curr->m_left == nullptr && curr->m_right == nullptr) {
-            curr->m_height = DEFAULT_HEIGHT;
-        } else if (curr->m_left != nullptr && curr->m_right == nullptr) {
-            curr->m_height = curr->m_left->m_height + 1;
-        } else if (curr->m_right != nullptr && curr->m_left == nullptr) {
-            curr->m_height = curr->m_right->m_height + 1;
-        } else {
-            if (curr->m_right->m_height >= curr->m_left->m_height) {
-                curr->m_height = curr->m_right->m_height + 1;
-            } else {
-                curr->m_height = curr->m_left->m_height + 1;
+    m_hotMisses++;
+    return nullptr;
+}
+
+void Show::hotStore(int id, Drone *curr, bool exact) const { // the newest lookup takes the entry over
+    if (curr != nullptr) {
+        if (m_hot == nullptr) { // DEFAULT_ID is outside MINID..MAXID so no lookup matches it
+            m_hot = new HotEntry[HOT_SIZE];
+            for (int i = 0; i < HOT_SIZE; i++) {
+                m_hot[i].id = DEFAULT_ID;
+                m_hot[i].node = nullptr;
             }
         }
+        HotEntry &entry = m_hot[id & (HOT_SIZE - 1)];
+        entry.id = id;
+        entry.ranges = exact ? m_ranges : m_ranges - 1; // never equal, so it isn't taken as exact
+        entry.node = curr;
     }
 }
 
-Drone *Show::removeHelper(Drone *curr, int id) {
-    if (curr == nullptr){
-        return curr;
+void Show::hotForget(int id) { // before id's node is deleted
+    if (m_hot == nullptr) {
+        return;
+    }
+    HotEntry &entry = m_hot[id & (HOT_SIZE - 1)];
+    if (entry.id == id) {
+        entry.id = DEFAULT_ID;
+        entry.node = nullptr;
     }
-    else if (id < curr->m_id) { // going left
+}
+
+void Show::hotClear() { // the next lookup that fills an entry allocates a fresh array
+    delete [] m_hot;
+    m_hot = nullptr;
+}
+
+void Show::dropDrone(Drone *curr) { // curr's payload is exact, removeHelper pushed its ancestors
+    indexRemove(curr->m_id, typeOf(curr), stateOf(curr));
+    m_grid.remove(curr);
+    m_store.release(curr->m_slot);
+    delete curr;
+}
+
+void Show::buryDrone(Drone *curr) { // curr's payload is exact, the finger walk pushed its ancestors
+    indexRemove(curr->m_id, typeOf(curr), stateOf(curr));
+    m_grid.remove(curr);
+    m_store.setColor(curr->m_slot, FREE_SLOT); // the column kernels skip it like a free slot
+    m_store.setState(curr->m_slot, FREE_SLOT);
+    curr->m_dead = true;
+    m_deadCount++;
+}
+
+void Show::reviveDrone(Drone *dead, const Drone *aNode) { // takes aNode's payload and position
+    dead->m_dead = false;
+    writeColor(dead, aNode->m_payload.type);
+    writeState(dead, aNode->m_payload.state);
+    dead->setPosition(aNode->m_x, aNode->m_y, aNode->m_z);
+    m_deadCount--;
+    indexAdd(dead->m_id, aNode->m_payload.type, aNode->m_payload.state);
+    m_grid.add(dead);
+}
+
+void Show::applyTag(Drone *curr, int state, int type) { // updates curr and leaves the value pending for its kids
+    if (state != NO_TAG) {
+        writeState(curr, state);
+        curr->m_pendState = static_cast<STATE>(state);
+        curr->m_tagState = true;
+    }
+    if (type != NO_TAG) {
+        writeColor(curr, type);
+        curr->m_pendType = static_cast<LIGHTCOLOR>(type);
+        curr->m_tagType = true;
+    }
+}
+
+void Show::pushDown(Drone *curr) { // hands curr's pending values to its kids
+    if (curr == nullptr) {
+        return;
+    }
+    int state = curr->m_tagState ? curr->m_pendState : NO_TAG;
+    int type = curr->m_tagType ? curr->m_pendType : NO_TAG;
+    if (state != NO_TAG || type != NO_TAG) {
         if (curr->m_left != nullptr) {
-            curr->m_left = removeHelper(curr->m_left, id);
+            applyTag(curr->m_left, state, type);
         }
-    }
-    else if(id > curr->m_id)  {   // going right
         if (curr->m_right != nullptr) {
-            curr->m_right = removeHelper(curr->m_right, id);
+            applyTag(curr->m_right, state, type);
         }
+        curr->m_tagState = false;
+        curr->m_tagType = false;
     }
-    else{
-        if (curr->m_left == nullptr && curr->m_right == nullptr) { // no kids
-            delete curr;
-            return nullptr;
-        }
-        else if (curr->m_left == nullptr) { // no left kid
-            Drone *temp = curr->m_right;
-            delete curr;
-            helpHeight(temp);
-            temp = rebalanceHelper(temp);
-            return temp;
-        }
-        else if(curr->m_right == nullptr) { // no right kid
-            Drone *temp = curr->m_left;
-            delete curr;
-            helpHeight(temp);
-            temp = rebalanceHelper(temp);
-            return temp;
-        }
-        else{ // both kids
-            Drone *temp;
-            Drone *drone = curr->m_right;
-
-            while ((drone != nullptr) && (drone->m_left != nullptr)) {
-                drone = drone->m_left;
+}
+
+// low and high bound the IDs that can be in curr's subtree, a subtree that lies
+// completely inside lo..hi only gets tagged, so just two paths are walked to the bottom
+void Show::rangeHelper(Drone *curr, int lo, int hi, int low, int high, int state, int type) {
+    if (curr == nullptr || hi < low || high < lo) {
+        return;
+    }
+    if (lo <= low && high <= hi && !m_frozen) { // whole subtree is in range, frozen shows can't have pending values
+        applyTag(curr, state, type);
+        m_pending = true;
+        m_ranges++; // curr may be above cached nodes
+        return;
+    }
+    pushDown(curr);
+    if (lo <= curr->m_id && curr->m_id <= hi) {
+        if (state != NO_TAG) writeState(curr, state);
+        if (type != NO_TAG) writeColor(curr, type);
+    }
+    rangeHelper(curr->m_left, lo, hi, low, curr->m_id - 1, state, type);
+    rangeHelper(curr->m_right, lo, hi, curr->m_id + 1, high, state, type);
+}
+
+unsigned long long *Show::indexBits(int which) const { // bitmap of one color or state class
+    return m_index + (long long)which * INDEX_WORDS;
+}
+
+int *Show::indexCount(int which) { // the counter that goes with a bitmap
+    return (which < NUMCOLORS) ? &m_colorCount[which] : &m_stateCount[which - NUMCOLORS];
+}
+
+void Show::indexAdd(int id, LIGHTCOLOR type, STATE state) {
+    if (m_index == nullptr) {
+        m_index = new unsigned long long[(NUMCOLORS + NUMSTATES) * INDEX_WORDS](); // all zero
+    }
+    int bit = id - MINID;
+    indexBits(type)[bit / 64] |= 1ULL << (bit % 64);
+    indexBits(NUMCOLORS + state)[bit / 64] |= 1ULL << (bit % 64);
+    m_colorCount[type]++;
+    m_stateCount[state]++;
+}
+
+void Show::indexRemove(int id, LIGHTCOLOR type, STATE state) {
+    int bit = id - MINID;
+    indexBits(type)[bit / 64] &= ~(1ULL << (bit % 64));
+    indexBits(NUMCOLORS + state)[bit / 64] &= ~(1ULL << (bit % 64));
+    m_colorCount[type]--;
+    m_stateCount[state]--;
+}
+
+// moves every ID in lo..hi from the bitmaps first..last-1 into bitmap to, a word at a time
+void Show::indexMoveRange(int lo, int hi, int to, int first, int last) {
+    if (m_index == nullptr) {
+        return;
+    }
+    if (lo < MINID) lo = MINID;
+    if (hi > MAXID) hi = MAXID;
+    if (lo > hi) {
+        return;
+    }
+    int loBit = lo - MINID;
+    int hiBit = hi - MINID;
+    unsigned long long *target = indexBits(to);
+
+    for (int word = loBit / 64; word <= hiBit / 64; word++) {
+        unsigned long long mask = ~0ULL;
+        if (word == loBit / 64) mask &= ~0ULL << (loBit % 64);
+        if (word == hiBit / 64 && hiBit % 64 != 63) mask &= (1ULL << (hiBit % 64 + 1)) - 1;
+
+        for (int which = first; which < last; which++) {
+            if (which != to) {
+                unsigned long long moved = indexBits(which)[word] & mask;
+                if (moved != 0) {
+                    int amount = __builtin_popcountll(moved);
+                    indexBits(which)[word] &= ~moved;
+                    target[word] |= moved;
+                    *indexCount(which) -= amount;
+                    *indexCount(to) += amount;
+                }
             }
-            temp = drone;
-            curr->m_id = temp->m_id;
-            curr->m_right = removeHelper(curr->m_right, temp->m_id);
-            helpHeight(curr);
-            curr = rebalanceHelper(curr);
         }
     }
+}
 
-    helpHeight(curr);
-    curr = rebalanceHelper(curr);
+void Show::indexCopy(const Show & rhs) {
+    delete [] m_index;
+    m_index = nullptr;
+    if (rhs.m_index != nullptr) {
+        m_index = new unsigned long long[(NUMCOLORS + NUMSTATES) * INDEX_WORDS];
+        for (int i = 0; i < (NUMCOLORS + NUMSTATES) * INDEX_WORDS; i++) {
+            m_index[i] = rhs.m_index[i];
+        }
+    }
+    for (int i = 0; i < NUMCOLORS; i++) m_colorCount[i] = rhs.m_colorCount[i];
+    for (int i = 0; i < NUMSTATES; i++) m_stateCount[i] = rhs.m_stateCount[i];
+}
 
-    return curr;
+void Show::indexClear() { // keeps the bitmaps allocated for reuse
+    if (m_index != nullptr) {
+        for (int i = 0; i < (NUMCOLORS + NUMSTATES) * INDEX_WORDS; i++) {
+            m_index[i] = 0;
+        }
+    }
+    for (int i = 0; i < NUMCOLORS; i++) m_colorCount[i] = 0;
+    for (int i = 0; i < NUMSTATES; i++) m_stateCount[i] = 0;
 }
 
-Drone *Show::rebalanceHelper(Drone *curr) { // rebalanced cases
+vector<int> Show::indexList(int which) const { // walks the set bits of one bitmap in ID order
+    vector<int> ids;
+    int count = (which < NUMCOLORS) ? m_colorCount[which] : m_stateCount[which - NUMCOLORS];
+    if (m_index == nullptr || count == 0) {
+        return ids;
+    }
+    ids.reserve(count);
+    const unsigned long long *bits = indexBits(which);
+    for (int word = 0; word < INDEX_WORDS && (int)ids.size() < count; word++) {
+        unsigned long long rest = bits[word];
+        while (rest != 0) {
+            ids.push_back(MINID + word * 64 + __builtin_ctzll(rest));
+            rest &= rest - 1; // clears the lowest set bit
+        }
+    }
+    return ids;
+}
 
-    int balance = helpBalance(curr);
+// every plan gives the same answer, the tests run them side by side
+int Show::runQuery(const DroneQuery & query, QUERYPLAN plan, vector<int>* ids) const {
+    int lo = query.lo < MINID ? MINID : query.lo;
+    int hi = query.hi > MAXID ? MAXID : query.hi;
+    if (lo > hi || query.color < NO_TAG || query.color >= NUMCOLORS || query.state < NO_TAG || query.state >= NUMSTATES) {
+        return 0;
+    }
+    if (plan != PLAN_INDEX) {
+        DroneQuery range = query;
+        range.lo = lo;
+        range.hi = hi;
+        return queryWalk(m_root, range, plan == PLAN_RANGE, NO_TAG, NO_TAG, ids);
+    }
+    if (m_index == nullptr) {
+        return 0;
+    }
+    int count = 0;
+    int loBit = lo - MINID;
+    int hiBit = hi - MINID;
+    for (int word = loBit / 64; word <= hiBit / 64; word++) {
+        unsigned long long bits = queryBits(query, word);
+        if (word == loBit / 64) bits &= ~0ULL << (loBit % 64);
+        if (word == hiBit / 64 && hiBit % 64 != 63) bits &= (1ULL << (hiBit % 64 + 1)) - 1;
+        count += __builtin_popcountll(bits);
+        while (ids != nullptr && bits != 0) {
+            ids->push_back(MINID + word * 64 + __builtin_ctzll(bits));
+            bits &= bits - 1;
+        }
+    }
+    return count;
+}
 
-    if (balance == 0) {
-        return curr;
+unsigned long long Show::queryBits(const DroneQuery & query, int word) const { // the IDs of one word that match
+    unsigned long long bits = 0;
+    if (query.color != NO_TAG) {
+        bits = indexBits(query.color)[word];
+    }
+    else {
+        for (int i = 0; i < NUMCOLORS; i++) bits |= indexBits(i)[word];
     }
-    // Left Left case
-    if (balance < -1 && helpBalance(curr->m_right) <= 0) {
-        if (m_root == curr) {
-           m_root = helpLeftLeftRotate(curr);
-            curr = m_root;
+    if (query.state != NO_TAG) {
+        bits &= indexBits(NUMCOLORS + query.state)[word];
+    }
+    return bits;
+}
+
+// in order like listHelper, with the values pending above a node passed down; with prune
+// set only the subtrees that can hold IDs of the range are visited
+int Show::queryWalk(Drone *curr, const DroneQuery & query, bool prune, int state, int type, vector<int>* ids) const {
+    if (curr == nullptr) {
+        return 0;
+    }
+    int kidState = (state == NO_TAG && curr->m_tagState) ? curr->m_pendState : state;
+    int kidType = (type == NO_TAG && curr->m_tagType) ? curr->m_pendType : type;
+    int count = 0;
+    if (!prune || query.lo < curr->m_id) {
+        count += queryWalk(curr->m_left, query, prune, kidState, kidType, ids);
+    }
+    if (!curr->m_dead && query.lo <= curr->m_id && curr->m_id <= query.hi) {
+        int color = (type != NO_TAG) ? type : typeOf(curr);
+        int current = (state != NO_TAG) ? state : stateOf(curr);
+        if ((query.color == NO_TAG || query.color == color) && (query.state == NO_TAG || query.state == current)) {
+            count++;
+            if (ids != nullptr) ids->push_back(curr->m_id);
         }
-        else {
-            curr = helpLeftLeftRotate(curr);
+    }
+    if (!prune || curr->m_id < query.hi) {
+        count += queryWalk(curr->m_right, query, prune, kidState, kidType, ids);
+    }
+    return count;
+}
+
+// the range walk of queryWalk that pushes the pending values down on its way, so the
+// values stored in the nodes it visits are exact and are changed in place
+void Show::queryApply(Drone *curr, const DroneQuery & query, int which, int value) {
+    if (curr == nullptr) {
+        return;
+    }
+    pushDown(curr);
+    if (query.lo < curr->m_id) {
+        queryApply(curr->m_left, query, which, value);
+    }
+    if (!curr->m_dead && query.lo <= curr->m_id && curr->m_id <= query.hi) {
+        LIGHTCOLOR color = typeOf(curr);
+        STATE state = stateOf(curr);
+        if ((query.color == NO_TAG || query.color == color) && (query.state == NO_TAG || query.state == state)) {
+            indexRemove(curr->m_id, color, state);
+            if (which >= NUMCOLORS) {
+                state = static_cast<STATE>(value);
+                writeState(curr, state);
+            }
+            else {
+                color = static_cast<LIGHTCOLOR>(value);
+                writeColor(curr, color);
+            }
+            indexAdd(curr->m_id, color, state);
         }
     }
-    // Left Right case
-    else if (balance < -1 && helpBalance(curr->m_right) > 0) {
-        if (m_root == curr) {
-            m_root = helpRightLeftRotate(curr);
-            curr = m_root;
+    if (curr->m_id < query.hi) {
+        queryApply(curr->m_right, query, which, value);
+    }
+}
+
+// finds the runs of drones that all match with no drone in between that doesn't, from the
+// bitmaps, and gives each run to one range update; IDs nobody has don't end a run; when
+// the runs are so short that their descents cost more than walking the range, it walks
+int Show::queryUpdate(const DroneQuery & query, int which, int value) {
+    int lo = query.lo < MINID ? MINID : query.lo;
+    int hi = query.hi > MAXID ? MAXID : query.hi;
+    if (m_index == nullptr || lo > hi || query.color < NO_TAG || query.color >= NUMCOLORS || query.state < NO_TAG || query.state >= NUMSTATES) {
+        return 0;
+    }
+    vector<pair<int,int> > runs; // first and last bit, applied after the bitmaps are read
+    int count = 0;
+    int start = -1;
+    int end = -1;
+    int loBit = lo - MINID;
+    int hiBit = hi - MINID;
+    for (int word = loBit / 64; word <= hiBit / 64; word++) {
+        unsigned long long mask = ~0ULL;
+        if (word == loBit / 64) mask &= ~0ULL << (loBit % 64);
+        if (word == hiBit / 64 && hiBit % 64 != 63) mask &= (1ULL << (hiBit % 64 + 1)) - 1;
+        unsigned long long present = 0;
+        for (int i = 0; i < NUMCOLORS; i++) present |= indexBits(i)[word];
+        present &= mask;
+        unsigned long long match = queryBits(query, word) & mask;
+        count += __builtin_popcountll(match);
+        if ((present & ~match) == 0) { // the whole word goes into the run
+            if (match != 0) {
+                if (start == -1) start = word * 64 + __builtin_ctzll(match);
+                end = word * 64 + 63 - __builtin_clzll(match);
+            }
+            continue;
         }
-        else {
-            curr = helpRightLeftRotate(curr);
+        while (present != 0) {
+            int bit = __builtin_ctzll(present);
+            present &= present - 1;
+            if (match >> bit & 1) {
+                if (start == -1) start = word * 64 + bit;
+                end = word * 64 + bit;
+            }
+            else if (start != -1) {
+                runs.push_back(make_pair(start, end));
+                start = -1;
+            }
         }
     }
-    // Right Right Case
-    else if (balance > 1 && helpBalance(curr->m_left) >= 0){
-        if (m_root == curr) {
-            m_root = helpRightRightRotate(curr);
-            curr = m_root;
+    if (start != -1) {
+        runs.push_back(make_pair(start, end));
+    }
+    long long height = (m_root == nullptr) ? 0 : m_root->m_height + 1;
+    long long nodes = (long long)m_store.size() * (hi - lo + 1) / (MAXID - MINID + 1);
+    if ((long long)runs.size() * height > nodes) { // short runs, one walk of the range is cheaper
+        DroneQuery range = query;
+        range.lo = lo;
+        range.hi = hi;
+        m_finger.depth = 0;
+        queryApply(m_root, range, which, value);
+        return count;
+    }
+    for (int i = 0; i < (int)runs.size(); i++) { // one drone goes through the cached path
+        int first = MINID + runs[i].first;
+        int last = MINID + runs[i].second;
+        if (which >= NUMCOLORS) {
+            if (first == last) setState(first, static_cast<STATE>(value));
+            else setStateRange(first, last, static_cast<STATE>(value));
         }
         else {
-            curr = helpRightRightRotate(curr);
+            if (first == last) setColor(first, static_cast<LIGHTCOLOR>(value));
+            else setColorRange(first, last, static_cast<LIGHTCOLOR>(value));
         }
     }
-    // Right Left Case
-    else if (balance > 1 && helpBalance(curr->m_left) < 0) {
-        if (m_root == curr) {
-            m_root = helpLeftRightRotate(curr);
-            curr = m_root;
+    return count;
+}
+
+void Show::walkLeft(Walk & walk, Drone *curr, int state, int type) const { // stacks curr and its left spine
+    while (curr != nullptr) {
+        walk.node[walk.depth] = curr;
+        walk.state[walk.depth] = state;
+        walk.type[walk.depth] = type;
+        walk.depth++;
+        if (state == NO_TAG && curr->m_tagState) state = curr->m_pendState;
+        if (type == NO_TAG && curr->m_tagType) type = curr->m_pendType;
+        curr = curr->m_left;
+    }
+}
+
+bool Show::walkNext(Walk & walk, DroneChange & next) const { // pops the next live drone in ID order
+    while (walk.depth > 0) {
+        walk.depth--;
+        Drone *curr = walk.node[walk.depth];
+        int state = walk.state[walk.depth];
+        int type = walk.type[walk.depth];
+
+        next.id = curr->m_id;
+        next.state = (state != NO_TAG) ? static_cast<STATE>(state) : stateOf(curr);
+        next.type = (type != NO_TAG) ? static_cast<LIGHTCOLOR>(type) : typeOf(curr);
+
+        if (state == NO_TAG && curr->m_tagState) state = curr->m_pendState;
+        if (type == NO_TAG && curr->m_tagType) type = curr->m_pendType;
+        walkLeft(walk, curr->m_right, state, type);
+        if (!curr->m_dead) {
+            return true;
         }
-        else {
-            curr = helpLeftRightRotate(curr);
+    }
+    return false;
+}
+
+void Show::gridFill(Drone *curr) { // puts every live node of the subtree into the grid
+    if (curr != nullptr) {
+        if (!curr->m_dead) {
+            m_grid.add(curr);
         }
+        gridFill(curr->m_left);
+        gridFill(curr->m_right);
     }
+}
 
-    return curr;
+// the store is written for the kernels, the node for Drone::getType and getState; a dead
+// node's slot is left masked until the node comes back
+void Show::writeState(Drone *curr, int state) {
+    curr->m_payload.state = static_cast<STATE>(state);
+    if (!curr->m_dead) {
+        m_store.setState(curr->m_slot, state);
+    }
 }
 
-int Show::helpBalance(Drone * curr) {
-    if(curr == nullptr) {
-        return 0;
+void Show::writeColor(Drone *curr, int color) {
+    curr->m_payload.type = static_cast<LIGHTCOLOR>(color);
+    if (!curr->m_dead) {
+        m_store.setColor(curr->m_slot, color);
     }
-    else {
-        int leftSide = findHeight(curr->m_left);
-        int rightSide = findHeight(curr->m_right);
-        return (leftSide - rightSide);
+}
+
+void Show::flipHelper(Drone *curr) { // the nodes' copies of what the store kernel flipped
+    if (curr != nullptr) {
+        if (!curr->m_dead) {
+            curr->m_payload.state = (curr->m_payload.state == LIGHTON) ? LIGHTOFF : LIGHTON;
+        }
+        flipHelper(curr->m_left);
+        flipHelper(curr->m_right);
     }
 }
 
-Drone *Show::helpRightRightRotate(Drone *curr) {
-    Drone *temp = curr->m_left;
-    curr->m_left = temp->m_right;
-    temp->m_right = curr;
-    return temp;
+LIGHTCOLOR Show::typeOf(const Drone *aDrone) const { // current color, as long as the ancestors have no pending value
+    return static_cast<LIGHTCOLOR>(m_store.getColor(aDrone->m_slot));
 }
 
-Drone *Show::helpLeftLeftRotate(Drone *curr) {
-    Drone *temp = curr->m_right;
-    curr->m_right = temp->m_left;
-    temp->m_left = curr;
-    return temp;
+STATE Show::stateOf(const Drone *aDrone) const {
+    return static_cast<STATE>(m_store.getState(aDrone->m_slot));
 }
 
-Drone *Show::helpRightLeftRotate(Drone *curr) {
-    Drone *temp = curr->m_right;
-    curr->m_right = helpRightRightRotate(temp);
-    return helpLeftLeftRotate(curr);
+void Show::flushTags() { // pushes every pending range value to the bottom so the store is exact
+    if (m_pending) {
+        flushHelper(m_root);
+        m_pending = false;
+    }
 }
 
-Drone *Show::helpLeftRightRotate(Drone *curr) {
-    Drone *temp = curr->m_left;
-    curr->m_left = helpLeftLeftRotate(temp);
-    return helpRightRightRotate(curr);
+void Show::flushHelper(Drone *curr) {
+    if (curr != nullptr) {
+        pushDown(curr);
+        flushHelper(curr->m_left);
+        flushHelper(curr->m_right);
+    }
 }
 
-int Show::findHeight(Drone *curr) { // gets height for rebalanced purposes
-    if(curr == nullptr) {
-        return -1;
+// branchless descent, the comparison result picks the kid, and the block holding
+// the entries four levels down is prefetched while this level is compared
+Drone *Show::frozenFind(int id) const {
+    const int *ids = m_frozenIds.data();
+    int size = (int)m_frozenIds.size() - 1;
+    int k = 1;
+    while (k <= size) {
+        __builtin_prefetch(ids + 16 * k);
+        k = 2 * k + (ids[k] < id);
     }
-    else{
-        return curr->m_height;
+    k >>= __builtin_ffs(~k); // undoes the right turns taken after the last left turn
+    if (k != 0 && ids[k] == id) {
+        return m_frozenNodes[k];
     }
+    return nullptr;
 }
 
-bool Show::testBalance(Drone *curr) { // test if tree is balanced by checking balanced > 2 or < -2
-    bool result = true;
+void Show::inorderNodes(Drone *curr, vector<Drone*> & nodes) const {
     if (curr != nullptr) {
-        int balanced = findHeight(curr->m_left) - findHeight(curr->m_right);
-        result = result && testBalance(curr->m_left);
-        result = result && testBalance(curr->m_right);
+        inorderNodes(curr->m_left, nodes);
+        nodes.push_back(curr);
+        inorderNodes(curr->m_right, nodes);
+    }
+}
 
-        if (balanced >= 2 || balanced <= -2) {
-            result = false;
-            return result;
+void Show::eytzingerFill(const vector<Drone*> & sorted, int & next, int k) { // in-order walk of the implicit tree
+    if (k < (int)m_frozenIds.size()) {
+        eytzingerFill(sorted, next, 2 * k);
+        m_frozenIds[k] = sorted[next]->m_id;
+        m_frozenNodes[k] = sorted[next];
+        next++;
+        eytzingerFill(sorted, next, 2 * k + 1);
+    }
+}
+// one node and its kids: IDs within low..high and in order, stored heights one more than
+// the higher kid's, balance -1..1; a broken node is counted and reported on cerr
+void Show::checkNode(Drone *curr, int low, int high) {
+    if (curr == nullptr) {
+        return;
+    }
+    bool good = low <= curr->m_id && curr->m_id <= high;
+    good = good && (curr->m_left == nullptr || (low <= curr->m_left->m_id && curr->m_left->m_id < curr->m_id));
+    good = good && (curr->m_right == nullptr || (curr->m_id < curr->m_right->m_id && curr->m_right->m_id <= high));
+    Drone *nodes[3] = {curr, curr->m_left, curr->m_right};
+    for (int i = 0; i < 3 && good; i++) {
+        if (nodes[i] != nullptr) {
+            int leftSide = findHeight(nodes[i]->m_left);
+            int rightSide = findHeight(nodes[i]->m_right);
+            good = nodes[i]->m_height == (leftSide > rightSide ? leftSide : rightSide) + 1
+                   && leftSide - rightSide >= -1 && leftSide - rightSide <= 1;
         }
     }
-    return result;
+    if (!good) {
+        m_violations++;
+        cerr << "Show: AVL invariant broken at drone " << curr->m_id << endl;
+    }
 }
 
-
-
-bool Show::testBSTProperty(Drone * curr) { // checks the BST property, makes sure ID are in the right spot
-    bool result = true;
-    if (curr != nullptr) {
-        result = result && testBSTProperty(curr->m_left);
-        result = result && testBSTProperty(curr->m_right);
-        if(curr->m_left != nullptr && curr->m_id < curr->m_left->m_id) {
-            result = false;
-        }
-        if(curr->m_right != nullptr && curr->m_id > curr->m_right->m_id) {
-            result = false;
-        }
-        return result;
+bool Show::checkTree() const {
+    int nodes = 0;
+    if (checkHelper(m_root, MINID, MAXID, nodes) == -2) {
+        return false;
     }
-    return result;
+    int live = 0;
+    for (int i = 0; i < NUMCOLORS; i++) live += m_colorCount[i];
+    return nodes == m_store.size() && live == nodes - m_deadCount;
 }
 
-int Show::helpCountState(Drone *aDrone, STATE LIGHTOFF) const { // function for counting LIGHTOFF for testing
-    int amount = 0;
-    if (aDrone == nullptr) {
-        return 0;
+int Show::checkHelper(const Drone *curr, int low, int high, int & nodes) const { // height, -2 if broken
+    if (curr == nullptr) {
+        return -1;
     }
-    else{
-        if (aDrone->m_state == LIGHTOFF) {
-            amount += 1;
-        }
-        amount += helpCountState(aDrone->m_left, LIGHTOFF);
-        amount += helpCountState(aDrone->m_right, LIGHTOFF);
+    if (curr->m_id < low || high < curr->m_id) {
+        return -2;
     }
-    return amount;
+    nodes++;
+    int leftSide = checkHelper(curr->m_left, low, curr->m_id - 1, nodes);
+    int rightSide = leftSide == -2 ? -2 : checkHelper(curr->m_right, curr->m_id + 1, high, nodes);
+    if (leftSide == -2 || rightSide == -2 || leftSide - rightSide < -1 || leftSide - rightSide > 1) {
+        return -2;
+    }
+    int height = (leftSide > rightSide ? leftSide : rightSide) + 1;
+    return curr->m_height == height ? height : -2;
 }
@@ -1,42 +1,70 @@
 #ifndef SHOW_H
 #define SHOW_H
 #include <iostream>
+#include <vector>
+#include "basicshow.h"
+#include "spatialgrid.h"
+#include "payloadstore.h"
 using namespace std;
 class Grader;//this class is for grading purposes, no need to do anything
 class Tester;//this is your tester class, you add your test functions in this class
-class Show;
 enum STATE {LIGHTON, LIGHTOFF};
 enum LIGHTCOLOR {RED,GREEN,BLUE};
 const int MINID = 10000;
 const int MAXID = 99999;
-#define DEFAULT_HEIGHT 0
+struct DronePayload{//what a Show keeps per drone
+    LIGHTCOLOR type;
+    STATE state;
+};
 #define DEFAULT_ID 0
 #define DEFAULT_LIGHT RED
 #define DEFAULT_STATE LIGHTON
-class Drone{
+#define DEFAULT_POSITION 0.0
+#define NO_SLOT -1
+#define NO_CELL -1
+#define LOOKUP_GROUP 16 // searches advanced together by findDrones
+#define HOT_SIZE 1024 // entries of the hot ID cache, a power of two
+#define NO_TAG -1 // no pending range update
+#define NUMCOLORS 3
+#define NUMSTATES 2
+#define INDEX_WORDS ((MAXID - MINID) / 64 + 1) // 64 bit words in one ID bitmap
+#define QUERY_NODE_COST 16 // a node visited by a tree walk costs about this many index words
+class Drone : public BasicNode<int, DronePayload, Drone>{//the node layout of BasicTree plus what Show keeps per node
 public:
     friend class Show;
+    friend class SpatialGrid;
     friend class Grader;
     friend class Tester;
     Drone(int id, LIGHTCOLOR type = DEFAULT_LIGHT, STATE state = DEFAULT_STATE)
-            :m_id(id),m_type(type), m_state(state) {
-        m_left = nullptr;
-        m_right = nullptr;
-        m_height = DEFAULT_HEIGHT;
+            :BasicNode(id, DronePayload{type, state}) {
+        m_tagState = false;
+        m_tagType = false;
+        m_pendState = DEFAULT_STATE;
+        m_pendType = DEFAULT_LIGHT;
+        m_x = DEFAULT_POSITION;
+        m_y = DEFAULT_POSITION;
+        m_z = DEFAULT_POSITION;
+        m_slot = NO_SLOT;
+        m_cell = NO_CELL;
+        m_dead = false;
     }
-    Drone(){
-        m_id = DEFAULT_ID;
-        m_type = DEFAULT_LIGHT;
-        m_state = DEFAULT_STATE;
-        m_left = nullptr;
-        m_right = nullptr;
-        m_height = DEFAULT_HEIGHT;
+    Drone():BasicNode(DEFAULT_ID, DronePayload{DEFAULT_LIGHT, DEFAULT_STATE}) {
+        m_tagState = false;
+        m_tagType = false;
+        m_pendState = DEFAULT_STATE;
+        m_pendType = DEFAULT_LIGHT;
+        m_x = DEFAULT_POSITION;
+        m_y = DEFAULT_POSITION;
+        m_z = DEFAULT_POSITION;
+        m_slot = NO_SLOT;
+        m_cell = NO_CELL;
+        m_dead = false;
     }
     int getID() const {return m_id;}
-    STATE getState() const {return m_state;}
+    STATE getState() const {return m_payload.state;}
     string getStateStr() const {
         string text = "";
-        switch (m_state)
+        switch (m_payload.state)
         {
             case LIGHTOFF:text = "LIGHTOFF";break;
             case LIGHTON:text = "LIGHTON";break;
@@ -44,10 +72,10 @@ public:
         }
         return text;
     }
-    LIGHTCOLOR getType() const {return m_type;}
+    LIGHTCOLOR getType() const {return m_payload.type;}
     string getTypeStr() const {
         string text = "";
-        switch (m_type)
+        switch (m_payload.type)
         {
             case RED:text = "RED";break;
             case GREEN:text = "GREEN";break;
@@ -58,41 +86,166 @@ public:
                 ;
     }
     int getHeight() const {return m_height;}
+    double getX() const {return m_x;}
+    double getY() const {return m_y;}
+    double getZ() const {return m_z;}
     Drone* getLeft() const {return m_left;}
     Drone* getRight() const {return m_right;}
     void setID(const int id){m_id=id;}
-    void setState(STATE state){m_state=state;}
-    void setType(LIGHTCOLOR type){m_type=type;}
+    void setState(STATE state){m_payload.state=state;}
+    void setType(LIGHTCOLOR type){m_payload.type=type;}
     void setHeight(int height){m_height=height;}
     void setLeft(Drone* left){m_left=left;}
     void setRight(Drone* right){m_right=right;}
+    void setPosition(double x, double y, double z){m_x=x;m_y=y;m_z=z;}
 private:
-    int m_id;
-    LIGHTCOLOR m_type;
-    STATE m_state;
-    Drone* m_left;//the pointer to the left child in the BST
-    Drone* m_right;//the pointer to the right child in the BST
-    int m_height;//the height of node in the BST
+    // lazy range updates: the node's own m_payload is already updated,
+    // the pending value still has to be pushed down to both subtrees
+    bool m_tagState;//true if m_pendState is waiting for the kids
+    STATE m_pendState;
+    bool m_tagType;//true if m_pendType is waiting for the kids
+    LIGHTCOLOR m_pendType;
+    double m_x;//position in metres
+    double m_y;
+    double m_z;
+    // once the drone is a node of a Show its color and state live in the Show's
+    // PayloadStore at this slot and m_payload is a mirror of it, writeState and
+    // writeColor change both, both lag behind a range update until it is pushed down to the node
+    int m_slot;
+    int m_cell;//index in its SpatialGrid cell, so leaving the cell doesn't search it
+    bool m_dead;//tombstone, removed while Show was deferring removes, gone at the next compact
+};
+struct DroneChange{//an ID with the color and state it has in the newer frame
+    int id;
+    LIGHTCOLOR type;
+    STATE state;
 };
-class Show{
+// drones with lo <= ID <= hi that have the color and are in the state, a color or state
+// of NO_TAG matches every drone, e.g. DroneQuery{40000, 45000, RED, LIGHTOFF}
+struct DroneQuery{
+    int lo;
+    int hi;
+    int color;
+    int state;
+};
+enum QUERYPLAN {PLAN_SCAN, PLAN_RANGE, PLAN_INDEX};//a walk of the whole tree, of the ID range, or the index bitmaps
+class ChangeSet{//what Show::apply needs to turn the previous frame into the newer one
+public:
+    vector<DroneChange> added;//in ascending ID order, like the other two lists
+    vector<int> removed;
+    vector<DroneChange> changed;
+    bool empty() const {return added.empty() && removed.empty() && changed.empty();}
+    int size() const {return (int)(added.size() + removed.size() + changed.size());}
+};
+// the AVL tree of BasicTree over Show's own types, with the range tags, indexes, payload
+// store, grid, hot cache and finger on top; insert drops IDs outside MINID..MAXID
+class Show : public BasicTree<int, MINID, MAXID, DronePayload, Drone, Show>{
 public:
     friend class Grader;
     friend class Tester;
+    friend class FrameEncoder;//reads the index bitmaps
+    friend class BasicTree<int, MINID, MAXID, DronePayload, Drone, Show>;//calls pushDown and checkNode
     Show();
+    Show(const Show & rhs);
+    Show(Show && rhs) noexcept;
     ~Show();
     const Show & operator=(const Show & rhs);
+    Show & operator=(Show && rhs) noexcept;
+    void swap(Show & rhs) noexcept;//exchanges the two trees in O(1)
     void insert(const Drone& aDrone);
+    void insert(Drone&& aDrone);
+    void emplace(int id, LIGHTCOLOR type = DEFAULT_LIGHT, STATE state = DEFAULT_STATE);//builds the node in place
     void clear();
     void remove(int id);
     void dumpTree() const;
     void listDrones() const;
     bool setState(int id, STATE state);
+    bool setColor(int id, LIGHTCOLOR color);
+    void setStateRange(int lo, int hi, STATE state);//sets all drones with lo <= ID <= hi
+    void setColorRange(int lo, int hi, LIGHTCOLOR color);//sets all drones with lo <= ID <= hi
     void removeLightOff();//removes all LIGHTOFF Drones from the tree
     bool findDrone(int id) const;//returns true if the drone is in tree
+    void findDrones(const int ids[], int count, bool found[]) const;//found[i] is findDrone(ids[i])
     int countDrones(LIGHTCOLOR aColor) const;
+    int countDrones(STATE aState) const;
+    vector<int> getDrones(LIGHTCOLOR aColor) const;//IDs of one color in ascending order
+    vector<int> getDrones(STATE aState) const;//IDs in one state in ascending order
+    bool moveDrone(int id, double x, double y, double z);
+    vector<int> findNear(double x, double y, double z, double radius) const;//IDs within radius of the point
+    vector<int> findNearest(double x, double y, double z, int k) const;//k closest IDs, closest first
+    vector<pair<int,int> > findCollisions(double radius) const;//every pair at most radius apart, lower ID first
+    void setCellSize(double size);//grid cell edge in metres, about the usual query radius works best
+    void flipStates();//turns every LIGHTON drone off and every LIGHTOFF drone on
+    void freeze();//builds a read optimized copy of the IDs, insert/remove/clear thaw it again
+    void thaw();
+    bool isFrozen() const {return m_frozen;}
+    ChangeSet diff(const Show & previous) const;//changes that turn previous into this show
+    void apply(const ChangeSet & changes);
+    // remove only marks the drone dead (hidden from every query) and the tree is rebuilt
+    // without the dead nodes once more than fraction of its nodes are dead, 0 turns it off
+    void setDeferredRemove(double fraction);
+    void compact();//drops the dead nodes now and rebuilds a balanced tree
+    int countDead() const {return m_deadCount;}
+    long long getCacheHits() const {return m_hotHits;}//lookups answered by the hot ID cache
+    long long getCacheMisses() const {return m_hotMisses;}
+    bool load(const vector<DroneChange> & drones);//replaces the show, builds a balanced tree in O(n), false and unchanged unless the IDs are strictly ascending and in range
+    int countDrones(const DroneQuery & query) const;
+    vector<int> getDrones(const DroneQuery & query) const;//matching IDs in ascending order
+    int setState(const DroneQuery & query, STATE state);//returns the drones the query matched
+    int setColor(const DroneQuery & query, LIGHTCOLOR color);
+    QUERYPLAN planQuery(const DroneQuery & query) const;//the access path the cost estimate picks
+    bool checkTree() const;//walks the whole tree, true if heights, balance, ID order and counts are right
+    long long getViolations() const {return m_violations;}//nodes SHOW_CHECKED found broken
 
 private:
-    Drone* m_root;//the root of the BST
+    // secondary indexes, one ID bitmap per color followed by one per state,
+    // bit (id - MINID) is set when the drone belongs to that class
+    unsigned long long* m_index;//allocated on the first insert
+    int m_colorCount[NUMCOLORS];
+    int m_stateCount[NUMSTATES];
+    SpatialGrid m_grid;//the same nodes hashed by position
+    PayloadStore m_store;//colors and states of the nodes, indexed by Drone::m_slot
+    bool m_pending;//true when some node may still hold a pending range value
+    // frozen mode: the IDs in Eytzinger (BFS) order of a perfect tree, entry k has its
+    // kids at 2k and 2k+1, entry 0 is unused, m_frozenNodes holds the node of each entry
+    bool m_frozen;
+    vector<int> m_frozenIds;
+    vector<Drone*> m_frozenNodes;
+
+    // the path of the last insert or single drone access, the next one starts at the deepest
+    // node whose ID interval low..high holds its ID instead of at the root, so ascending or
+    // clustered IDs only walk a few levels; depth is 0 when a change elsewhere made it stale
+    struct Finger{
+        Drone* node[MAX_DEPTH];
+        int low[MAX_DEPTH];
+        int high[MAX_DEPTH];
+        int depth;
+    };
+    Finger m_finger;
+    bool m_fingerOn;//false starts every descent at the root, the tests compare the two
+    // direct mapped ID -> node cache in front of the tree, findDrone fills it too, so even
+    // const lookups write here and one Show must not be searched from two threads at once;
+    // a node's payload is exact while no ancestor holds a pending value, a walk that pushed
+    // the path down stamps its entry with m_ranges and a later tagging range update bumps it
+    struct HotEntry{
+        int id;//kept next to the node so a miss doesn't touch the node
+        unsigned ranges;//m_ranges when the payload was known to be exact
+        Drone* node;
+    };
+    mutable HotEntry* m_hot;//HOT_SIZE entries, allocated by the first lookup that fills one
+    unsigned m_ranges;//range updates that left pending values
+    mutable long long m_hotHits;
+    mutable long long m_hotMisses;
+    double m_deadFraction;//0 while removes happen right away
+    int m_deadCount;//dead nodes still in the tree, they keep their store slot until compact
+    long long m_violations;
+
+    struct Walk{//stack for an in-order walk that also carries the pending values down
+        Drone* node[MAX_DEPTH];
+        int state[MAX_DEPTH];//pending state inherited by node[i], NO_TAG if none
+        int type[MAX_DEPTH];
+        int depth;
+    };
 
     void dump(Drone* aDrone) const;//helper for recursive traversal
 
@@ -100,26 +253,54 @@ private:
     // Any private helper functions must be delared here!
     // ***************************************************
     Drone * createDrone(const Drone &aDrone, Drone*);
-    Drone * insertHelper(const Drone& aDrone, Drone*);
-    Drone * findHelper(int id, Drone*)const;
-    void helpLightOff(Drone*);
-    void listHelper(Drone* aDrone) const;
-    int helpCount(Drone* aDrone, LIGHTCOLOR aColor )const;
-    void helpClear(Drone*);
-    Drone * helpCopy(Drone*);
-    Drone * rebalanceHelper(Drone*);
-    Drone * removeHelper(Drone*, int id);
-    int helpBalance(Drone*);
-    Drone * helpRightRightRotate(Drone*);
-    Drone * helpLeftLeftRotate(Drone*);
-    Drone * helpLeftRightRotate(Drone*);
-    Drone * helpRightLeftRotate(Drone*);
-    int countNodes(Drone*);
-    void helpHeight(Drone*);
-    int findHeight(Drone*);
-    bool testBalance(Drone*);
-    bool testBSTProperty(Drone*);
-    int helpCountState(Drone* aDrone, STATE LIGHTOFF) const;
+    void linkDrone(Drone* aNode);
+    void listHelper(Drone* aDrone, int state = NO_TAG, int type = NO_TAG) const;
+    int helpCount(Drone* aDrone, LIGHTCOLOR aColor, int type = NO_TAG)const;
+    void dropDrone(Drone*);//a node removeHelper unlinked leaves the indexes, the grid and the store
+    int helpCountState(Drone* aDrone, STATE LIGHTOFF, int state = NO_TAG) const;
+    void pushDown(Drone*);
+    void applyTag(Drone*, int state, int type);
+    void rangeHelper(Drone*, int lo, int hi, int low, int high, int state, int type);
+    unsigned long long * indexBits(int which) const;//which is a color or NUMCOLORS + state
+    int * indexCount(int which);
+    void indexAdd(int id, LIGHTCOLOR type, STATE state);
+    void indexRemove(int id, LIGHTCOLOR type, STATE state);
+    void indexMoveRange(int lo, int hi, int to, int first, int last);
+    void indexCopy(const Show & rhs);
+    void indexClear();
+    vector<int> indexList(int which) const;
+    void walkLeft(Walk & walk, Drone* curr, int state, int type) const;
+    void gridFill(Drone*);
+    void writeState(Drone* aDrone, int state);//the store and the node's own copy
+    void writeColor(Drone* aDrone, int color);
+    void flipHelper(Drone* aDrone);
+    LIGHTCOLOR typeOf(const Drone* aDrone) const;
+    STATE stateOf(const Drone* aDrone) const;
+    void flushTags();
+    void flushHelper(Drone*);
+    Drone * frozenFind(int id) const;
+    void inorderNodes(Drone*, vector<Drone*> & nodes) const;
+    void eytzingerFill(const vector<Drone*> & sorted, int & next, int k);
+    bool walkNext(Walk & walk, DroneChange & next) const;
+    Drone * loadHelper(const vector<DroneChange> & drones, int first, int last);
+    bool fingerDescend(int id);
+    bool fingerInsert(Drone* aNode);
+    Drone * fingerFind(int id);
+    Drone * hotFind(int id, bool exact = false) const;//exact: only if no pending value can be above it
+    void hotStore(int id, Drone*, bool exact) const;
+    void hotForget(int id);
+    void hotClear();
+    void buryDrone(Drone*);
+    void reviveDrone(Drone* dead, const Drone* aNode);
+    Drone * compactHelper(const vector<Drone*> & nodes, int first, int last);
+    void checkNode(Drone*, int low, int high);
+    int runQuery(const DroneQuery & query, QUERYPLAN plan, vector<int>* ids) const;
+    unsigned long long queryBits(const DroneQuery & query, int word) const;
+    int queryWalk(Drone*, const DroneQuery & query, bool prune, int state, int type, vector<int>* ids) const;
+    int queryUpdate(const DroneQuery & query, int which, int value);
+    void queryApply(Drone*, const DroneQuery & query, int which, int value);
+    int checkHelper(const Drone*, int low, int high, int & nodes) const;
 
 };
+inline void swap(Show & lhs, Show & rhs) noexcept { lhs.swap(rhs); }
 #endif
\ No newline at end of file
@@ -0,0 +1,249 @@
+#include "spatialgrid.h"
+#include "show.h"
+#include <cmath>
+#include <algorithm>
+#define AXIS_BITS 21 // bits per axis in a cell key
+#define AXIS_OFFSET (1LL << (AXIS_BITS - 1)) // lets negative cells fit
+#define AXIS_LOW (-AXIS_OFFSET) // cells past these are clamped onto them, +-2^20 cells is
+#define AXIS_HIGH (AXIS_OFFSET - 1) // about 2000 km at the default cell size
+
+SpatialGrid::SpatialGrid(double cellSize){
+    m_cellSize = cellSize;
+    m_size = 0;
+}
+
+void SpatialGrid::setCellSize(double cellSize){
+    vector<Drone*> all;
+    for (auto & cell : m_cells) {
+        all.insert(all.end(), cell.second.begin(), cell.second.end());
+    }
+    clear();
+    m_cellSize = cellSize;
+    for (int i = 0; i < (int)all.size(); i++) {
+        add(all[i]);
+    }
+}
+
+void SpatialGrid::add(Drone *aDrone){
+    vector<Drone*> & drones = m_cells[cellKey(cellOf(aDrone->getX()), cellOf(aDrone->getY()), cellOf(aDrone->getZ()))];
+    aDrone->m_cell = (int)drones.size();
+    drones.push_back(aDrone);
+    m_size++;
+}
+
+void SpatialGrid::remove(Drone *aDrone){
+    auto cell = m_cells.find(cellKey(cellOf(aDrone->getX()), cellOf(aDrone->getY()), cellOf(aDrone->getZ())));
+    if (cell == m_cells.end()) {
+        return;
+    }
+    vector<Drone*> & drones = cell->second;
+    int i = aDrone->m_cell;
+    if (0 <= i && i < (int)drones.size() && drones[i] == aDrone) { // order in a cell doesn't matter, swap with the last one
+        drones[i] = drones.back();
+        drones[i]->m_cell = i;
+        drones.pop_back();
+        aDrone->m_cell = NO_CELL;
+        m_size--;
+    }
+    if (drones.empty()) {
+        m_cells.erase(cell);
+    }
+}
+
+void SpatialGrid::move(Drone *aDrone, double x, double y, double z){
+    long long oldKey = cellKey(cellOf(aDrone->getX()), cellOf(aDrone->getY()), cellOf(aDrone->getZ()));
+    long long newKey = cellKey(cellOf(x), cellOf(y), cellOf(z));
+    if (oldKey == newKey) { // most moves per tick stay inside the cell
+        aDrone->setPosition(x, y, z);
+    }
+    else {
+        remove(aDrone);
+        aDrone->setPosition(x, y, z);
+        add(aDrone);
+    }
+}
+
+void SpatialGrid::clear(){
+    m_cells.clear();
+    m_size = 0;
+}
+
+void SpatialGrid::swap(SpatialGrid & rhs){
+    m_cells.swap(rhs.m_cells);
+    double cellSize = m_cellSize;
+    m_cellSize = rhs.m_cellSize;
+    rhs.m_cellSize = cellSize;
+    int size = m_size;
+    m_size = rhs.m_size;
+    rhs.m_size = size;
+}
+
+// the cube around the ball is looked up cell by cell while it has fewer cells than the grid
+// has occupied ones, a bigger cube only visits the occupied cells that lie inside it
+void SpatialGrid::near(double x, double y, double z, double radius, vector<Drone*> & found) const{
+    if (m_size == 0) {
+        return;
+    }
+    double span = 2 * radius / m_cellSize + 2; // cells per axis, at most
+    if (span * span * span > (double)m_cells.size()) { // in doubles, a huge radius can't overflow
+        double low[3] = {floor((x - radius) / m_cellSize), floor((y - radius) / m_cellSize), floor((z - radius) / m_cellSize)};
+        double high[3] = {floor((x + radius) / m_cellSize), floor((y + radius) / m_cellSize), floor((z + radius) / m_cellSize)};
+        for (int axis = 0; axis < 3; axis++) { // clamped like the drones' cells
+            low[axis] = std::min(std::max(low[axis], (double)AXIS_LOW), (double)AXIS_HIGH);
+            high[axis] = std::min(std::max(high[axis], (double)AXIS_LOW), (double)AXIS_HIGH);
+        }
+        for (auto & cell : m_cells) {
+            long long at[3];
+            cellCoords(cell.first, at[0], at[1], at[2]);
+            if (low[0] <= at[0] && at[0] <= high[0] && low[1] <= at[1] && at[1] <= high[1] && low[2] <= at[2] && at[2] <= high[2]) {
+                closeTo(cell.second, x, y, z, radius, found);
+            }
+        }
+        return;
+    }
+    long long lowX = cellOf(x - radius), highX = cellOf(x + radius);
+    long long lowY = cellOf(y - radius), highY = cellOf(y + radius);
+    long long lowZ = cellOf(z - radius), highZ = cellOf(z + radius);
+    for (long long ix = lowX; ix <= highX; ix++) {
+        for (long long iy = lowY; iy <= highY; iy++) {
+            for (long long iz = lowZ; iz <= highZ; iz++) {
+                auto cell = m_cells.find(cellKey(ix, iy, iz));
+                if (cell != m_cells.end()) {
+                    closeTo(cell->second, x, y, z, radius, found);
+                }
+            }
+        }
+    }
+}
+
+// grows the search ball until it holds k drones, everything outside the ball
+// is further away than anything inside so the k closest are in it; a ball that
+// reaches the far corner of the occupied cells holds every drone, so it stops growing there
+void SpatialGrid::nearest(double x, double y, double z, int k, vector<Drone*> & found) const{
+    if (k <= 0 || m_size == 0) {
+        return;
+    }
+    if (k > m_size) {
+        k = m_size;
+    }
+    double limit = farthest(x, y, z);
+    double radius = m_cellSize < limit ? m_cellSize : limit;
+    vector<Drone*> candidates;
+    near(x, y, z, radius, candidates);
+    while ((int)candidates.size() < k) {
+        radius = radius * 2 < limit ? radius * 2 : limit;
+        candidates.clear();
+        near(x, y, z, radius, candidates);
+    }
+    auto closer = [x, y, z](const Drone *a, const Drone *b) {
+        double da = (a->getX() - x) * (a->getX() - x) + (a->getY() - y) * (a->getY() - y) + (a->getZ() - z) * (a->getZ() - z);
+        double db = (b->getX() - x) * (b->getX() - x) + (b->getY() - y) * (b->getY() - y) + (b->getZ() - z) * (b->getZ() - z);
+        return da < db || (da == db && a->getID() < b->getID());
+    };
+    partial_sort(candidates.begin(), candidates.begin() + k, candidates.end(), closer);
+    found.insert(found.end(), candidates.begin(), candidates.begin() + k);
+}
+
+// every cell is compared with itself and with the neighbour cells that come after it,
+// so each pair of cells is looked at once
+void SpatialGrid::collisions(double radius, vector<pair<Drone*,Drone*> > & found) const{
+    long long reach = (long long)ceil(radius / m_cellSize);
+    for (auto & cell : m_cells) {
+        long long ix, iy, iz;
+        cellCoords(cell.first, ix, iy, iz);
+
+        closePairs(cell.second, cell.second, true, radius, found);
+        for (long long dx = 0; dx <= reach; dx++) {
+            for (long long dy = -reach; dy <= reach; dy++) {
+                for (long long dz = -reach; dz <= reach; dz++) {
+                    bool after = dx > 0 || (dx == 0 && (dy > 0 || (dy == 0 && dz > 0)));
+                    bool inside = ix + dx <= AXIS_HIGH && AXIS_LOW <= iy + dy && iy + dy <= AXIS_HIGH
+                                  && AXIS_LOW <= iz + dz && iz + dz <= AXIS_HIGH; // a key past the edge would wrap
+                    if (!after || !inside) {
+                        continue;
+                    }
+                    auto other = m_cells.find(cellKey(ix + dx, iy + dy, iz + dz));
+                    if (other != m_cells.end()) {
+                        closePairs(cell.second, other->second, false, radius, found);
+                    }
+                }
+            }
+        }
+    }
+}
+
+long long SpatialGrid::cellKey(long long ix, long long iy, long long iz) const{
+    long long mask = (1LL << AXIS_BITS) - 1;
+    return (((ix + AXIS_OFFSET) & mask) << (2 * AXIS_BITS)) | (((iy + AXIS_OFFSET) & mask) << AXIS_BITS) | ((iz + AXIS_OFFSET) & mask);
+}
+
+// clamped, so a drone further out than the keys reach shares the edge cell with its neighbours
+// there instead of wrapping around; the cell still only grows with the position, so a
+// cube of cells around a ball keeps every drone in the ball, queries just check more drones
+long long SpatialGrid::cellOf(double value) const{
+    double cell = floor(value / m_cellSize);
+    return cell >= AXIS_LOW ? (cell <= AXIS_HIGH ? (long long)cell : AXIS_HIGH) : AXIS_LOW; // NaN goes low too
+}
+
+void SpatialGrid::cellCoords(long long key, long long & ix, long long & iy, long long & iz) const{
+    ix = (key >> (2 * AXIS_BITS)) - AXIS_OFFSET;
+    iy = ((key >> AXIS_BITS) & ((1LL << AXIS_BITS) - 1)) - AXIS_OFFSET;
+    iz = (key & ((1LL << AXIS_BITS) - 1)) - AXIS_OFFSET;
+}
+
+// distance from the point to the furthest corner of the box around the occupied cells,
+// one cell more so rounding can't leave a drone on the edge outside
+double SpatialGrid::farthest(double x, double y, double z) const{
+    long long low[3] = {0, 0, 0};
+    long long high[3] = {0, 0, 0};
+    bool first = true;
+    for (auto & cell : m_cells) {
+        long long at[3];
+        cellCoords(cell.first, at[0], at[1], at[2]);
+        for (int axis = 0; axis < 3; axis++) {
+            low[axis] = (first || at[axis] < low[axis]) ? at[axis] : low[axis];
+            high[axis] = (first || at[axis] > high[axis]) ? at[axis] : high[axis];
+        }
+        first = false;
+    }
+    double point[3] = {x, y, z};
+    double distance2 = 0;
+    for (int axis = 0; axis < 3; axis++) {
+        if (low[axis] == AXIS_LOW || high[axis] == AXIS_HIGH) { // a clamped drone can be anywhere past the edge
+            return HUGE_VAL;
+        }
+        double below = point[axis] - low[axis] * m_cellSize;
+        double above = (high[axis] + 1) * m_cellSize - point[axis];
+        double reach = fabs(below) > fabs(above) ? fabs(below) : fabs(above);
+        distance2 += reach * reach;
+    }
+    return sqrt(distance2) + m_cellSize;
+}
+
+void SpatialGrid::closeTo(const vector<Drone*> & drones, double x, double y, double z, double radius,
+                          vector<Drone*> & found) const{
+    double radius2 = radius * radius;
+    for (int i = 0; i < (int)drones.size(); i++) {
+        double dx = drones[i]->getX() - x;
+        double dy = drones[i]->getY() - y;
+        double dz = drones[i]->getZ() - z;
+        if (dx * dx + dy * dy + dz * dz <= radius2) {
+            found.push_back(drones[i]);
+        }
+    }
+}
+
+void SpatialGrid::closePairs(const vector<Drone*> & first, const vector<Drone*> & second, bool same,
+                             double radius, vector<pair<Drone*,Drone*> > & found) const{
+    double radius2 = radius * radius;
+    for (int i = 0; i < (int)first.size(); i++) {
+        for (int j = same ? i + 1 : 0; j < (int)second.size(); j++) {
+            double dx = first[i]->getX() - second[j]->getX();
+            double dy = first[i]->getY() - second[j]->getY();
+            double dz = first[i]->getZ() - second[j]->getZ();
+            if (dx * dx + dy * dy + dz * dz <= radius2) {
+                found.push_back(make_pair(first[i], second[j]));
+            }
+        }
+    }
+}
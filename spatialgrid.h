@@ -0,0 +1,39 @@
+#ifndef SPATIALGRID_H
+#define SPATIALGRID_H
+#include <vector>
+#include <unordered_map>
+using namespace std;
+class Drone;
+#define DEFAULT_CELL_SIZE 2.0 // metres
+// uniform grid over 3D space, every drone is kept in the cell that holds its position,
+// the grid only stores pointers to the tree nodes owned by Show; cell keys hold 2^21 cells
+// per axis around the origin, drones further out are kept in the outermost cells
+class SpatialGrid{
+public:
+    SpatialGrid(double cellSize = DEFAULT_CELL_SIZE);
+    void setCellSize(double cellSize);//moves every drone into the new cells
+    double getCellSize() const {return m_cellSize;}
+    int size() const {return m_size;}
+    void add(Drone* aDrone);
+    void remove(Drone* aDrone);
+    void move(Drone* aDrone, double x, double y, double z);//updates the drone and its cell
+    void clear();
+    void swap(SpatialGrid & rhs);
+    void near(double x, double y, double z, double radius, vector<Drone*> & found) const;
+    void nearest(double x, double y, double z, int k, vector<Drone*> & found) const;
+    void collisions(double radius, vector<pair<Drone*,Drone*> > & found) const;
+
+private:
+    double m_cellSize;
+    int m_size;
+    unordered_map<long long, vector<Drone*> > m_cells;
+
+    long long cellKey(long long ix, long long iy, long long iz) const;
+    long long cellOf(double value) const;
+    void cellCoords(long long key, long long & ix, long long & iy, long long & iz) const;
+    double farthest(double x, double y, double z) const;//no drone is further from the point than this
+    void closeTo(const vector<Drone*> & drones, double x, double y, double z, double radius, vector<Drone*> & found) const;
+    void closePairs(const vector<Drone*> & first, const vector<Drone*> & second, bool same,
+                    double radius, vector<pair<Drone*,Drone*> > & found) const;
+};
+#endif
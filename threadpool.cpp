@@ -0,0 +1,61 @@
+#include "threadpool.h"
+
+ThreadPool::ThreadPool(int threads){
+    m_body = nullptr;
+    m_next = 0;
+    m_count = 0;
+    m_running = 0;
+    m_stop = false;
+    for (int i = 0; i < threads; i++) {
+        m_workers.push_back(thread(&ThreadPool::work, this));
+    }
+}
+
+ThreadPool::~ThreadPool(){
+    {
+        lock_guard<mutex> guard(m_lock);
+        m_stop = true;
+    }
+    m_wake.notify_all();
+    for (int i = 0; i < (int)m_workers.size(); i++) {
+        m_workers[i].join();
+    }
+}
+
+void ThreadPool::parallelFor(int count, const function<void(int)> & body){
+    if (m_workers.empty()) { // no workers, run it on the caller
+        for (int i = 0; i < count; i++) {
+            body(i);
+        }
+        return;
+    }
+    unique_lock<mutex> guard(m_lock);
+    m_body = &body;
+    m_next = 0;
+    m_count = count;
+    m_wake.notify_all();
+    m_done.wait(guard, [this] { return m_next >= m_count && m_running == 0; });
+    m_body = nullptr;
+}
+
+void ThreadPool::work(){
+    unique_lock<mutex> guard(m_lock);
+    while (true) {
+        m_wake.wait(guard, [this] { return m_stop || (m_body != nullptr && m_next < m_count); });
+        if (m_stop) {
+            return;
+        }
+        while (m_body != nullptr && m_next < m_count) {
+            int index = m_next++;
+            const function<void(int)> *body = m_body;
+            m_running++;
+            guard.unlock();
+            (*body)(index);
+            guard.lock();
+            m_running--;
+        }
+        if (m_next >= m_count && m_running == 0) {
+            m_done.notify_all();
+        }
+    }
+}
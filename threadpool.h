@@ -0,0 +1,33 @@
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+#include <vector>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+using namespace std;
+// fixed set of worker threads for fork-join work, parallelFor hands out the
+// indexes 0..count-1 and returns once every one of them has run
+class ThreadPool{
+public:
+    ThreadPool(int threads);
+    ~ThreadPool();
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool & operator=(const ThreadPool &) = delete;
+    int size() const {return (int)m_workers.size();}
+    void parallelFor(int count, const function<void(int)> & body);
+
+private:
+    vector<thread> m_workers;
+    mutex m_lock;
+    condition_variable m_wake;//workers wait here for a new job
+    condition_variable m_done;//parallelFor waits here for the job to finish
+    const function<void(int)> * m_body;//the current job, nullptr between jobs
+    int m_next;//next index to hand out
+    int m_count;
+    int m_running;//indexes handed out but not finished
+    bool m_stop;
+
+    void work();
+};
+#endif